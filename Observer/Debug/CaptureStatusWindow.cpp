@@ -1,5 +1,14 @@
 #include "CaptureStatusWindow.h"
 #include "../ObserverPlugin.h"
+#include "../ObserverStoC.h"
+#include "../ObserverCapture.h"
+#include "../ObserverChunks.h"
+#include "../ObserverAllocations.h"
+
+#include <filesystem>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
 
 void CaptureStatusWindow::Draw(ObserverPlugin& plugin, bool& is_visible)
 {
@@ -30,7 +39,264 @@ void CaptureStatusWindow::Draw(ObserverPlugin& plugin, bool& is_visible)
         if (ImGui::IsItemHovered()) {
             ImGui::SetTooltip("Indicates if the Agents Loop thread is currently capturing agents states snapshots.\n(Triggered by entering observer mode)");
         }
+        if (plugin.loop_handler) {
+            ImGui::Text("Agent Logs in Memory: %.1f KB", plugin.loop_handler->GetAgentLogMemoryBytes() / 1024.0);
+        }
+
+        if (plugin.match_handler && plugin.match_handler->GetLastExportDurationMs() > 0) {
+            ImGui::Text("Last Export: %u ms", plugin.match_handler->GetLastExportDurationMs());
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Wall time of the last export (infos, StoC events and agent logs).");
+            }
+        }
+
+        bool streaming = plugin.stream_handler && plugin.stream_handler->IsActive();
+        ImGui::Text("Disk Streaming:"); ImGui::SameLine();
+        if (streaming) {
+            ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "Active");
+            ImGui::Text("Streamed: %llu chunks, %.1f KB",
+                        static_cast<unsigned long long>(plugin.stream_handler->GetChunksWritten()),
+                        plugin.stream_handler->GetBytesWritten() / 1024.0);
+            if (plugin.capture_handler) {
+                ImGui::Text("StoC Events on Disk: %zu / %zu", plugin.capture_handler->GetSealedCount(), plugin.capture_handler->GetLogCount());
+            }
+        } else {
+            ImGui::TextDisabled("Off");
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Indicates if logs are compressed into the capture folder during the match.\n(Enabled with 'Stream Capture to Disk')");
+        }
+
+        if (plugin.capture_handler) {
+            ImGui::Separator();
+            drawCaptureStreams(plugin);
+        }
+
+        if (plugin.stoc_handler) {
+            const StoCQueueStats stats = plugin.stoc_handler->GetQueueStats();
+            ImGui::Separator();
+            ImGui::Text("StoC Queue: %zu / %zu", stats.queued, stats.capacity);
+            ImGui::Text("Packets Queued: %llu", static_cast<unsigned long long>(stats.pushed));
+            ImGui::Text("Packets Dropped:"); ImGui::SameLine();
+            if (stats.dropped > 0) {
+                ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%llu", static_cast<unsigned long long>(stats.dropped));
+            } else {
+                ImGui::Text("0");
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Packets lost because the consumer thread could not keep up.");
+            }
+            ImGui::Text("Hook Cost: %.0f ns/packet", stats.hook_ns_per_packet);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Average time spent on the game thread per hooked StoC packet.");
+            }
+            if (kCountAllocations) {
+                ImGui::Text("Allocations per Packet:"); ImGui::SameLine();
+                if (stats.allocations_per_packet > 0.0) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%.3f", stats.allocations_per_packet);
+                } else {
+                    ImGui::Text("0");
+                }
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("Heap allocations while handling a packet, expected to be 0 once the agents\nand skills of the match were seen. Free capture blocks: %zu",
+                                      GetFreeCaptureBlockCount());
+                }
+                ImGui::Text("Steady-State Failures:"); ImGui::SameLine();
+                if (stats.steady_state_failures > 0) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%llu (last: type %u, value id %u)",
+                                       static_cast<unsigned long long>(stats.steady_state_failures),
+                                       stats.failed_packet_type, stats.failed_value_id);
+                } else {
+                    ImGui::Text("0");
+                }
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("Packets identical to one handled before that still allocated.\nThe type and value id are the ones of the last such packet.");
+                }
+            }
+
+            // benchmark toggle: handle packets inside the hooks like before the queue existed
+            bool inline_processing = plugin.stoc_handler->IsInlineProcessing();
+            if (ImGui::Checkbox("Process In Hooks (benchmark)", &inline_processing)) {
+                plugin.stoc_handler->SetInlineProcessing(inline_processing);
+                plugin.stoc_handler->ResetQueueStats();
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Handles packets directly on the game thread instead of the consumer thread,\nto compare the hook cost of both paths.");
+            }
+        }
+
+        ImGui::Separator();
+        drawCompressionBenchmark(plugin);
+        ImGui::Separator();
+        drawAgentLogBenchmark();
+        ImGui::Separator();
+        drawTimelineCheck(plugin);
         ImGui::Unindent();
     }
     ImGui::End();
-} 
\ No newline at end of file
+}
+
+void CaptureStatusWindow::drawCaptureStreams(ObserverPlugin& plugin)
+{
+    ImGui::Text("Chunk Memory: %.1f / %.0f MB",
+                CaptureChunkStore::GetMemoryUsage() / (1024.0 * 1024.0),
+                CaptureChunkStore::GetMemoryBudget() / (1024.0 * 1024.0));
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Compressed StoC and agent log chunks held in memory by the live capture and the previous matches.\nPast the budget the oldest ones of any of them are spilled to a temp file.");
+    }
+
+    // one row per StoC file: raw events not sealed yet, then the sealed chunks in memory and on disk
+    if (ImGui::BeginTable("capture_streams_table", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Stream");
+        ImGui::TableSetupColumn("Live KB");
+        ImGui::TableSetupColumn("Chunks");
+        ImGui::TableSetupColumn("Packed KB");
+        ImGui::TableSetupColumn("Spilled KB");
+        ImGui::TableHeadersRow();
+        for (size_t c = 0; c < kCaptureCategoryCount; ++c) {
+            const CaptureCategory category = static_cast<CaptureCategory>(c);
+            uint64_t unsealed_bytes = 0;
+            const CaptureChunkStats stats = plugin.capture_handler->GetChunkStats(category, unsealed_bytes);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(GetCaptureCategoryFileName(category));
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", unsealed_bytes / 1024.0);
+            ImGui::TableNextColumn(); ImGui::Text("%zu", stats.chunk_count);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", stats.memory_bytes / 1024.0);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", stats.spilled_bytes / 1024.0);
+        }
+        ImGui::EndTable();
+    }
+}
+
+void CaptureStatusWindow::drawCompressionBenchmark(ObserverPlugin& plugin)
+{
+    // collect the results once the worker is done
+    const bool running = benchmark_job_.valid() &&
+                         benchmark_job_.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    if (benchmark_job_.valid() && !running) {
+        try {
+            benchmark_results_ = benchmark_job_.get();
+        } catch (const std::exception& e) {
+            benchmark_error_ = e.what();
+        }
+    }
+
+    if (running) {
+        ImGui::TextDisabled("Benchmarking levels...");
+    } else if (ImGui::Button("Benchmark Compression")) {
+        // the corpus is the capture exported under the current match name
+        std::filesystem::path match_dir = std::filesystem::path("captures") / plugin.export_folder_name;
+        benchmark_results_.clear();
+        benchmark_error_.clear();
+        benchmark_job_ = std::async(std::launch::async, [match_dir]() {
+            const std::string corpus = LoadCaptureCorpus(match_dir);
+            if (corpus.empty()) throw std::runtime_error("No capture files found in " + match_dir.string());
+            return RunCompressionBenchmark(corpus);
+        });
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Compresses the capture exported under the current Match Name at every gzip level,\nreporting throughput and compression ratio.");
+    }
+
+    if (!benchmark_error_.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%s", benchmark_error_.c_str());
+    }
+    if (benchmark_results_.empty()) return;
+
+    ImGui::Text("Corpus: %.1f MB", benchmark_results_.front().input_bytes / (1024.0 * 1024.0));
+    ImGui::Columns(4, "CompressionBenchmark", false);
+    ImGui::Text("Codec"); ImGui::NextColumn();
+    ImGui::Text("Level"); ImGui::NextColumn();
+    ImGui::Text("MB/s"); ImGui::NextColumn();
+    ImGui::Text("Ratio"); ImGui::NextColumn();
+    for (const CompressionBenchmarkResult& result : benchmark_results_) {
+        ImGui::Text("%s", GetCaptureCodecName(result.settings.codec)); ImGui::NextColumn();
+        ImGui::Text("%d", result.settings.level); ImGui::NextColumn();
+        ImGui::Text("%.1f", result.GetMegabytesPerSecond()); ImGui::NextColumn();
+        ImGui::Text("%.2f", result.GetRatio()); ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+} 
+
+void CaptureStatusWindow::drawAgentLogBenchmark()
+{
+    const bool running = agent_log_job_.valid() &&
+                         agent_log_job_.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    if (agent_log_job_.valid() && !running) {
+        agent_log_result_ = agent_log_job_.get();
+        has_agent_log_result_ = true;
+    }
+
+    if (running) {
+        ImGui::TextDisabled("Simulating match...");
+    } else if (ImGui::Button("Benchmark Agent Log Encoding")) {
+        has_agent_log_result_ = false;
+        agent_log_job_ = std::async(std::launch::async, []() { return RunAgentLogBenchmark(); });
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Logs a synthetic 30 minute match with 40 agents and compares full snapshots\nwith the delta encoded agent logs, their memory chunks and their trajectory files.");
+    }
+    if (!has_agent_log_result_) return;
+
+    const AgentLogBenchmarkResult& result = agent_log_result_;
+    ImGui::Text("Snapshots: %zu", result.snapshot_count);
+    ImGui::Text("Full: %.1f KB, Delta: %.1f KB (%.1fx)", result.full_bytes / 1024.0, result.delta_bytes / 1024.0,
+                result.delta_bytes > 0 ? static_cast<double>(result.full_bytes) / result.delta_bytes : 0.0);
+    ImGui::Text("Encode: %.1f ms, Decode: %.1f ms", result.encode_ms, result.decode_ms);
+    const std::pair<const char*, bool> round_trips[] = {
+        {"Round Trip:", result.round_trip_ok},
+        {"Chunk Round Trip:", result.chunk_round_trip_ok},
+        {"Trajectory Round Trip:", result.trajectory_round_trip_ok},
+    };
+    for (const auto& [label, ok] : round_trips) {
+        ImGui::Text("%s", label); ImGui::SameLine();
+        if (ok) {
+            ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "OK");
+        } else {
+            ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Mismatch");
+        }
+    }
+}
+
+void CaptureStatusWindow::drawTimelineCheck(ObserverPlugin& plugin)
+{
+    const bool running = timeline_job_.valid() &&
+                         timeline_job_.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    if (timeline_job_.valid() && !running) {
+        try {
+            timeline_result_ = timeline_job_.get();
+            has_timeline_result_ = true;
+        } catch (const std::exception& e) {
+            timeline_error_ = e.what();
+        }
+    }
+
+    if (running) {
+        ImGui::TextDisabled("Merging StoC files...");
+    } else if (ImGui::Button("Verify Capture Order")) {
+        // the capture exported under the current match name, as a folder or an archive
+        std::filesystem::path capture_path = std::filesystem::path("captures") / plugin.export_folder_name;
+        if (!std::filesystem::is_directory(capture_path)) capture_path += ".obsm";
+        has_timeline_result_ = false;
+        timeline_error_.clear();
+        timeline_job_ = std::async(std::launch::async, [capture_path]() {
+            return CheckCaptureTimeline(capture_path);
+        });
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Merges the StoC files of the capture exported under the current Match Name back into\narrival order, checking sequence numbers and times never go backwards.");
+    }
+
+    if (!timeline_error_.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%s", timeline_error_.c_str());
+    }
+    if (!has_timeline_result_) return;
+
+    ImGui::Text("Lines: %zu from %zu files", timeline_result_.line_count, timeline_result_.file_count);
+    ImGui::Text("Order:"); ImGui::SameLine();
+    if (timeline_result_.out_of_order == 0) {
+        ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "OK");
+    } else {
+        ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%zu lines out of order", timeline_result_.out_of_order);
+    }
+}
@@ -1,10 +1,39 @@
 #pragma once
 
 #include <imgui.h>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "../ObserverCompression.h"
+#include "../ObserverAgentLog.h"
+#include "../ObserverTimeline.h"
 
 class ObserverPlugin;
 
 class CaptureStatusWindow {
 public:
     void Draw(ObserverPlugin& plugin, bool& is_visible);
-}; 
\ No newline at end of file
+
+private:
+    void drawCaptureStreams(ObserverPlugin& plugin);
+    void drawCompressionBenchmark(ObserverPlugin& plugin);
+    void drawAgentLogBenchmark();
+    void drawTimelineCheck(ObserverPlugin& plugin);
+
+    // codec benchmark over a recorded capture, runs on its own thread
+    std::future<std::vector<CompressionBenchmarkResult>> benchmark_job_;
+    std::vector<CompressionBenchmarkResult> benchmark_results_;
+    std::string benchmark_error_;
+
+    // agent log encoding benchmark over a synthetic match
+    std::future<AgentLogBenchmarkResult> agent_log_job_;
+    AgentLogBenchmarkResult agent_log_result_;
+    bool has_agent_log_result_ = false;
+
+    // global order check of an exported capture, runs on its own thread
+    std::future<TimelineCheckResult> timeline_job_;
+    TimelineCheckResult timeline_result_;
+    bool has_timeline_result_ = false;
+    std::string timeline_error_;
+};
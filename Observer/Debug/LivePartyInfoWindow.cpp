@@ -17,13 +17,12 @@ void LivePartyInfoWindow::Draw(ObserverPlugin& plugin, bool& is_visible)
     {
         ImGui::Indent();
         if (plugin.match_handler) {
-            std::lock_guard<std::mutex> lock(plugin.match_handler->GetMatchInfo().agents_info_mutex);
-            const auto& agents_info = plugin.match_handler->GetMatchInfo().agents_info;
+            const std::vector<AgentInfo> agents_info = plugin.match_handler->GetMatchInfo().GetAgentsInfoCopy();
 
             std::vector<const AgentInfo*> agent_list;
             agent_list.reserve(agents_info.size());
-            for(const auto& pair : agents_info) {
-                agent_list.push_back(&pair.second);
+            for (const AgentInfo& agent : agents_info) {
+                agent_list.push_back(&agent);
             }
             
             std::sort(agent_list.begin(), agent_list.end(), [](const AgentInfo* a, const AgentInfo* b) {
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// living agent fields read on the game thread, the consumer thread never touches GWCA agent memory
+struct StoCAgentSnapshot {
+    static constexpr uint16_t kGuildLordPlayerNumber = 170;
+
+    uint32_t max_hp = 0;
+    uint16_t player_number = 0;
+    uint8_t team_id = 0;
+    uint8_t is_living = 0;
+
+    bool IsGuildLord() const { return player_number == kGuildLordPlayerNumber; }
+};
+
+// agent attributes refreshed by ObserverLoop every tick, so the StoC hooks read one slot per agent
+// instead of looking the agent up in GWCA on every packet. each slot is a single atomic word:
+// the loop thread rewrites it while the game thread reads it, a reader never sees half an update.
+// ids past kMaxAgents and agents spawned since the last tick miss and are looked up directly.
+class AgentAttributeCache {
+public:
+    static constexpr uint32_t kMaxAgents = 8192; // 64 KB of slots
+
+    // game thread. false if the agent is not cached
+    bool Load(uint32_t agent_id, StoCAgentSnapshot& out) const {
+        if (agent_id >= kMaxAgents) return false;
+        const uint64_t word = slots_[agent_id].load(std::memory_order_relaxed);
+        if (!(word & kPresentBit)) return false;
+        out.max_hp = static_cast<uint32_t>(word);
+        out.player_number = static_cast<uint16_t>(word >> 32);
+        out.team_id = static_cast<uint8_t>(word >> 48);
+        out.is_living = (word & kLivingBit) ? 1 : 0;
+        return true;
+    }
+
+    // loop thread: BeginUpdate, Set for every agent of the agent array, then EndUpdate.
+    // agents that were not set are dropped from the cache
+    void BeginUpdate() { pending_.assign(kMaxAgents, 0); }
+    void Set(uint32_t agent_id, const StoCAgentSnapshot& snapshot) {
+        if (agent_id >= kMaxAgents || pending_.empty()) return;
+        pending_[agent_id] = kPresentBit | (snapshot.is_living ? kLivingBit : 0) |
+                             (static_cast<uint64_t>(snapshot.team_id) << 48) |
+                             (static_cast<uint64_t>(snapshot.player_number) << 32) |
+                             snapshot.max_hp;
+    }
+    void EndUpdate() {
+        if (pending_.empty()) return;
+        for (uint32_t i = 0; i < kMaxAgents; ++i) {
+            if (slots_[i].load(std::memory_order_relaxed) != pending_[i]) {
+                slots_[i].store(pending_[i], std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void Clear() {
+        for (auto& slot : slots_) slot.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    // max_hp in bits 0-31, player_number in 32-47, team_id in 48-55, flags above
+    static constexpr uint64_t kPresentBit = 1ull << 56;
+    static constexpr uint64_t kLivingBit = 1ull << 57;
+
+    std::array<std::atomic<uint64_t>, kMaxAgents> slots_{};
+    std::vector<uint64_t> pending_; // next slot values, loop thread only
+};
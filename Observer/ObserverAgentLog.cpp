@@ -0,0 +1,352 @@
+#include "ObserverAgentLog.h"
+#include "ObserverCompression.h"
+#include "ObserverTrajectory.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+/* encoding of one snapshot in data_:
+   keyframe: varint absolute timestamp, then every word of AgentState
+   delta:    PutAgentStateDelta, the same encoding as the trajectory files
+   the fields that change most (position, rotation, health, velocity) are the first words of AgentState,
+   so the mask usually fits in one byte. small moves of a float keep its exponent, so their bit patterns
+   differ by a small integer too. keyframe words are stored in native byte order, the log never leaves the process. */
+
+namespace {
+    void PutWord(std::vector<uint8_t>& data, uint32_t word) {
+        const size_t offset = data.size();
+        data.resize(offset + sizeof(uint32_t));
+        memcpy(data.data() + offset, &word, sizeof(uint32_t));
+    }
+
+    uint32_t GetWord(const uint8_t* data, size_t& offset) {
+        uint32_t word;
+        memcpy(&word, data + offset, sizeof(uint32_t));
+        offset += sizeof(uint32_t);
+        return word;
+    }
+}
+
+void PutAgentStateDelta(std::vector<uint8_t>& data, uint32_t time_delta,
+                        const uint32_t (&words)[kAgentStateWordCount], const uint32_t (&last_words)[kAgentStateWordCount]) {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kAgentStateWordCount; ++i) {
+        if (words[i] != last_words[i]) mask |= 1u << i;
+    }
+    PutVarint(data, time_delta);
+    PutVarint(data, mask);
+    for (size_t i = 0; i < kAgentStateWordCount; ++i) {
+        if (mask & (1u << i)) PutVarint(data, ZigZag(words[i] - last_words[i]));
+    }
+}
+
+bool GetAgentStateDelta(const uint8_t* data, size_t size, size_t& offset, uint32_t& time_delta,
+                        uint32_t (&words)[kAgentStateWordCount]) {
+    uint32_t mask;
+    if (!GetVarint(data, size, offset, time_delta) || !GetVarint(data, size, offset, mask)) return false;
+    for (size_t i = 0; i < kAgentStateWordCount; ++i) {
+        if (!(mask & (1u << i))) continue;
+        uint32_t value;
+        if (!GetVarint(data, size, offset, value)) return false;
+        words[i] += UnZigZag(value);
+    }
+    return true;
+}
+
+void AgentStateLog::Append(uint32_t timestamp_ms, const AgentState& state) {
+    uint32_t words[kWordCount];
+    memcpy(words, &state, sizeof(AgentState));
+
+    if (count_ % kKeyframeInterval == 0) {
+        keyframe_offsets_.push_back(static_cast<uint32_t>(data_.size()));
+        PutVarint(data_, timestamp_ms);
+        for (size_t i = 0; i < kWordCount; ++i) {
+            PutWord(data_, words[i]);
+        }
+    } else {
+        uint32_t last_words[kWordCount];
+        memcpy(last_words, &last_state_, sizeof(AgentState));
+        PutAgentStateDelta(data_, timestamp_ms - last_timestamp_ms_, words, last_words);
+    }
+
+    last_state_ = state;
+    last_timestamp_ms_ = timestamp_ms;
+    ++count_;
+}
+
+void AgentStateLog::Prepend(const AgentStateLog& older) {
+    if (older.Empty()) return;
+
+    // re-encode both runs one after the other so keyframes stay on their interval
+    AgentStateLog merged = older;
+    Reader reader(*this);
+    uint32_t timestamp_ms;
+    AgentState state;
+    while (reader.Next(timestamp_ms, state)) {
+        merged.Append(timestamp_ms, state);
+    }
+    *this = std::move(merged);
+}
+
+void AgentStateLog::DropFront(size_t count) {
+    if (count >= count_) {
+        *this = AgentStateLog(); // a sealed log gives its capacity back too
+        return;
+    }
+
+    AgentStateLog rest;
+    Reader reader(*this, count);
+    uint32_t timestamp_ms;
+    AgentState state;
+    while (reader.Next(timestamp_ms, state)) {
+        rest.Append(timestamp_ms, state);
+    }
+    *this = std::move(rest);
+}
+
+void AgentStateLog::Clear() {
+    data_.clear();
+    keyframe_offsets_.clear();
+    count_ = 0;
+    last_timestamp_ms_ = 0;
+    last_state_ = AgentState();
+}
+
+AgentStateLog::Reader::Reader(const AgentStateLog& log, size_t first_snapshot) : log_(log) {
+    if (first_snapshot >= log_.count_) {
+        index_ = log_.count_;
+        return;
+    }
+
+    // jump to the closest keyframe, then decode up to the requested snapshot
+    const size_t keyframe = first_snapshot / kKeyframeInterval;
+    offset_ = log_.keyframe_offsets_[keyframe];
+    index_ = keyframe * kKeyframeInterval;
+
+    uint32_t timestamp_ms;
+    AgentState state;
+    while (index_ < first_snapshot) {
+        Next(timestamp_ms, state);
+    }
+}
+
+bool AgentStateLog::Reader::Next(uint32_t& timestamp_ms, AgentState& state) {
+    if (index_ >= log_.count_) return false;
+
+    const uint8_t* data = log_.data_.data();
+    const size_t size = log_.data_.size();
+    if (index_ % kKeyframeInterval == 0) {
+        GetVarint(data, size, offset_, timestamp_ms_);
+        for (size_t i = 0; i < kWordCount; ++i) {
+            words_[i] = GetWord(data, offset_);
+        }
+    } else {
+        // the log is only written by Append, the data can't end inside a snapshot
+        uint32_t time_delta;
+        GetAgentStateDelta(data, size, offset_, time_delta, words_);
+        timestamp_ms_ += time_delta;
+    }
+    ++index_;
+
+    timestamp_ms = timestamp_ms_;
+    memcpy(&state, words_, sizeof(AgentState));
+    return true;
+}
+
+std::vector<unsigned char> PackAgentStateLog(const AgentStateLog& log) {
+    std::vector<uint8_t> encoded;
+    AgentStateLog::Reader reader(log);
+    uint32_t timestamp_ms;
+    uint32_t last_timestamp_ms = 0;
+    AgentState state;
+    uint32_t words[kAgentStateWordCount];
+    uint32_t last_words[kAgentStateWordCount] = {};
+    while (reader.Next(timestamp_ms, state)) {
+        memcpy(words, &state, sizeof(AgentState));
+        PutAgentStateDelta(encoded, timestamp_ms - last_timestamp_ms, words, last_words);
+        memcpy(last_words, words, sizeof(words));
+        last_timestamp_ms = timestamp_ms;
+    }
+
+    std::vector<unsigned char> packed;
+    GzipSink sink(packed, CompressionSettings{CaptureCodec::Gzip, 1});
+    sink.Write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+    sink.Finish();
+    packed.shrink_to_fit();
+    return packed;
+}
+
+void UnpackAgentStateLog(const std::vector<unsigned char>& packed, AgentStateLog& log) {
+    if (packed.empty()) return; // nothing was written for an empty run
+    const std::string raw = decompress_gzip(packed);
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(raw.data());
+    size_t offset = 0;
+    uint32_t timestamp_ms = 0;
+    uint32_t words[kAgentStateWordCount] = {};
+    while (offset < raw.size()) {
+        uint32_t time_delta;
+        if (!GetAgentStateDelta(data, raw.size(), offset, time_delta, words)) {
+            throw std::runtime_error("Packed agent snapshots are corrupted.");
+        }
+        timestamp_ms += time_delta;
+        AgentState state;
+        memcpy(&state, words, sizeof(AgentState));
+        log.Append(timestamp_ms, state);
+    }
+}
+
+AgentLogBenchmarkResult RunAgentLogBenchmark(uint32_t duration_minutes, uint32_t agent_count) {
+    constexpr uint32_t kTickMs = 200;                 // ObserverLoop interval
+    constexpr float kDistanceThresholdSq = 30.0f * 30.0f; // ObserverLoop position threshold
+    constexpr uint32_t kPlayerCount = 16;
+
+    AgentLogBenchmarkResult result;
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    // the first agents behave like players, the rest like npcs, spirits and items standing around
+    std::vector<AgentState> current(agent_count);
+    for (uint32_t i = 0; i < agent_count; ++i) {
+        AgentState& state = current[i];
+        state.x = unit(rng) * 10000.0f - 5000.0f;
+        state.y = unit(rng) * 10000.0f - 5000.0f;
+        state.model_id = i + 1;
+        state.max_hp = 480 + i * 10;
+        state.health_pct = 1.0f;
+        state.team_id = static_cast<uint8_t>(i < kPlayerCount ? 1 + i / 8 : 0);
+        state.weapon_type = static_cast<uint16_t>(i % 6);
+        state.weapon_attack_speed = 1.33f;
+        state.attack_speed_modifier = 1.0f;
+        state.Set(AgentStateFlag::Alive, true);
+    }
+
+    std::vector<std::vector<std::pair<uint32_t, AgentState>>> full_logs(agent_count);
+    std::vector<AgentStateLog> delta_logs(agent_count);
+    std::vector<AgentState> last_logged(agent_count);
+    std::vector<bool> has_logged(agent_count, false);
+    std::chrono::steady_clock::duration encode_time{0};
+
+    const uint32_t tick_count = duration_minutes * 60 * 1000 / kTickMs;
+    for (uint32_t tick = 0; tick < tick_count; ++tick) {
+        const uint32_t timestamp_ms = tick * kTickMs;
+        for (uint32_t i = 0; i < agent_count; ++i) {
+            AgentState& state = current[i];
+            const bool is_player = i < kPlayerCount;
+
+            if (is_player) {
+                // players run most of the time and turn now and then
+                if (unit(rng) < 0.1f) {
+                    const bool running = unit(rng) < 0.7f;
+                    const float angle = unit(rng) * 6.2831853f;
+                    state.rotation_angle = angle;
+                    state.move_x = running ? 288.0f * std::cos(angle) : 0.0f;
+                    state.move_y = running ? 288.0f * std::sin(angle) : 0.0f;
+                    state.animation_id = running ? 0x1A : 0x02;
+                }
+                state.x += state.move_x * (kTickMs / 1000.0f);
+                state.y += state.move_y * (kTickMs / 1000.0f);
+                if (unit(rng) < 0.2f) state.health_pct = std::max(0.0f, std::min(1.0f, state.health_pct + (unit(rng) - 0.5f) * 0.1f));
+                if (unit(rng) < 0.05f) {
+                    const bool casting = !state.Has(AgentStateFlag::Casting);
+                    state.Set(AgentStateFlag::Casting, casting);
+                    state.skill_id = casting ? 1 + static_cast<uint32_t>(unit(rng) * 3000) : 0;
+                    state.animation_code = casting ? 0x40 : 0;
+                }
+                if (unit(rng) < 0.02f) state.Set(AgentStateFlag::Hex, !state.Has(AgentStateFlag::Hex));
+                if (unit(rng) < 0.02f) state.Set(AgentStateFlag::Enchantment, !state.Has(AgentStateFlag::Enchantment));
+            } else if (unit(rng) < 0.02f) {
+                state.health_pct = std::min(1.0f, state.health_pct + 0.01f);
+            }
+
+            // same filter as ObserverLoop::RunLoop
+            if (has_logged[i]) {
+                const AgentState& last = last_logged[i];
+                const float dx = state.x - last.x;
+                const float dy = state.y - last.y;
+                const float dz = state.z - last.z;
+                if (dx * dx + dy * dy + dz * dz < kDistanceThresholdSq && state.SameExceptPosition(last)) continue;
+            }
+            last_logged[i] = state;
+            has_logged[i] = true;
+
+            full_logs[i].push_back({timestamp_ms, state});
+            const auto start = std::chrono::steady_clock::now();
+            delta_logs[i].Append(timestamp_ms, state);
+            encode_time += std::chrono::steady_clock::now() - start;
+        }
+    }
+
+    result.round_trip_ok = true;
+    const auto decode_start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < agent_count; ++i) {
+        result.snapshot_count += full_logs[i].size();
+        result.full_bytes += full_logs[i].size() * sizeof(std::pair<uint32_t, AgentState>);
+        result.delta_bytes += delta_logs[i].GetEncodedBytes();
+
+        AgentStateLog::Reader reader(delta_logs[i]);
+        uint32_t timestamp_ms;
+        AgentState state;
+        for (const auto& entry : full_logs[i]) {
+            if (!reader.Next(timestamp_ms, state) || timestamp_ms != entry.first || state != entry.second) {
+                result.round_trip_ok = false;
+                break;
+            }
+        }
+    }
+    result.decode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decode_start).count();
+    result.encode_ms = std::chrono::duration<double, std::milli>(encode_time).count();
+
+    // not timed: the chunk and trajectory encodings only have to give the snapshots back
+    result.chunk_round_trip_ok = true;
+    result.trajectory_round_trip_ok = true;
+    for (uint32_t i = 0; i < agent_count; ++i) {
+        const auto& expected = full_logs[i];
+
+        AgentStateLog unpacked;
+        UnpackAgentStateLog(PackAgentStateLog(delta_logs[i]), unpacked);
+        AgentStateLog::Reader chunk_reader(unpacked);
+        uint32_t timestamp_ms;
+        AgentState state;
+        for (const auto& entry : expected) {
+            if (!chunk_reader.Next(timestamp_ms, state) || timestamp_ms != entry.first || state != entry.second) {
+                result.chunk_round_trip_ok = false;
+                break;
+            }
+        }
+
+        try {
+            std::vector<unsigned char> file;
+            {
+                TrajectoryWriter writer(file, i);
+                for (const auto& entry : expected) writer.Add(entry.first, entry.second);
+                writer.Finish();
+            }
+            TrajectoryReader reader(file.data(), file.size());
+            for (const auto& entry : expected) {
+                if (!reader.Next(timestamp_ms, state) || timestamp_ms != entry.first || state != entry.second) {
+                    throw std::runtime_error("trajectory mismatch");
+                }
+            }
+            if (reader.Next(timestamp_ms, state)) throw std::runtime_error("trajectory mismatch");
+
+            // a seek lands on the first snapshot at or after the requested time
+            for (int seek = 0; seek < 20 && !expected.empty(); ++seek) {
+                const uint32_t time_ms = static_cast<uint32_t>(unit(rng) * static_cast<float>(expected.back().first));
+                auto it = std::lower_bound(expected.begin(), expected.end(), time_ms, [](const auto& entry, uint32_t t) {
+                    return entry.first < t;
+                });
+                reader.Seek(time_ms);
+                if (!reader.Next(timestamp_ms, state) || timestamp_ms != it->first || state != it->second) {
+                    throw std::runtime_error("trajectory mismatch");
+                }
+            }
+        } catch (const std::exception&) {
+            result.trajectory_round_trip_ok = false;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <type_traits>
+
+// status flags of an agent snapshot, packed in AgentState::flags
+enum class AgentStateFlag : uint16_t {
+    Alive       = 1 << 0,
+    Dead        = 1 << 1,
+    Knocked     = 1 << 2,
+    Condition   = 1 << 3,
+    DeepWound   = 1 << 4,
+    Bleeding    = 1 << 5,
+    Crippled    = 1 << 6,
+    Blind       = 1 << 7,
+    Poison      = 1 << 8,
+    Hex         = 1 << 9,
+    DegenHex    = 1 << 10,
+    Enchantment = 1 << 11,
+    WeaponSpell = 1 << 12,
+    Holding     = 1 << 13,
+    Casting     = 1 << 14,
+};
+
+// one agent snapshot. fields are grouped by size so the struct has no padding and can be
+// compared bytewise: the position comes first, everything from rotation_angle on is the
+// block compared by SameExceptPosition.
+struct AgentState {
+    // position, compared with a distance threshold
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+
+    float rotation_angle = 0.0f;
+    float health_pct = 0.0f;
+    float move_x = 0.0f;
+    float move_y = 0.0f;
+    float weapon_attack_speed = 0.0f;
+    float attack_speed_modifier = 0.0f;
+    float hp_pips = 0.0f;
+    float animation_speed = 0.0f;
+    float animation_type = 0.0f;
+
+    uint32_t weapon_id = 0;
+    uint32_t model_id = 0;
+    uint32_t gadget_id = 0;
+    uint32_t max_hp = 0;
+    uint32_t skill_id = 0;
+    uint32_t model_state = 0;
+    uint32_t animation_code = 0;
+    uint32_t animation_id = 0;
+    uint32_t in_spirit_range = 0;
+    uint32_t item_id = 0;
+    uint32_t item_extra_type = 0;
+    uint32_t gadget_extra_type = 0;
+
+    uint16_t weapon_item_id = 0;
+    uint16_t offhand_item_id = 0;
+    uint16_t visual_effects = 0;
+    uint16_t weapon_type = 0;
+    uint16_t agent_model_type = 0;
+    uint16_t flags = 0; // AgentStateFlag bits
+
+    uint8_t weapon_item_type = 0;
+    uint8_t offhand_item_type = 0;
+    uint8_t team_id = 0;
+    uint8_t dagger_status = 0;
+
+    bool Has(AgentStateFlag flag) const { return (flags & static_cast<uint16_t>(flag)) != 0; }
+    void Set(AgentStateFlag flag, bool value) {
+        if (value) flags |= static_cast<uint16_t>(flag);
+        else flags &= static_cast<uint16_t>(~static_cast<uint16_t>(flag));
+    }
+
+    // true when everything but x/y/z is identical
+    bool SameExceptPosition(const AgentState& other) const {
+        constexpr size_t kOffset = offsetof(AgentState, rotation_angle);
+        return memcmp(reinterpret_cast<const char*>(this) + kOffset,
+                      reinterpret_cast<const char*>(&other) + kOffset, sizeof(AgentState) - kOffset) == 0;
+    }
+
+    bool operator==(const AgentState& other) const {
+        return memcmp(this, &other, sizeof(AgentState)) == 0;
+    }
+
+    bool operator!=(const AgentState& other) const {
+        return !(*this == other);
+    }
+};
+static_assert(std::is_trivially_copyable_v<AgentState>, "AgentState is stored and compared as raw bytes");
+static_assert(offsetof(AgentState, rotation_angle) == 3 * sizeof(float), "position must come first");
+static_assert(sizeof(AgentState) == 112, "AgentState must stay free of padding for bytewise comparison");
+
+// varint and zigzag helpers shared by the snapshot encodings (AgentStateLog, trajectory files)
+inline void PutVarint(std::vector<uint8_t>& data, uint32_t value) {
+    while (value >= 0x80) {
+        data.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+// reads a varint at offset, returns false if the data ends before it does
+inline bool GetVarint(const uint8_t* data, size_t size, size_t& offset, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && offset < size; shift += 7) {
+        const uint8_t byte = data[offset++];
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// maps a wrapped word difference to a small unsigned value, whichever its sign
+inline uint32_t ZigZag(uint32_t difference) {
+    return (difference << 1) ^ (0u - (difference >> 31));
+}
+
+inline uint32_t UnZigZag(uint32_t value) {
+    return (value >> 1) ^ (0u - (value & 1));
+}
+
+constexpr size_t kAgentStateWordCount = sizeof(AgentState) / sizeof(uint32_t);
+static_assert(sizeof(AgentState) % sizeof(uint32_t) == 0 && kAgentStateWordCount <= 32,
+              "AgentState words must fit in a 32-bit change mask");
+
+// delta of a snapshot against the previous one, shared by AgentStateLog and trajectory files:
+// varint time delta, varint mask of the changed words, then the zigzag varint difference of each changed word
+void PutAgentStateDelta(std::vector<uint8_t>& data, uint32_t time_delta,
+                        const uint32_t (&words)[kAgentStateWordCount], const uint32_t (&last_words)[kAgentStateWordCount]);
+// applies a delta at offset to words, returns false if the data ends inside it
+bool GetAgentStateDelta(const uint8_t* data, size_t size, size_t& offset, uint32_t& time_delta,
+                        uint32_t (&words)[kAgentStateWordCount]);
+
+// snapshots of one agent, delta encoded. every kKeyframeInterval-th snapshot is a keyframe holding
+// the full state and absolute time, the others only store the 32-bit words of AgentState that changed
+// since the previous snapshot, behind a bitmask. most ticks only change a few fields, so this is a
+// fraction of a full AgentState per snapshot.
+class AgentStateLog {
+public:
+    static constexpr size_t kKeyframeInterval = 128;
+    static constexpr size_t kWordCount = kAgentStateWordCount;
+
+    void Append(uint32_t timestamp_ms, const AgentState& state);
+    void Prepend(const AgentStateLog& older); // puts older snapshots back in front of these ones
+    void DropFront(size_t count);             // drops the oldest snapshots, releasing the memory of a whole log
+    void Clear();
+
+    size_t Size() const { return count_; }
+    bool Empty() const { return count_ == 0; }
+    size_t GetEncodedBytes() const { return data_.size() + keyframe_offsets_.size() * sizeof(uint32_t); }
+    size_t GetMemoryBytes() const { return data_.capacity() + keyframe_offsets_.capacity() * sizeof(uint32_t); }
+
+    // decodes snapshots in order, starting at any index. starting on a keyframe is free,
+    // otherwise the snapshots since the previous keyframe are decoded first
+    class Reader {
+    public:
+        explicit Reader(const AgentStateLog& log, size_t first_snapshot = 0);
+        bool Next(uint32_t& timestamp_ms, AgentState& state);
+
+    private:
+        const AgentStateLog& log_;
+        size_t offset_ = 0; // byte offset of the next snapshot
+        size_t index_ = 0;
+        uint32_t timestamp_ms_ = 0;
+        uint32_t words_[kWordCount] = {};
+    };
+
+private:
+    std::vector<uint8_t> data_;              // encoded snapshots, see Append
+    std::vector<uint32_t> keyframe_offsets_; // byte offset of each keyframe in data_
+    size_t count_ = 0;
+    uint32_t last_timestamp_ms_ = 0;
+    AgentState last_state_;
+};
+
+// a run of snapshots as one gzip member for the capture chunk store: every snapshot is a PutAgentStateDelta
+// against the previous one, the first against an all-zero state, so the run has no keyframes for gzip to trip on
+std::vector<unsigned char> PackAgentStateLog(const AgentStateLog& log);
+// appends the snapshots of a packed run to log, throws on corrupted data
+void UnpackAgentStateLog(const std::vector<unsigned char>& packed, AgentStateLog& log);
+
+// in-memory size of a synthetic match stored as full snapshots versus AgentStateLog
+struct AgentLogBenchmarkResult {
+    size_t snapshot_count = 0;
+    size_t full_bytes = 0;  // one (timestamp, AgentState) pair per snapshot, as stored before
+    size_t delta_bytes = 0; // encoded AgentStateLog bytes, both without vector growth slack
+    double encode_ms = 0.0;
+    double decode_ms = 0.0;
+    bool round_trip_ok = false;
+    // the same snapshots through the other encodings: chunks packed for the memory budget, and trajectory
+    // files read back in order and after random seeks. replaces checking every exported file
+    bool chunk_round_trip_ok = false;
+    bool trajectory_round_trip_ok = false;
+};
+
+// simulates a match of duration_minutes with agent_count agents logged like ObserverLoop does
+AgentLogBenchmarkResult RunAgentLogBenchmark(uint32_t duration_minutes = 30, uint32_t agent_count = 40);
@@ -0,0 +1,126 @@
+#include "ObserverAgentStats.h"
+
+#include <thread>
+
+AgentStatTable::~AgentStatTable() {
+    for (auto& block : blocks_) {
+        delete block.load(std::memory_order_relaxed);
+    }
+}
+
+void AgentStatTable::Track(uint32_t agent_id) {
+    if (agent_id > kMaxAgentId) return;
+    std::atomic<Block*>& slot = blocks_[agent_id / kBlockAgents];
+    Block* block = slot.load(std::memory_order_acquire);
+    if (!block) {
+        std::lock_guard<std::mutex> lock(grow_mutex_);
+        block = slot.load(std::memory_order_relaxed);
+        if (!block) {
+            block = new Block();
+            slot.store(block, std::memory_order_release);
+        }
+    }
+    block->entries[agent_id % kBlockAgents].tracked.store(true, std::memory_order_release);
+}
+
+AgentStatTable::Entry* AgentStatTable::find(uint32_t agent_id) const {
+    if (agent_id > kMaxAgentId) return nullptr;
+    Block* block = blocks_[agent_id / kBlockAgents].load(std::memory_order_acquire);
+    if (!block) return nullptr;
+    Entry& entry = block->entries[agent_id % kBlockAgents];
+    return entry.tracked.load(std::memory_order_acquire) ? &entry : nullptr;
+}
+
+uint32_t AgentStatTable::beginWrite(Entry& entry) {
+    // writers are the consumer thread and Clear, they only meet when a match is reset
+    uint32_t sequence = entry.sequence.load(std::memory_order_relaxed);
+    while ((sequence & 1) || !entry.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire,
+                                                                  std::memory_order_relaxed)) {
+        if (sequence & 1) {
+            std::this_thread::yield();
+            sequence = entry.sequence.load(std::memory_order_relaxed);
+        }
+    }
+    std::atomic_thread_fence(std::memory_order_release); // the odd sequence is visible before the values change
+    return sequence + 1;
+}
+
+void AgentStatTable::endWrite(Entry& entry, uint32_t sequence) {
+    entry.sequence.store(sequence + 1, std::memory_order_release);
+}
+
+void AgentStatTable::Bump(uint32_t agent_id, AgentStat stat, long amount) {
+    Entry* entry = find(agent_id);
+    if (!entry) return;
+    std::atomic<int64_t>& value = entry->values[static_cast<size_t>(stat)];
+    const uint32_t sequence = beginWrite(*entry);
+    int64_t next = value.load(std::memory_order_relaxed) + amount;
+    if (stat == AgentStat::TotalDamage && next < 0) next = 0;
+    value.store(next, std::memory_order_relaxed);
+    endWrite(*entry, sequence);
+}
+
+void AgentStatTable::Bump(uint32_t agent_id, std::initializer_list<AgentStat> stats) {
+    Entry* entry = find(agent_id);
+    if (!entry) return;
+    const uint32_t sequence = beginWrite(*entry);
+    for (AgentStat stat : stats) {
+        std::atomic<int64_t>& value = entry->values[static_cast<size_t>(stat)];
+        value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    endWrite(*entry, sequence);
+}
+
+bool AgentStatTable::Read(uint32_t agent_id, AgentCounters& out) const {
+    const Entry* entry = find(agent_id);
+    if (!entry) return false;
+
+    std::array<int64_t, kAgentStatCount> values;
+    for (;;) {
+        const uint32_t before = entry->sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (size_t i = 0; i < kAgentStatCount; ++i) {
+            values[i] = entry->values[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry->sequence.load(std::memory_order_relaxed) == before) break;
+    }
+
+    auto get = [&values](AgentStat stat) { return static_cast<uint32_t>(values[static_cast<size_t>(stat)]); };
+    out.total_damage = static_cast<long>(values[static_cast<size_t>(AgentStat::TotalDamage)]);
+    out.attacks_started = get(AgentStat::AttacksStarted);
+    out.attacks_finished = get(AgentStat::AttacksFinished);
+    out.attacks_stopped = get(AgentStat::AttacksStopped);
+    out.skills_activated = get(AgentStat::SkillsActivated);
+    out.skills_finished = get(AgentStat::SkillsFinished);
+    out.skills_stopped = get(AgentStat::SkillsStopped);
+    out.attack_skills_activated = get(AgentStat::AttackSkillsActivated);
+    out.attack_skills_finished = get(AgentStat::AttackSkillsFinished);
+    out.attack_skills_stopped = get(AgentStat::AttackSkillsStopped);
+    out.interrupted_count = get(AgentStat::Interrupted);
+    out.interrupted_skills_count = get(AgentStat::InterruptedSkills);
+    out.cancelled_attacks_count = get(AgentStat::CancelledAttacks);
+    out.cancelled_skills_count = get(AgentStat::CancelledSkills);
+    out.crits_dealt = get(AgentStat::CritsDealt);
+    out.crits_received = get(AgentStat::CritsReceived);
+    out.deaths = get(AgentStat::Deaths);
+    out.kills = get(AgentStat::Kills);
+    return true;
+}
+
+void AgentStatTable::Clear() {
+    for (auto& slot : blocks_) {
+        Block* block = slot.load(std::memory_order_acquire);
+        if (!block) continue;
+        for (Entry& entry : block->entries) {
+            if (!entry.tracked.load(std::memory_order_relaxed)) continue;
+            entry.tracked.store(false, std::memory_order_relaxed);
+            const uint32_t sequence = beginWrite(entry);
+            for (auto& value : entry.values) value.store(0, std::memory_order_relaxed);
+            endWrite(entry, sequence);
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+
+// per-agent statistics counted by the packet handlers
+enum class AgentStat : uint8_t {
+    TotalDamage, // never goes below 0
+    AttacksStarted,
+    AttacksFinished,
+    AttacksStopped,
+    SkillsActivated,
+    SkillsFinished,
+    SkillsStopped,
+    AttackSkillsActivated,
+    AttackSkillsFinished,
+    AttackSkillsStopped,
+    Interrupted,
+    InterruptedSkills,
+    CancelledAttacks,
+    CancelledSkills,
+    CritsDealt,
+    CritsReceived,
+    Deaths,
+    Kills,
+    Count
+};
+
+constexpr size_t kAgentStatCount = static_cast<size_t>(AgentStat::Count);
+
+// per-agent counters as handed out with AgentInfo
+struct AgentCounters {
+    long total_damage = 0;
+    uint32_t attacks_started = 0;
+    uint32_t attacks_finished = 0;
+    uint32_t attacks_stopped = 0;
+    uint32_t skills_activated = 0;
+    uint32_t skills_finished = 0;
+    uint32_t skills_stopped = 0;
+    uint32_t attack_skills_activated = 0;
+    uint32_t attack_skills_finished = 0;
+    uint32_t attack_skills_stopped = 0;
+    uint32_t interrupted_count = 0;
+    uint32_t interrupted_skills_count = 0;
+    uint32_t cancelled_attacks_count = 0;
+    uint32_t cancelled_skills_count = 0;
+    uint32_t crits_dealt = 0;
+    uint32_t crits_received = 0;
+    uint32_t deaths = 0;
+    uint32_t kills = 0;
+};
+
+// statistics of every tracked agent, bumped without locks by the packet handlers.
+// entries live in blocks reached by agent id and are never moved or freed before the table,
+// so a bump is two loads and a few relaxed atomic adds. each entry is guarded by a seqlock:
+// readers retry until they copied every stat of the entry between two writes, writers never wait
+// for a reader. ids past kMaxAgentId are not counted.
+class AgentStatTable {
+public:
+    static constexpr uint32_t kBlockAgents = 64;
+    static constexpr uint32_t kMaxAgentId = 65535;
+
+    AgentStatTable() = default;
+    ~AgentStatTable();
+
+    AgentStatTable(const AgentStatTable&) = delete;
+    AgentStatTable& operator=(const AgentStatTable&) = delete;
+
+    void Track(uint32_t agent_id); // bumps of the agent are counted from now on
+    void Bump(uint32_t agent_id, AgentStat stat, long amount = 1);
+    void Bump(uint32_t agent_id, std::initializer_list<AgentStat> stats); // each by one, in a single write
+    bool Read(uint32_t agent_id, AgentCounters& out) const; // false for agents that are not tracked
+    void Clear(); // forgets every agent and zeroes their stats, the blocks are kept for the next match
+
+private:
+    struct Entry {
+        std::atomic<uint32_t> sequence{0}; // odd while a write is in progress
+        std::atomic<bool> tracked{false};
+        std::array<std::atomic<int64_t>, kAgentStatCount> values{};
+    };
+    struct Block {
+        std::array<Entry, kBlockAgents> entries;
+    };
+
+    Entry* find(uint32_t agent_id) const; // nullptr for agents that are not tracked
+    static uint32_t beginWrite(Entry& entry);
+    static void endWrite(Entry& entry, uint32_t sequence);
+
+    std::array<std::atomic<Block*>, (kMaxAgentId + 1) / kBlockAgents> blocks_{};
+    std::mutex grow_mutex_; // serializes block allocation
+};
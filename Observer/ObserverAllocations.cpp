@@ -0,0 +1,70 @@
+#include "ObserverAllocations.h"
+
+#ifdef OBSERVER_COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+namespace {
+    thread_local uint64_t thread_allocations = 0;
+    thread_local uint32_t uncounted_depth = 0;
+}
+
+// the array and nothrow forms of the standard library call these
+void* operator new(size_t size) {
+    if (uncounted_depth == 0) ++thread_allocations;
+    if (void* memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+uint64_t GetThreadAllocationCount() {
+    return thread_allocations;
+}
+
+UncountedAllocations::UncountedAllocations() {
+    ++uncounted_depth;
+}
+
+UncountedAllocations::~UncountedAllocations() {
+    --uncounted_depth;
+}
+
+SeenKeySet::SeenKeySet() : slots_(new uint64_t[kSlotCount]()) {}
+
+bool SeenKeySet::Insert(uint64_t key) {
+    if (key == 0) key = 1;
+    // fibonacci hashing spreads keys that only differ in their low bits
+    size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 48) & (kSlotCount - 1);
+    while (slots_[slot] != 0) {
+        if (slots_[slot] == key) return false;
+        slot = (slot + 1) & (kSlotCount - 1);
+    }
+    if (size_ >= kSlotCount / 2) return true; // full: treated as new, never as replayed
+    slots_[slot] = key;
+    ++size_;
+    return true;
+}
+
+void SeenKeySet::Clear() {
+    for (size_t i = 0; i < kSlotCount; ++i) slots_[i] = 0;
+    size_ = 0;
+}
+#else
+uint64_t GetThreadAllocationCount() {
+    return 0;
+}
+
+UncountedAllocations::UncountedAllocations() {}
+UncountedAllocations::~UncountedAllocations() {}
+
+SeenKeySet::SeenKeySet() {}
+bool SeenKeySet::Insert(uint64_t) { return true; }
+void SeenKeySet::Clear() {}
+#endif
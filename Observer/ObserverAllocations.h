@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// allocation counting for the capture benchmarks. building with OBSERVER_COUNT_ALLOCATIONS replaces the
+// global operator new of the plugin with one counting calls per thread, otherwise nothing is counted.
+#ifdef OBSERVER_COUNT_ALLOCATIONS
+constexpr bool kCountAllocations = true;
+#else
+constexpr bool kCountAllocations = false;
+#endif
+
+uint64_t GetThreadAllocationCount(); // operator new calls made by the calling thread so far
+
+// allocations the calling thread makes while one is alive are not counted, for the few a packet is
+// expected to make by design (a death keeps its own message in the capture text pool)
+class UncountedAllocations {
+public:
+    UncountedAllocations();
+    ~UncountedAllocations();
+
+    UncountedAllocations(const UncountedAllocations&) = delete;
+    UncountedAllocations& operator=(const UncountedAllocations&) = delete;
+};
+
+// keys of the work already done once, for the steady-state check: work seen before must not allocate
+// again. an open-addressing table allocated up front (only with OBSERVER_COUNT_ALLOCATIONS), so remembering
+// a key allocates nothing. once the table is half full new keys are no longer remembered.
+class SeenKeySet {
+public:
+    static constexpr size_t kSlotCount = 1 << 16;
+
+    SeenKeySet();
+    bool Insert(uint64_t key); // false if the key was already in the set
+    void Clear();
+
+private:
+    std::unique_ptr<uint64_t[]> slots_; // 0 marks an empty slot, a key of 0 is stored as 1
+    size_t size_ = 0;
+};
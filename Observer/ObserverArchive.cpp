@@ -0,0 +1,281 @@
+#include <windows.h>
+#include "ObserverArchive.h"
+
+#include <zlib.h>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    constexpr char kArchiveMagic[4] = {'O', 'B', 'S', 'M'};
+    constexpr uint16_t kArchiveVersion = 1;
+    constexpr size_t kHeaderSize = 24;    // magic, version, reserved, toc offset, toc entry count, reserved
+    constexpr size_t kNameSize = 64;      // nul padded, so names are at most 63 bytes
+    constexpr size_t kTocEntrySize = 88;  // name, offset, size, crc32, codec, reserved
+    constexpr uint64_t kAlignment = 8;    // streams and the toc start on 8 byte boundaries
+    constexpr size_t kCopyBufferSize = 1 << 20; // spilled streams are copied into the archive 1 MB at a time
+
+    // the file is little endian whatever the host
+    void PutU16(uint8_t* data, uint16_t value) {
+        for (int i = 0; i < 2; ++i) data[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    void PutU32(uint8_t* data, uint32_t value) {
+        for (int i = 0; i < 4; ++i) data[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    void PutU64(uint8_t* data, uint64_t value) {
+        for (int i = 0; i < 8; ++i) data[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    uint16_t GetU16(const uint8_t* data) {
+        return static_cast<uint16_t>(data[0] | (data[1] << 8));
+    }
+
+    uint32_t GetU32(const uint8_t* data) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) value |= static_cast<uint32_t>(data[i]) << (8 * i);
+        return value;
+    }
+
+    uint64_t GetU64(const uint8_t* data) {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) value |= static_cast<uint64_t>(data[i]) << (8 * i);
+        return value;
+    }
+
+    uint32_t ComputeCrc32(const uint8_t* data, uint64_t size) {
+        uLong crc = crc32(0L, Z_NULL, 0);
+        while (size > 0) {
+            const uInt part = static_cast<uInt>(std::min<uint64_t>(size, UINT_MAX));
+            crc = crc32(crc, data, part);
+            data += part;
+            size -= part;
+        }
+        return static_cast<uint32_t>(crc);
+    }
+
+    void WriteHeader(uint8_t* header, uint64_t toc_offset, uint32_t entry_count) {
+        memset(header, 0, kHeaderSize);
+        memcpy(header, kArchiveMagic, 4);
+        PutU16(header + 4, kArchiveVersion);
+        PutU64(header + 8, toc_offset);
+        PutU32(header + 16, entry_count);
+    }
+}
+
+ObserverArchiveWriter::ObserverArchiveWriter(const std::filesystem::path& path)
+    : path_(path), temp_path_(path), spill_path_(path) {
+    temp_path_ += ".tmp";
+    spill_path_ += ".streams.tmp";
+    file_.open(temp_path_, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!file_.is_open()) {
+        throw std::runtime_error("File opening error.");
+    }
+    spill_file_.open(spill_path_, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+    if (!spill_file_.is_open()) {
+        file_.close();
+        std::error_code ec;
+        std::filesystem::remove(temp_path_, ec);
+        throw std::runtime_error("File opening error.");
+    }
+
+    // placeholder, the real header is written by Finish once the toc offset is known
+    uint8_t header[kHeaderSize];
+    WriteHeader(header, 0, 0);
+    file_.write(reinterpret_cast<const char*>(header), kHeaderSize);
+    offset_ = kHeaderSize;
+}
+
+ObserverArchiveWriter::~ObserverArchiveWriter() {
+    std::error_code ec;
+    if (spill_file_.is_open()) spill_file_.close();
+    std::filesystem::remove(spill_path_, ec);
+    if (finished_) return;
+    // an export that failed halfway leaves no partial archive behind
+    file_.close();
+    std::filesystem::remove(temp_path_, ec);
+}
+
+void ObserverArchiveWriter::AddStream(std::string_view name, ArchiveCodec codec, std::vector<unsigned char> data) {
+    if (name.empty() || name.size() >= kNameSize) {
+        throw std::runtime_error("Invalid archive stream name.");
+    }
+    // the checksum is computed outside the lock, export jobs only wait on each other to queue the stream
+    ArchiveEntry entry;
+    entry.name = name;
+    entry.codec = codec;
+    entry.size = data.size();
+    entry.crc32 = ComputeCrc32(data.data(), data.size());
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (finished_) {
+        throw std::runtime_error("Archive is already finished.");
+    }
+    // spilled in arrival order, Finish puts them in name order
+    spill_file_.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    if (!spill_file_) {
+        throw std::runtime_error("File writing error.");
+    }
+    spill_offsets_.push_back(spill_offset_);
+    spill_offset_ += data.size();
+    entries_.push_back(std::move(entry));
+}
+
+void ObserverArchiveWriter::Finish() {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (finished_) return;
+
+    // streams arrive in whatever order the jobs finish, they are written by name so the archive
+    // doesn't depend on thread timing, and the toc is sorted for readers to binary search it
+    std::vector<size_t> order(entries_.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(),
+              [this](size_t a, size_t b) { return entries_[a].name < entries_[b].name; });
+    for (size_t i = 1; i < order.size(); ++i) {
+        if (entries_[order[i]].name == entries_[order[i - 1]].name) {
+            throw std::runtime_error("Duplicate archive stream name.");
+        }
+    }
+
+    spill_file_.flush();
+    if (!spill_file_) {
+        throw std::runtime_error("File writing error.");
+    }
+
+    static const char kPadding[kAlignment] = {};
+    std::vector<char> buffer(kCopyBufferSize);
+    std::vector<ArchiveEntry> sorted_entries;
+    sorted_entries.reserve(entries_.size());
+    for (size_t index : order) {
+        const uint64_t padding = (kAlignment - offset_ % kAlignment) % kAlignment;
+        file_.write(kPadding, static_cast<std::streamsize>(padding));
+        offset_ += padding;
+
+        ArchiveEntry& entry = entries_[index];
+        spill_file_.seekg(static_cast<std::streamoff>(spill_offsets_[index]));
+        for (uint64_t left = entry.size; left > 0;) {
+            const size_t part = static_cast<size_t>(std::min<uint64_t>(left, buffer.size()));
+            spill_file_.read(buffer.data(), static_cast<std::streamsize>(part));
+            if (!spill_file_) {
+                throw std::runtime_error("File reading error.");
+            }
+            file_.write(buffer.data(), static_cast<std::streamsize>(part));
+            if (!file_) {
+                throw std::runtime_error("File writing error.");
+            }
+            left -= part;
+        }
+
+        entry.offset = offset_;
+        offset_ += entry.size;
+        sorted_entries.push_back(std::move(entry));
+    }
+    entries_ = std::move(sorted_entries);
+    spill_offsets_.clear();
+    spill_file_.close();
+
+    const uint64_t padding = (kAlignment - offset_ % kAlignment) % kAlignment;
+    const uint64_t toc_offset = offset_ + padding;
+    std::vector<uint8_t> toc(padding + entries_.size() * kTocEntrySize, 0);
+    uint8_t* out = toc.data() + padding;
+    for (const ArchiveEntry& entry : entries_) {
+        memcpy(out, entry.name.data(), entry.name.size());
+        PutU64(out + kNameSize, entry.offset);
+        PutU64(out + kNameSize + 8, entry.size);
+        PutU32(out + kNameSize + 16, entry.crc32);
+        out[kNameSize + 20] = static_cast<uint8_t>(entry.codec);
+        out += kTocEntrySize;
+    }
+    file_.write(reinterpret_cast<const char*>(toc.data()), static_cast<std::streamsize>(toc.size()));
+
+    uint8_t header[kHeaderSize];
+    WriteHeader(header, toc_offset, static_cast<uint32_t>(entries_.size()));
+    file_.seekp(0);
+    file_.write(reinterpret_cast<const char*>(header), kHeaderSize);
+    file_.close();
+    // check for stream errors after closing.
+    if (!file_) {
+        throw std::runtime_error("File writing error.");
+    }
+
+    std::filesystem::rename(temp_path_, path_); // replaces an archive of the same name
+    finished_ = true;
+}
+
+ObserverArchiveReader::ObserverArchiveReader(const std::filesystem::path& path) {
+    HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("File opening error.");
+    }
+    file_handle_ = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || static_cast<uint64_t>(size.QuadPart) < kHeaderSize) {
+        CloseHandle(file);
+        throw std::runtime_error("Archive is truncated.");
+    }
+    file_size_ = static_cast<uint64_t>(size.QuadPart);
+
+    mapping_handle_ = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle_) {
+        view_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (!view_) {
+        if (mapping_handle_) CloseHandle(mapping_handle_);
+        CloseHandle(file);
+        throw std::runtime_error("File mapping error.");
+    }
+
+    // the destructor doesn't run when the constructor throws, release the mapping here
+    try {
+        if (memcmp(view_, kArchiveMagic, 4) != 0 || GetU16(view_ + 4) != kArchiveVersion) {
+            throw std::runtime_error("Not a supported match archive.");
+        }
+        const uint64_t toc_offset = GetU64(view_ + 8);
+        const uint32_t entry_count = GetU32(view_ + 16);
+        if (toc_offset < kHeaderSize || toc_offset > file_size_ ||
+            (file_size_ - toc_offset) / kTocEntrySize < entry_count) {
+            throw std::runtime_error("Archive table of contents is corrupted.");
+        }
+
+        entries_.resize(entry_count);
+        const uint8_t* in = view_ + toc_offset;
+        for (ArchiveEntry& entry : entries_) {
+            const char* name = reinterpret_cast<const char*>(in);
+            entry.name.assign(name, strnlen(name, kNameSize - 1));
+            entry.offset = GetU64(in + kNameSize);
+            entry.size = GetU64(in + kNameSize + 8);
+            entry.crc32 = GetU32(in + kNameSize + 16);
+            entry.codec = static_cast<ArchiveCodec>(in[kNameSize + 20]);
+            if (entry.offset > toc_offset || entry.size > toc_offset - entry.offset) {
+                throw std::runtime_error("Archive table of contents is corrupted.");
+            }
+            in += kTocEntrySize;
+        }
+    } catch (...) {
+        UnmapViewOfFile(view_);
+        CloseHandle(mapping_handle_);
+        CloseHandle(file_handle_);
+        throw;
+    }
+}
+
+ObserverArchiveReader::~ObserverArchiveReader() {
+    UnmapViewOfFile(view_);
+    CloseHandle(mapping_handle_);
+    CloseHandle(file_handle_);
+}
+
+const ArchiveEntry* ObserverArchiveReader::Find(std::string_view name) const {
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), name,
+                               [](const ArchiveEntry& entry, std::string_view value) { return entry.name < value; });
+    if (it == entries_.end() || it->name != name) return nullptr;
+    return &*it;
+}
+
+bool ObserverArchiveReader::Verify(const ArchiveEntry& entry) const {
+    return ComputeCrc32(GetData(entry), entry.size) == entry.crc32;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+// single-file match archive (captures/<name>.obsm), layout in Docs/EXPORTS_CONVENTIONS.md.
+// holds every stream of an export (infos.json, StoC and Agents files) back to back, followed by
+// a table of contents sorted by name with offsets, sizes, codecs and crc32 checksums, so a reader
+// can map the file and reach any stream without unpacking anything.
+
+enum class ArchiveCodec : uint8_t {
+    Stored, // raw bytes (infos.json, .traj files which compress their own blocks)
+    Gzip,   // one or more gzip members, exactly like the .txt.gz files of a folder export
+};
+
+struct ArchiveEntry {
+    std::string name;   // relative path with forward slashes, e.g. "StoC/skill_events.txt.gz"
+    ArchiveCodec codec = ArchiveCodec::Stored;
+    uint64_t offset = 0; // from the start of the file
+    uint64_t size = 0;
+    uint32_t crc32 = 0;  // of the stored bytes
+};
+
+// writes an archive. streams may be added from several export jobs at once, each is spilled to
+// <path>.streams.tmp as it arrives and Finish copies them sorted by name, so the same export always
+// produces the same bytes while memory holds no more than one copy buffer. the archive is written to
+// <path>.tmp and only renamed once complete, so a failed export leaves no archive behind.
+class ObserverArchiveWriter {
+public:
+    explicit ObserverArchiveWriter(const std::filesystem::path& path); // throws if the file can't be created
+    ~ObserverArchiveWriter();
+
+    ObserverArchiveWriter(const ObserverArchiveWriter&) = delete;
+    ObserverArchiveWriter& operator=(const ObserverArchiveWriter&) = delete;
+
+    // throws on invalid names, spill errors or once finished. the data is released once spilled
+    void AddStream(std::string_view name, ArchiveCodec codec, std::vector<unsigned char> data);
+    void Finish(); // writes the streams and the table of contents, then moves the archive in place. throws on write errors
+
+private:
+    std::filesystem::path path_;
+    std::filesystem::path temp_path_;
+    std::mutex write_mutex_; // export jobs add streams concurrently
+    std::filesystem::path spill_path_;
+    std::ofstream file_;
+    std::fstream spill_file_; // streams in arrival order until Finish
+    uint64_t offset_ = 0;
+    uint64_t spill_offset_ = 0;
+    std::vector<ArchiveEntry> entries_;
+    std::vector<uint64_t> spill_offsets_; // by entry
+    bool finished_ = false;
+};
+
+// memory-maps an archive and gives zero-copy access to its streams
+class ObserverArchiveReader {
+public:
+    explicit ObserverArchiveReader(const std::filesystem::path& path); // throws on missing or malformed archives
+    ~ObserverArchiveReader();
+
+    ObserverArchiveReader(const ObserverArchiveReader&) = delete;
+    ObserverArchiveReader& operator=(const ObserverArchiveReader&) = delete;
+
+    const std::vector<ArchiveEntry>& GetEntries() const { return entries_; }
+    const ArchiveEntry* Find(std::string_view name) const; // binary search over the sorted table of contents
+    const uint8_t* GetData(const ArchiveEntry& entry) const { return view_ + entry.offset; }
+    bool Verify(const ArchiveEntry& entry) const; // checks the stream against its crc32
+
+private:
+    void* file_handle_ = nullptr;
+    void* mapping_handle_ = nullptr;
+    const uint8_t* view_ = nullptr;
+    uint64_t file_size_ = 0;
+    std::vector<ArchiveEntry> entries_;
+};
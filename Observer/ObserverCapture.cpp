@@ -1,6 +1,11 @@
 #include <windows.h>
 #include "ObserverCapture.h"
 #include "ObserverStoC.h"
+#include "ObserverCompression.h"
+#include "ObserverStream.h"
+#include "ObserverArchive.h"
+#include "ObserverExport.h"
+#include "ObserverChunks.h"
 
 #include <GWCA/Managers/MapMgr.h>
 #include <GWCA/Managers/ChatMgr.h>
@@ -13,126 +18,341 @@
 #include <vector>
 #include <string>
 #include <sstream> 
-#include <zlib.h>  
 #include <stdexcept>    
 #include <map>
-
-ObserverCapture::ObserverCapture() {
+#include <algorithm>
+
+// streaming: number of unsealed events that triggers a chunk, and how recent events are kept in memory
+// (death messages get their decoded name patched in shortly after the event)
+constexpr size_t kStreamChunkEvents = 8192;
+constexpr uint32_t kStreamHoldbackMs = 3000;
+constexpr uint32_t kStreamSealRetryMs = 1000;
+// not streaming: events of a category sealed into one compressed chunk (112 KB of records)
+constexpr size_t kCaptureChunkEvents = 4096;
+// events a live category is sized for: twice the sealing threshold of either mode, the consumer keeps
+// appending while the sealer works, and a streamed category can hold nearly every unsealed event
+constexpr size_t kReservedCategoryEvents = std::max(kCaptureChunkEvents, kStreamChunkEvents) * 2;
+// pool blocks for the worst of both modes: every category at twice a chunk, or the streamed events
+// of one category plus a partly filled block in each of the others
+constexpr size_t kReservedCaptureBlocks = std::max(
+    kCaptureCategoryCount * (kCaptureChunkEvents * 2 / CaptureSegment::kBlockEvents + 1),
+    kReservedCategoryEvents / CaptureSegment::kBlockEvents + kCaptureCategoryCount);
+// events rendered between two cancellation checks of an export
+constexpr size_t kCancelCheckEvents = 4096;
+// unknown-category lines start with this marker, the only one left since categories are resolved at ingest
+constexpr wchar_t kUnknownEventMarker[] = L"[AST] ";
+
+ObserverCapture::ObserverCapture()
+    : chunks(std::make_shared<CaptureChunkStore>()) {
+    // the first match then allocates nothing per event, streamed or not
+    ReserveCaptureBlocks(kReservedCaptureBlocks);
+    for (CaptureSegment& events : category_events) events.reserve(kReservedCategoryEvents);
+    seal_buffer.reserve(kCaptureChunkEvents);
+    sealer = std::thread(&ObserverCapture::sealerLoop, this);
 }
 
-void ObserverCapture::AddLogEntry(const wchar_t* entry) {
-    uint32_t instance_time_ms = GW::Map::GetInstanceTime();
-    uint32_t total_seconds = instance_time_ms / 1000;
-    uint32_t minutes = total_seconds / 60;
-    uint32_t seconds = total_seconds % 60;
+ObserverCapture::~ObserverCapture() {
+    {
+        std::lock_guard<std::mutex> lock(sealer_mutex);
+        sealer_stopping = true;
+    }
+    sealer_wake.notify_one();
+    if (sealer.joinable()) sealer.join();
+}
 
-    // format the timestamp as [mm:ss]
-    wchar_t timestamp[32];
-    swprintf(timestamp, 32, L"[%02u:%02u] ", minutes, seconds);
+void ObserverCapture::AddEvents(const CaptureEvent* added, size_t count, CaptureCategory category) {
+    // the records are already stamped with the instance time by the StoC handler.
+    // sealing is only requested here, the consumer thread never packs or writes
+    if (count == 0) return;
+    bool should_seal = false;
+    bool should_seal_chunk = false;
+    {
+        std::lock_guard<std::shared_mutex> lock(events_mutex);
+        CaptureSegment& events = category_events[static_cast<size_t>(category)];
+        for (size_t i = 0; i < count; ++i) {
+            events.push_back(added[i]);
+            // numbered under the lock, so the order is the one of the segments whichever thread adds
+            events.back().sequence = next_sequence++;
+        }
+        event_count += count;
+        const uint32_t time_ms = added[count - 1].time_ms;
+        newest_time_ms = time_ms;
+        const bool streaming = stream && stream->IsActive();
+        should_seal = streaming &&
+                      event_count >= kStreamChunkEvents &&
+                      time_ms >= last_seal_time_ms + kStreamSealRetryMs;
+        if (should_seal) last_seal_time_ms = time_ms;
+        should_seal_chunk = !streaming && !chunk_sealing_failed && events.size() > kCaptureChunkEvents;
+    }
 
-    // add timestamped entry (with its prepended marker) to the log
-    std::wstring log_entry = timestamp;
-    log_entry += entry; // entry already contains the marker, e.g. "[skl] skill activated..."
-    match_log_entries.push_back(log_entry);
+    if (should_seal || should_seal_chunk) {
+        {
+            std::lock_guard<std::mutex> lock(sealer_mutex);
+            if (should_seal) stream_seal_requested = true;
+            if (should_seal_chunk) chunk_seal_requested = true;
+        }
+        sealer_wake.notify_one();
+    }
 }
 
-void ObserverCapture::ClearLogs() {
-    // clear the log entries
-    match_log_entries.clear();
-    GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, L"Observer logs cleared.");
+void ObserverCapture::sealerLoop() {
+    std::unique_lock<std::mutex> lock(sealer_mutex);
+    while (true) {
+        sealer_wake.wait(lock, [this]() {
+            return sealer_stopping || chunk_seal_requested || stream_seal_requested;
+        });
+        if (sealer_stopping) return;
+        const bool seal_chunks = chunk_seal_requested;
+        const bool seal_stream = stream_seal_requested;
+        chunk_seal_requested = false;
+        stream_seal_requested = false;
+        lock.unlock();
+
+        if (seal_chunks) sealChunks();
+        if (seal_stream) sealEvents();
+        lock.lock();
+    }
 }
 
-// helper function to compress data using zlib (gzip format)
-// returns a vector of bytes containing the compressed data
-std::vector<unsigned char> compress_gzip(const std::string& data) {
-    if (data.empty()) {
-        return {}; // return empty vector if input is empty
+void ObserverCapture::sealChunks() {
+    try {
+        for (size_t c = 0; c < kCaptureCategoryCount; ++c) {
+            while (sealChunk(static_cast<CaptureCategory>(c))) {}
+        }
+        CaptureChunkStore::SpillOverBudget();
+    } catch (const std::exception& e) {
+        {
+            std::lock_guard<std::shared_mutex> lock(events_mutex);
+            chunk_sealing_failed = true;
+        }
+        PostExportError("Capture chunk sealing stopped, events stay uncompressed: ", e.what());
     }
+}
 
-    z_stream zs;
-    memset(&zs, 0, sizeof(zs));
+CaptureTextRef ObserverCapture::AddText(const wchar_t* text) {
+    std::lock_guard<std::shared_mutex> lock(events_mutex);
+    match_text_pool.emplace_back(text ? text : L"");
+    return {static_cast<uint32_t>(match_text_pool.size() - 1), text_generation};
+}
 
-    // initialize for gzip compression (windowbits = 15 + 16 for gzip header)
-    if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
-        throw(std::runtime_error("deflateInit2 failed while compressing."));
+void ObserverCapture::SetText(const CaptureTextRef& text_ref, const wchar_t* text) {
+    std::lock_guard<std::shared_mutex> lock(events_mutex);
+    // the pool may have been cleared, or handed to a retired match and refilled, since the index was handed out
+    if (text_ref.generation == text_generation && text_ref.index < match_text_pool.size()) {
+        match_text_pool[text_ref.index] = text ? text : L"";
     }
+}
 
-    zs.next_in = (Bytef*)data.data();
-    zs.avail_in = data.size();
-
-    int ret;
-    std::vector<unsigned char> outbuffer(32768); // start with a reasonable buffer size
-    std::vector<unsigned char> compressed_data;
-
-    do {
-        zs.next_out = outbuffer.data();
-        zs.avail_out = outbuffer.size();
+void ObserverCapture::ClearLogs() {
+    // clear the recorded events and their text pool
+    {
+        std::lock_guard<std::mutex> seal_lock(seal_mutex);
+        std::lock_guard<std::shared_mutex> lock(events_mutex);
+        for (CaptureSegment& events : category_events) events.clear();
+        event_count = 0;
+        newest_time_ms = 0;
+        next_sequence = 0;
+        match_text_pool.clear();
+        ++text_generation;
+        sealed_event_count = 0;
+        last_seal_time_ms = 0;
+        chunk_sealing_failed = false;
+        chunks = std::make_shared<CaptureChunkStore>();
+    }
+    GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, L"Observer logs cleared.");
+}
 
-        // perform the compression step, z_finish indicates the last block of input.
-        ret = deflate(&zs, Z_FINISH);
+void ObserverCapture::SetStream(std::shared_ptr<ObserverStream> stream_handler) {
+    std::lock_guard<std::mutex> seal_lock(seal_mutex); // a running seal finishes with the stream it started on
+    std::lock_guard<std::shared_mutex> lock(events_mutex);
+    stream = std::move(stream_handler);
+    sealed_event_count = 0;
+    last_seal_time_ms = 0;
+}
 
-        if (ret != Z_STREAM_END && ret != Z_OK && ret != Z_BUF_ERROR) {
-             deflateEnd(&zs);
-             throw(std::runtime_error("exception during gzip compression: deflate failed (" + std::to_string(ret) + ")"));
-        }
+size_t CaptureSnapshot::GetEventCount() const {
+    size_t count = chunk_event_count;
+    for (const CaptureSegment& category : events) count += category.size();
+    return count;
+}
 
-        size_t have = outbuffer.size() - zs.avail_out;
-        if (have > 0) {
-            compressed_data.insert(compressed_data.end(), outbuffer.data(), outbuffer.data() + have);
+// renders the events of one category as timestamped lines into sink.
+// checks for cancellation now and then when an export progress is given.
+static void RenderCategory(CaptureCategory category, const CaptureSegment& events,
+                           const std::vector<std::wstring>& text_pool, GzipSink& sink, const ExportProgress* progress) {
+    wchar_t line_buffer[385]; // one extra for the newline
+
+    for (size_t i = 0; i < events.size(); ++i) {
+        if (progress && i % kCancelCheckEvents == 0) progress->ThrowIfCancelled();
+
+        const CaptureEvent& event = events[i];
+        // a LordDamage record and its totals are emitted back to back, so they share a segment
+        const CaptureEvent* continuation = (i + 1 < events.size()) ? &events[i + 1] : nullptr;
+
+        // format the timestamp as [mm:ss.mmm #sequence], the sequence restores the order across files
+        uint32_t total_seconds = event.time_ms / 1000;
+        int prefix_len = swprintf(line_buffer, 384, L"[%02u:%02u.%03u #%u] ", total_seconds / 60, total_seconds % 60,
+                                  event.time_ms % 1000, event.sequence);
+        if (prefix_len <= 0) continue;
+
+        if (category == CaptureCategory::Unknown) {
+            // unknown events keep their marker, as they always did
+            int marker_len = swprintf(line_buffer + prefix_len, 384 - prefix_len, L"%ls", kUnknownEventMarker);
+            if (marker_len > 0) prefix_len += marker_len;
         }
 
-    } while (zs.avail_out == 0); // continue if the buffer was filled
+        int message_len = FormatCaptureEvent(event, continuation, &text_pool,
+                                             line_buffer + prefix_len, 384 - prefix_len);
+        if (message_len <= 0) continue; // continuation records have no line of their own
 
-    // check if deflation stream finished properly.
-     if (ret != Z_STREAM_END) {
-         // z_finish should lead to z_stream_end. if not, it might indicate an issue,
-         // but cleanup with deflateend is generally sufficient.
-     }
+        line_buffer[prefix_len + message_len] = L'\n';
+        sink.Write(line_buffer, prefix_len + message_len + 1);
+    }
+}
 
-    deflateEnd(&zs);
+// renders the snapshot's sealed chunks of a category, then its events still in memory
+static void RenderSnapshotCategory(CaptureCategory category, const CaptureSnapshot& snapshot,
+                                   GzipSink& sink, const ExportProgress* progress) {
+    const size_t c = static_cast<size_t>(category);
+    for (size_t i = 0; i < snapshot.chunk_counts[c]; ++i) {
+        if (progress) progress->ThrowIfCancelled();
+        RenderCategory(category, snapshot.chunks->Load(category, i), snapshot.text_pool, sink, progress);
+    }
+    RenderCategory(category, snapshot.events[c], snapshot.text_pool, sink, progress);
+}
 
-    return compressed_data;
+// packs the oldest full run of a category into a chunk and drops it from memory.
+// records stay raw, so unlike streamed chunks there is no holdback for late death message names
+bool ObserverCapture::sealChunk(CaptureCategory category) {
+    std::lock_guard<std::mutex> seal_lock(seal_mutex); // detach and clear wait for the chunk to be in
+    const size_t c = static_cast<size_t>(category);
+    size_t count = 0;
+    {
+        // a plain copy into the reserved buffer, the consumer appends again as soon as it is done
+        std::shared_lock<std::shared_mutex> lock(events_mutex);
+        const CaptureSegment& events = category_events[c];
+        if (chunk_sealing_failed || (stream && stream->IsActive()) || events.size() <= kCaptureChunkEvents) return false;
+        count = kCaptureChunkEvents;
+        // never split a LordDamage record from its totals continuation, chunks are rendered one by one
+        if (events[count - 1].kind == CaptureEventKind::LordDamage) --count;
+        seal_buffer.clear();
+        for (size_t i = 0; i < count; ++i) seal_buffer.push_back(events[i]);
+    }
+    std::vector<unsigned char> packed = PackCaptureEvents(seal_buffer.data(), count);
+
+    // events only leave the front while seal_mutex is held, so the copied run is still there.
+    // the chunk and the erase land together, a snapshot sees the events in exactly one of them
+    std::lock_guard<std::shared_mutex> lock(events_mutex);
+    chunks->Append(category, std::move(packed), count);
+    category_events[c].erase_front(count);
+    event_count -= count;
+    return true;
 }
 
-// helper to convert wstring to utf-8 string
-std::string WStringToUTF8(const std::wstring& wstr) {
-    if (wstr.empty()) return std::string();
-    int size_needed = WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), NULL, 0, NULL, NULL);
-    if (size_needed <= 0) {
-        throw std::runtime_error("WideCharToMultiByte failed to get size for UTF-8 conversion.");
+// writes the oldest events to the stream as one gzip member per category and drops them from memory.
+// the events are only dropped once every category was appended, on write errors they stay in memory
+void ObserverCapture::sealEvents() {
+    std::lock_guard<std::mutex> seal_lock(seal_mutex); // detach waits for the chunks to be in
+
+    // copy the range to seal, so rendering never holds the consumer thread back
+    std::shared_ptr<ObserverStream> target;
+    CaptureSnapshot pending;
+    size_t total = 0;
+    {
+        std::shared_lock<std::shared_mutex> lock(events_mutex);
+        if (!stream || !stream->IsActive()) return;
+        target = stream;
+        for (size_t c = 0; c < kCaptureCategoryCount; ++c) {
+            const CaptureSegment& events = category_events[c];
+            size_t count = events.size();
+            while (count > 0 && events[count - 1].time_ms + kStreamHoldbackMs > newest_time_ms) {
+                --count;
+            }
+            // never split a LordDamage record from its totals continuation
+            if (count > 0 && events[count - 1].kind == CaptureEventKind::LordDamage) {
+                --count;
+            }
+            pending.events[c].assign(events, count);
+            total += count;
+        }
+        if (total > 0) pending.text_pool = match_text_pool;
+    }
+    if (total == 0) return;
+
+    // render and compress the categories in parallel, appends are serialized by the stream
+    std::vector<std::function<void()>> jobs;
+    for (size_t c = 0; c < kCaptureCategoryCount; ++c) {
+        if (pending.events[c].empty()) continue;
+        jobs.push_back([&target, &pending, c]() {
+            const CaptureCategory category = static_cast<CaptureCategory>(c);
+            std::vector<unsigned char> chunk;
+            GzipSink sink(chunk);
+            RenderCategory(category, pending.events[c], pending.text_pool, sink, nullptr);
+            sink.Finish();
+
+            std::filesystem::path file_path = std::filesystem::path("StoC") / GetCaptureCategoryFileName(category);
+            target->Append(file_path, chunk);
+        });
+    }
+    try {
+        RunParallelJobs(jobs);
+    } catch (const std::exception& e) {
+        target->End();
+        PostExportError("Capture streaming stopped, events stay in memory: ", e.what());
+        return;
     }
-    std::string strTo(size_needed, 0);
-    int bytes_converted = WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), &strTo[0], size_needed, NULL, NULL);
-    if (bytes_converted <= 0) {
-         throw std::runtime_error("WideCharToMultiByte failed during UTF-8 conversion.");
+
+    std::lock_guard<std::shared_mutex> lock(events_mutex);
+    for (size_t c = 0; c < kCaptureCategoryCount; ++c) {
+        category_events[c].erase_front(pending.events[c].size());
     }
-    return strTo;
+    event_count -= total;
+    sealed_event_count += total;
 }
 
-// helper to write compressed data to a file
-void WriteCompressedFile(const std::filesystem::path& path, const std::vector<unsigned char>& data) {
-    if (data.empty()) return; // don't write empty files
+CaptureSnapshot ObserverCapture::TakeSnapshot() const {
+    CaptureSnapshot snapshot;
+    std::shared_lock<std::shared_mutex> lock(events_mutex);
+    for (size_t c = 0; c < kCaptureCategoryCount; ++c) {
+        snapshot.events[c] = category_events[c];
+        snapshot.chunk_counts[c] = chunks->GetChunkCount(static_cast<CaptureCategory>(c));
+    }
+    snapshot.text_pool = match_text_pool;
+    snapshot.chunks = chunks;
+    snapshot.chunk_event_count = chunks->GetEventCount();
+    return snapshot;
+}
 
-    std::ofstream outfile(path, std::ios::binary | std::ios::out);
-    if (!outfile.is_open()) {
-         std::wstring error_msg = L"Failed to open output file for writing: ";
-         error_msg += path.wstring();
-         // throw to be caught by the main export function's try-catch block.
-         throw std::runtime_error("File opening error.");
+CaptureSnapshot ObserverCapture::DetachEvents() {
+    CaptureSnapshot detached;
+    std::lock_guard<std::mutex> seal_lock(seal_mutex);
+    std::lock_guard<std::shared_mutex> lock(events_mutex);
+    for (size_t c = 0; c < kCaptureCategoryCount; ++c) {
+        detached.events[c].swap(category_events[c]);
+        category_events[c].reserve(kReservedCategoryEvents);
     }
-    outfile.write(reinterpret_cast<const char*>(data.data()), data.size());
-    outfile.close();
-    // check for stream errors after closing.
-    if (!outfile) {
-        std::wstring error_msg = L"Error occurred while writing to file: ";
-        error_msg += path.wstring();
-        // throw to be caught by the main export function's try-catch block.
-        throw std::runtime_error("File writing error.");
+    detached.text_pool.swap(match_text_pool);
+    ++text_generation;
+    for (size_t c = 0; c < kCaptureCategoryCount; ++c) {
+        detached.chunk_counts[c] = chunks->GetChunkCount(static_cast<CaptureCategory>(c));
     }
+    detached.chunk_event_count = chunks->GetEventCount();
+    detached.chunks = std::move(chunks);
+    chunks = std::make_shared<CaptureChunkStore>();
+    detached.stream = std::move(stream);
+    detached.streamed_event_count = sealed_event_count;
+    chunk_sealing_failed = false;
+    event_count = 0;
+    newest_time_ms = 0;
+    next_sequence = 0;
+    sealed_event_count = 0;
+    last_seal_time_ms = 0;
+    return detached;
 }
 
-// exports accumulated logs into separate gzip-compressed files based on category markers.
-bool ObserverCapture::ExportLogsToFolder(const wchar_t* folder_name) {
+// exports snapshotted events into separate gzip-compressed files based on their category.
+bool ObserverCapture::ExportLogsToFolder(const wchar_t* folder_name, const CaptureSnapshot& snapshot,
+                                         ObserverArchiveWriter* archive, ExportProgress* progress) {
     /* structure:
      captures/
       - folder_name/
@@ -146,8 +366,8 @@ bool ObserverCapture::ExportLogsToFolder(const wchar_t* folder_name) {
               - lord_events.txt.gz
               - unknown_events.txt.gz
     */
-    if (match_log_entries.empty()) {
-        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, L"No logs to export.");
+    if (snapshot.GetEventCount() == 0) {
+        PostChatMessage(L"No logs to export.");
         return false;
     }
 
@@ -157,107 +377,107 @@ bool ObserverCapture::ExportLogsToFolder(const wchar_t* folder_name) {
         std::filesystem::path stoc_dir = match_dir / "StoC"; // subdir for stoc event categories
 
         // create directories if they don't exist
-        std::filesystem::create_directories(stoc_dir);
-        std::filesystem::path abs_match_path = std::filesystem::absolute(match_dir); // for success message
-
-        // use buffers to collect logs for each category before compression.
-        std::map<std::wstring, std::wstringstream> category_buffers;
-        category_buffers[L"skill"] = std::wstringstream();
-        category_buffers[L"attack_skill"] = std::wstringstream();
-        category_buffers[L"basic_attack"] = std::wstringstream();
-        category_buffers[L"combat"] = std::wstringstream();
-        category_buffers[L"agent"] = std::wstringstream();
-        category_buffers[L"jumbo"] = std::wstringstream();
-        category_buffers[L"lord"] = std::wstringstream();
-        category_buffers[L"unknown"] = std::wstringstream();
-
-        for (const auto& entry : match_log_entries) {
-            size_t first_space = entry.find(L' ');
-            if (first_space == std::wstring::npos) continue; // skip malformed entries
-
-            std::wstring timestamp = entry.substr(0, first_space + 1); // include the space
-            std::wstring data = entry.substr(first_space + 1); // marker + message
-            std::wstring message_content; // content without marker
-            std::wstring category_key = L"unknown"; // default category
-
-            // identify marker and assign log entry to the correct category buffer.
-            if (data.rfind(MARKER_SKILL_EVENT, 0) == 0) {
-                 category_key = L"skill";
-                 message_content = data.substr(MARKER_SKILL_EVENT_LEN);
-            } else if (data.rfind(MARKER_ATTACK_SKILL_EVENT, 0) == 0) {
-                category_key = L"attack_skill";
-                message_content = data.substr(MARKER_ATTACK_SKILL_EVENT_LEN);
-            } else if (data.rfind(MARKER_BASIC_ATTACK_EVENT, 0) == 0) {
-                category_key = L"basic_attack";
-                 message_content = data.substr(MARKER_BASIC_ATTACK_EVENT_LEN);
-            } else if (data.rfind(MARKER_COMBAT_EVENT, 0) == 0) {
-                 category_key = L"combat";
-                 message_content = data.substr(MARKER_COMBAT_EVENT_LEN);
-            } else if (data.rfind(MARKER_AGENT_EVENT, 0) == 0) {
-                 category_key = L"agent";
-                 message_content = data.substr(MARKER_AGENT_EVENT_LEN);
-            } else if (data.rfind(MARKER_JUMBO_EVENT, 0) == 0) {
-                 category_key = L"jumbo";
-                 message_content = data.substr(MARKER_JUMBO_EVENT_LEN);
-            } else if (data.rfind(MARKER_LORD_EVENT, 0) == 0) {
-                 category_key = L"lord";
-                 message_content = data.substr(MARKER_LORD_EVENT_LEN);
-            } else {
-                 // for unknown category, keep the full data part including potential unknown marker.
-                 message_content = data; // use full data part
-                 category_key = L"unknown";
-            }
-
-            // append timestamp, message content, and newline to the correct category buffer.
-            category_buffers[category_key] << timestamp << message_content << L"\n";
+        if (!archive) std::filesystem::create_directories(stoc_dir);
+
+        // every category is rendered straight into its own file (or archive stream), one job per category.
+        if (progress) progress->BeginPhase(ExportPhase::StoC, static_cast<uint32_t>(kCaptureCategoryCount));
+        std::vector<std::function<void()>> jobs;
+        for (size_t c = 0; c < kCaptureCategoryCount; ++c) {
+            jobs.push_back([&snapshot, &stoc_dir, archive, progress, c]() {
+                const CaptureCategory category = static_cast<CaptureCategory>(c);
+                if (archive) {
+                    std::vector<unsigned char> data;
+                    GzipSink sink(data);
+                    RenderSnapshotCategory(category, snapshot, sink, progress);
+                    sink.Finish();
+                    archive->AddStream(std::string("StoC/") + GetCaptureCategoryFileName(category), ArchiveCodec::Gzip, std::move(data));
+                } else {
+                    GzipSink sink(stoc_dir / GetCaptureCategoryFileName(category));
+                    RenderSnapshotCategory(category, snapshot, sink, progress);
+                    sink.Finish();
+                }
+                if (progress) progress->Step();
+            });
         }
+        RunParallelJobs(jobs);
+        if (archive) return true; // ObserverMatch reports the archive once every stream is in
 
-        // compress and write each category buffer to its respective file.
-        WriteCompressedFile(stoc_dir / "skill_events.txt.gz", compress_gzip(WStringToUTF8(category_buffers[L"skill"].str())));
-        WriteCompressedFile(stoc_dir / "attack_skill_events.txt.gz", compress_gzip(WStringToUTF8(category_buffers[L"attack_skill"].str())));
-        WriteCompressedFile(stoc_dir / "basic_attack_events.txt.gz", compress_gzip(WStringToUTF8(category_buffers[L"basic_attack"].str())));
-        WriteCompressedFile(stoc_dir / "combat_events.txt.gz", compress_gzip(WStringToUTF8(category_buffers[L"combat"].str())));
-        WriteCompressedFile(stoc_dir / "agent_events.txt.gz", compress_gzip(WStringToUTF8(category_buffers[L"agent"].str())));
-        WriteCompressedFile(stoc_dir / "jumbo_messages.txt.gz", compress_gzip(WStringToUTF8(category_buffers[L"jumbo"].str())));
-        WriteCompressedFile(stoc_dir / "lord_events.txt.gz", compress_gzip(WStringToUTF8(category_buffers[L"lord"].str())));
-        WriteCompressedFile(stoc_dir / "unknown_events.txt.gz", compress_gzip(WStringToUTF8(category_buffers[L"unknown"].str())));
+        std::filesystem::path abs_match_path = std::filesystem::absolute(match_dir); // for success message
 
         std::wstring success_msg = L"StoC logs exported and compressed to folder: ";
         success_msg += abs_match_path.wstring();
-        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, success_msg.c_str());
+        PostChatMessage(success_msg);
 
         return true;
+    } catch (const ExportCancelled&) {
+        throw; // reported once by the export queue
     } catch (const std::filesystem::filesystem_error& e) {
-        std::string error_msg_str = "Filesystem error during export: ";
-        error_msg_str += e.what();
-        // convert narrow error string to wide string for writechat.
-         wchar_t werror_msg[512] = {0}; // initialize buffer
-         MultiByteToWideChar(CP_UTF8, 0, error_msg_str.c_str(), -1, werror_msg, 512);
-        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, werror_msg);
+        PostExportError("Filesystem error during export: ", e.what());
         return false;
     } catch (const std::exception& e) {
-        std::string error_msg_str = "Generic error during export: ";
-        error_msg_str += e.what();
-        // convert narrow error string to wide string for writechat.
-        wchar_t werror_msg[512] = {0}; // initialize buffer
-        MultiByteToWideChar(CP_UTF8, 0, error_msg_str.c_str(), -1, werror_msg, 512);
-        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, werror_msg);
+        PostExportError("Generic error during export: ", e.what());
         return false;
     } catch (...) {
         // catch-all for unexpected errors (e.g., from helper functions).
-         GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, L"An unexpected error occurred during export.");
-         return false;
+        PostChatMessage(L"An unexpected error occurred during export.");
+        return false;
+    }
+}
+
+// streaming: sealed chunks are already on disk, only the detached tail is left to append.
+// never cancelled halfway, the files would lose the end of the match
+bool ObserverCapture::FlushStreamToFolder(const wchar_t* folder_name, const CaptureSnapshot& tail, ExportProgress* progress) {
+    if (!tail.stream) return false;
+    if (tail.streamed_event_count + tail.GetEventCount() == 0) {
+        PostChatMessage(L"No logs to export.");
+        return false;
+    }
+
+    try {
+        tail.stream->Relocate(folder_name);
+
+        if (progress) progress->BeginPhase(ExportPhase::StoC, static_cast<uint32_t>(kCaptureCategoryCount));
+        std::vector<std::function<void()>> jobs;
+        for (size_t c = 0; c < kCaptureCategoryCount; ++c) {
+            jobs.push_back([&tail, progress, c]() {
+                const CaptureCategory category = static_cast<CaptureCategory>(c);
+                if (!tail.events[c].empty() || tail.chunk_counts[c] > 0) {
+                    std::vector<unsigned char> chunk;
+                    GzipSink sink(chunk);
+                    RenderSnapshotCategory(category, tail, sink, nullptr);
+                    sink.Finish();
+                    tail.stream->Append(std::filesystem::path("StoC") / GetCaptureCategoryFileName(category), chunk);
+                }
+                if (progress) progress->Step();
+            });
+        }
+        RunParallelJobs(jobs);
+
+        std::wstring success_msg = L"StoC logs exported and compressed to folder: ";
+        success_msg += std::filesystem::absolute(std::filesystem::path("captures") / folder_name).wstring();
+        PostChatMessage(success_msg);
+        return true;
+    } catch (const std::filesystem::filesystem_error& e) {
+        PostExportError("Filesystem error during export: ", e.what());
+        return false;
+    } catch (const std::exception& e) {
+        PostExportError("Generic error during export: ", e.what());
+        return false;
     }
-} 
+}
 
 size_t ObserverCapture::GetLogCount() const {
-    return match_log_entries.size();
+    std::shared_lock<std::shared_mutex> lock(events_mutex);
+    return sealed_event_count + chunks->GetEventCount() + event_count;
 }
 
-const std::vector<std::wstring>& ObserverCapture::GetLogEntries() const {
-    return match_log_entries;
+size_t ObserverCapture::GetSealedCount() const {
+    std::shared_lock<std::shared_mutex> lock(events_mutex);
+    return sealed_event_count;
 }
 
-const std::vector<std::wstring>& ObserverCapture::GetLogs() const {
-    return match_log_entries;
-} 
\ No newline at end of file
+CaptureChunkStats ObserverCapture::GetChunkStats(CaptureCategory category, uint64_t& unsealed_bytes) const {
+    std::shared_lock<std::shared_mutex> lock(events_mutex);
+    unsealed_bytes = category_events[static_cast<size_t>(category)].size() * sizeof(CaptureEvent);
+    return chunks->GetStats(category);
+}
@@ -1,22 +1,109 @@
 #pragma once
 
+#include "ObserverEvents.h"
+#include "ObserverChunks.h"
+
 #include <vector>
+#include <array>
+#include <memory>
 #include <string>
 #include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+
+class ObserverStream;
+class ObserverArchiveWriter;
+class ExportProgress;
+
+// events held in memory, copied when an export is queued (or detached when a match is retired)
+// so the worker can render them while the capture goes on
+struct CaptureSnapshot {
+    std::array<CaptureSegment, kCaptureCategoryCount> events; // newer than the chunks
+    std::vector<std::wstring> text_pool;
+    // sealed events, shared with the capture. only the chunks that existed when the snapshot was taken belong to it
+    std::shared_ptr<CaptureChunkStore> chunks;
+    std::array<size_t, kCaptureCategoryCount> chunk_counts{};
+    size_t chunk_event_count = 0;
+    // streaming: the stream the events were sealed into, detached with them so the export appends the tail.
+    // never set by TakeSnapshot
+    std::shared_ptr<ObserverStream> stream;
+    size_t streamed_event_count = 0; // events already in the stream's files
+
+    size_t GetEventCount() const;
+};
+
+// a message of the capture text pool. the generation changes when the events are cleared or detached,
+// so a late patch can't land in the pool of another match
+struct CaptureTextRef {
+    uint32_t index = 0;      // for CaptureEvent::skill_id
+    uint32_t generation = 0;
+};
 
 class ObserverCapture {
 public:
     ObserverCapture();
-    ~ObserverCapture() = default;
+    ~ObserverCapture(); // stops the sealer thread
+
+    ObserverCapture(const ObserverCapture&) = delete;
+    ObserverCapture& operator=(const ObserverCapture&) = delete;
 
-    void AddLogEntry(const wchar_t* entry); 
+    void AddEvent(const CaptureEvent& event, CaptureCategory category) { AddEvents(&event, 1, category); }
+    // appends consecutive records under one lock, so a snapshot never splits a record from its continuation.
+    // category is resolved once, when the events are emitted
+    void AddEvents(const CaptureEvent* events, size_t count, CaptureCategory category);
+    CaptureTextRef AddText(const wchar_t* text); // stores a free-form message
+    // replaces a message once more details are known, dropped if the events were cleared or detached since
+    void SetText(const CaptureTextRef& text_ref, const wchar_t* text);
     void ClearLogs();
-    bool ExportLogsToFolder(const wchar_t* folder_name);
+    void SetStream(std::shared_ptr<ObserverStream> stream_handler); // streams the next events to disk, nullptr to stop
 
-    size_t GetLogCount() const;
-    const std::vector<std::wstring>& GetLogEntries() const;
-    const std::vector<std::wstring>& GetLogs() const;
+    CaptureSnapshot TakeSnapshot() const; // a plain copy, cheap next to rendering and compressing it
+    CaptureSnapshot DetachEvents();       // moves the events and the stream out in O(1), the capture starts over empty
+    // writes the snapshot's StoC files, or streams into archive. throws ExportCancelled once progress is cancelled
+    bool ExportLogsToFolder(const wchar_t* folder_name, const CaptureSnapshot& snapshot,
+                            ObserverArchiveWriter* archive = nullptr, ExportProgress* progress = nullptr);
+    // streaming: relocates the detached stream's files and appends the events it had not sealed yet
+    bool FlushStreamToFolder(const wchar_t* folder_name, const CaptureSnapshot& tail, ExportProgress* progress = nullptr);
+
+    size_t GetLogCount() const;    // recorded events, including the ones already streamed to disk
+    size_t GetSealedCount() const; // events already streamed to disk
+    // sealed chunks of a category, and the bytes of the events not sealed yet in unsealed_bytes
+    CaptureChunkStats GetChunkStats(CaptureCategory category, uint64_t& unsealed_bytes) const;
 
 private:
-    std::vector<std::wstring> match_log_entries;
-}; 
\ No newline at end of file
+    void sealerLoop();
+    void sealChunks(); // every full run of every category, then spills whatever is over the budget
+    bool sealChunk(CaptureCategory category); // false once the category has no full run left
+    void sealEvents(); // stops the stream on write errors, the events then stay in memory
+
+
+    std::mutex seal_mutex;             // orders sealed chunks between the sealer thread and exports
+
+    // chunks are packed and streamed on their own thread, the StoC consumer only asks for it
+    std::thread sealer;
+    std::mutex sealer_mutex;
+    std::condition_variable sealer_wake;
+    bool chunk_seal_requested = false;
+    bool stream_seal_requested = false;
+    bool sealer_stopping = false;
+    std::vector<CaptureEvent> seal_buffer; // the run being packed, copied out so appends never wait on gzip
+    size_t sealed_event_count = 0;
+    uint32_t last_seal_time_ms = 0;
+    bool chunk_sealing_failed = false; // stops retrying on every event, until the next match
+
+    // events are added by the StoC consumer thread while the UI reads and snapshots them
+    mutable std::shared_mutex events_mutex;
+    std::shared_ptr<ObserverStream> stream; // optional spill-to-disk target of the match, goes with the events
+    // one segment per export category, so every StoC file is written from its own events only
+    std::array<CaptureSegment, kCaptureCategoryCount> category_events;
+    size_t event_count = 0;    // events held in memory, across every category
+    uint32_t newest_time_ms = 0;
+    uint32_t next_sequence = 0; // numbers the events of a match in arrival order
+    std::vector<std::wstring> match_text_pool; // DeathResurrection messages, referenced by index
+    uint32_t text_generation = 0; // bumped whenever match_text_pool is cleared or detached
+    // when not streaming, full runs of a category are sealed into compressed chunks instead.
+    // replaced, never cleared, when the events are cleared or detached: snapshots may still read it
+    std::shared_ptr<CaptureChunkStore> chunks;
+};
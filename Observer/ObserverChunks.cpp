@@ -0,0 +1,219 @@
+#include <windows.h>
+#include "ObserverChunks.h"
+#include "ObserverCompression.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    std::atomic<uint64_t> memory_budget{256ull * 1024 * 1024};
+    std::atomic<uint64_t> memory_usage{0};
+    std::atomic<uint32_t> spill_file_counter{0};
+    std::atomic<uint64_t> next_chunk_age{0};
+
+    // every live store, so spilling can pick the oldest chunk whichever match and stream it belongs to.
+    // taken before any store's mutex
+    std::mutex stores_mutex;
+    std::vector<CaptureChunkStore*> stores;
+}
+
+std::vector<unsigned char> PackCaptureEvents(const CaptureSegment& events, size_t count) {
+    std::vector<unsigned char> packed;
+    GzipSink sink(packed, CompressionSettings{CaptureCodec::Gzip, 1});
+    for (size_t i = 0; i < count && i < events.size(); ++i) {
+        sink.Write(reinterpret_cast<const char*>(&events[i]), sizeof(CaptureEvent));
+    }
+    sink.Finish();
+    packed.shrink_to_fit();
+    return packed;
+}
+
+std::vector<unsigned char> PackCaptureEvents(const CaptureEvent* events, size_t count) {
+    std::vector<unsigned char> packed;
+    GzipSink sink(packed, CompressionSettings{CaptureCodec::Gzip, 1});
+    sink.Write(reinterpret_cast<const char*>(events), count * sizeof(CaptureEvent));
+    sink.Finish();
+    packed.shrink_to_fit();
+    return packed;
+}
+
+void UnpackCaptureEvents(const std::vector<unsigned char>& packed, CaptureSegment& events) {
+    if (packed.empty()) return; // nothing was written for an empty run
+    const std::string raw = decompress_gzip(packed);
+    if (raw.size() % sizeof(CaptureEvent) != 0) {
+        throw std::runtime_error("Packed capture events are corrupted.");
+    }
+    const size_t first = events.size();
+    events.resize(first + raw.size() / sizeof(CaptureEvent));
+    for (size_t i = first; i < events.size(); ++i) {
+        memcpy(&events[i], raw.data() + (i - first) * sizeof(CaptureEvent), sizeof(CaptureEvent));
+    }
+}
+
+CaptureChunkStore::CaptureChunkStore() {
+    std::lock_guard<std::mutex> lock(stores_mutex);
+    stores.push_back(this);
+}
+
+CaptureChunkStore::~CaptureChunkStore() {
+    {
+        std::lock_guard<std::mutex> lock(stores_mutex);
+        stores.erase(std::find(stores.begin(), stores.end(), this));
+    }
+    memory_usage -= memory_bytes_;
+    if (spill_file_.is_open()) {
+        spill_file_.close();
+        std::error_code ec;
+        std::filesystem::remove(spill_path_, ec);
+    }
+}
+
+void CaptureChunkStore::Append(uint32_t stream, std::vector<unsigned char> packed, size_t event_count) {
+    Chunk chunk;
+    chunk.size = packed.size();
+    chunk.event_count = static_cast<uint32_t>(event_count);
+    chunk.data = std::move(packed);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Chunk>& stream_chunks = chunks_[stream];
+    memory_order_.push_back({next_chunk_age.fetch_add(1), stream, stream_chunks.size()});
+    memory_bytes_ += chunk.size;
+    memory_usage += chunk.size;
+    event_count_ += event_count;
+    stream_chunks.push_back(std::move(chunk));
+}
+
+void CaptureChunkStore::SpillOverBudget() {
+    std::lock_guard<std::mutex> stores_lock(stores_mutex);
+    while (memory_usage.load() > memory_budget.load()) {
+        // the store whose oldest chunk in memory is the oldest of all
+        CaptureChunkStore* oldest = nullptr;
+        uint64_t oldest_age = UINT64_MAX;
+        for (CaptureChunkStore* store : stores) {
+            std::lock_guard<std::mutex> lock(store->mutex_);
+            if (!store->memory_order_.empty() && store->memory_order_.front().age < oldest_age) {
+                oldest = store;
+                oldest_age = store->memory_order_.front().age;
+            }
+        }
+        if (!oldest) return;
+
+        std::lock_guard<std::mutex> lock(oldest->mutex_);
+        if (!oldest->memory_order_.empty()) oldest->spillOldest(); // SpillAll may have been faster
+    }
+}
+
+void CaptureChunkStore::SpillAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!memory_order_.empty()) {
+        spillOldest();
+    }
+}
+
+void CaptureChunkStore::spillOldest() {
+    if (!spill_file_.is_open()) {
+        // one file per store, removed with it
+        spill_path_ = std::filesystem::temp_directory_path() /
+                      ("ObserverPlugin-" + std::to_string(GetCurrentProcessId()) + "-" +
+                       std::to_string(spill_file_counter.fetch_add(1)) + ".spill");
+        spill_file_.open(spill_path_, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+        if (!spill_file_.is_open()) {
+            throw std::runtime_error("Spill file opening error.");
+        }
+    }
+
+    const MemoryChunk& oldest = memory_order_.front();
+    Chunk& chunk = chunks_[oldest.stream][oldest.index];
+    spill_file_.seekp(static_cast<std::streamoff>(spill_size_));
+    spill_file_.write(reinterpret_cast<const char*>(chunk.data.data()), static_cast<std::streamsize>(chunk.size));
+    if (!spill_file_) {
+        spill_file_.clear();
+        throw std::runtime_error("Spill file writing error.");
+    }
+
+    chunk.spill_offset = spill_size_;
+    chunk.spilled = true;
+    std::vector<unsigned char>().swap(chunk.data);
+    spill_size_ += chunk.size;
+    memory_bytes_ -= chunk.size;
+    memory_usage -= chunk.size;
+    memory_order_.pop_front();
+}
+
+size_t CaptureChunkStore::GetChunkCount(uint32_t stream) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = chunks_.find(stream);
+    return it != chunks_.end() ? it->second.size() : 0;
+}
+
+size_t CaptureChunkStore::GetEventCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return event_count_;
+}
+
+uint64_t CaptureChunkStore::GetMemoryBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return memory_bytes_;
+}
+
+CaptureChunkStats CaptureChunkStore::GetStats(uint32_t stream) const {
+    CaptureChunkStats stats;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = chunks_.find(stream);
+    if (it == chunks_.end()) return stats;
+    for (const Chunk& chunk : it->second) {
+        ++stats.chunk_count;
+        stats.event_count += chunk.event_count;
+        if (chunk.spilled) {
+            stats.spilled_bytes += chunk.size;
+        } else {
+            stats.memory_bytes += chunk.size;
+        }
+    }
+    return stats;
+}
+
+std::vector<unsigned char> CaptureChunkStore::LoadPacked(uint32_t stream, size_t index) const {
+    // copied under the lock, spilling may release the data meanwhile
+    std::vector<unsigned char> packed;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = chunks_.find(stream);
+    if (it == chunks_.end() || index >= it->second.size()) {
+        throw std::runtime_error("Capture chunk out of range.");
+    }
+    const Chunk& chunk = it->second[index];
+    if (chunk.spilled) {
+        packed.resize(chunk.size);
+        spill_file_.seekg(static_cast<std::streamoff>(chunk.spill_offset));
+        spill_file_.read(reinterpret_cast<char*>(packed.data()), static_cast<std::streamsize>(chunk.size));
+        if (!spill_file_) {
+            spill_file_.clear();
+            throw std::runtime_error("Spill file reading error.");
+        }
+    } else {
+        packed = chunk.data;
+    }
+    return packed;
+}
+
+CaptureSegment CaptureChunkStore::Load(CaptureCategory category, size_t index) const {
+    // unpacking happens outside the lock, into blocks of its own
+    CaptureSegment events(CaptureSegment::BlockSource::Heap);
+    UnpackCaptureEvents(LoadPacked(static_cast<uint32_t>(category), index), events);
+    return events;
+}
+
+void CaptureChunkStore::SetMemoryBudget(uint64_t bytes) {
+    memory_budget = bytes;
+}
+
+uint64_t CaptureChunkStore::GetMemoryBudget() {
+    return memory_budget.load();
+}
+
+uint64_t CaptureChunkStore::GetMemoryUsage() {
+    return memory_usage.load();
+}
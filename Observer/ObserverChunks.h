@@ -0,0 +1,95 @@
+#pragma once
+
+#include "ObserverEvents.h"
+#include "ObserverSegment.h"
+
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+// gzip of the raw records, at the fastest level: records are fixed-size and mostly small ids,
+// they compress several times over even at level 1
+std::vector<unsigned char> PackCaptureEvents(const CaptureSegment& events, size_t count);
+std::vector<unsigned char> PackCaptureEvents(const CaptureEvent* events, size_t count);
+// appends the records of a packed run to events, throws on corrupted data
+void UnpackCaptureEvents(const std::vector<unsigned char>& packed, CaptureSegment& events);
+
+// byte counts of one stream's sealed chunks, for the status window
+struct CaptureChunkStats {
+    size_t chunk_count = 0;
+    size_t event_count = 0;
+    uint64_t memory_bytes = 0;  // compressed chunks held in memory
+    uint64_t spilled_bytes = 0; // compressed chunks moved to the spill file
+};
+
+// sealed capture data of one match, compressed in memory: fixed-size runs of raw StoC records per
+// category, or of agent snapshots per agent, each in its own stream. every store of every match counts
+// against one memory budget, past it the oldest chunks across all stores are spilled to a temp file
+// and read back when an export needs them. chunks never change once appended, so a snapshot only
+// has to remember how many chunks each stream had.
+class CaptureChunkStore {
+public:
+    CaptureChunkStore();  // registers the store with the shared budget
+    ~CaptureChunkStore(); // gives its chunks back to the budget and removes the spill file
+
+    CaptureChunkStore(const CaptureChunkStore&) = delete;
+    CaptureChunkStore& operator=(const CaptureChunkStore&) = delete;
+
+    // appends packed data as the next chunk of stream, cheap enough to call under the owner's locks
+    void Append(uint32_t stream, std::vector<unsigned char> packed, size_t event_count);
+    void SpillAll(); // for matches that are only read again by their export
+
+    size_t GetChunkCount(uint32_t stream) const;
+    size_t GetEventCount() const; // across every stream
+    uint64_t GetMemoryBytes() const;
+    CaptureChunkStats GetStats(uint32_t stream) const;
+
+    // one chunk as appended, read back from the spill file when needed. throws on read errors
+    std::vector<unsigned char> LoadPacked(uint32_t stream, size_t index) const;
+
+    // StoC stores use one stream per category and hold PackCaptureEvents chunks
+    void Append(CaptureCategory category, std::vector<unsigned char> packed, size_t event_count) {
+        Append(static_cast<uint32_t>(category), std::move(packed), event_count);
+    }
+    size_t GetChunkCount(CaptureCategory category) const { return GetChunkCount(static_cast<uint32_t>(category)); }
+    CaptureChunkStats GetStats(CaptureCategory category) const { return GetStats(static_cast<uint32_t>(category)); }
+    CaptureSegment Load(CaptureCategory category, size_t index) const; // unpacked, throws on read errors
+
+    // budget shared by every store, in compressed bytes
+    static void SetMemoryBudget(uint64_t bytes);
+    static uint64_t GetMemoryBudget();
+    static uint64_t GetMemoryUsage(); // compressed bytes held in memory by every store
+    // spills the oldest chunks in memory, whichever store holds them, while every store together
+    // is over the budget. call it after appending, outside of any store's owner locks. throws on write errors
+    static void SpillOverBudget();
+
+private:
+    struct Chunk {
+        std::vector<unsigned char> data; // emptied once spilled
+        uint64_t size = 0;
+        uint64_t spill_offset = 0;
+        uint32_t event_count = 0;
+        bool spilled = false;
+    };
+    struct MemoryChunk {
+        uint64_t age = 0; // appends across every store are numbered, the smallest is the oldest
+        uint32_t stream = 0;
+        size_t index = 0;
+    };
+
+    void spillOldest(); // expects mutex_ held and a chunk in memory, throws on write errors
+
+    mutable std::mutex mutex_; // appends come from the sealing threads, loads from the export worker
+    std::map<uint32_t, std::vector<Chunk>> chunks_; // by stream
+    std::deque<MemoryChunk> memory_order_; // the chunks in memory, oldest first
+    size_t event_count_ = 0;
+    uint64_t memory_bytes_ = 0;
+
+    mutable std::fstream spill_file_; // opened on the first spill
+    std::filesystem::path spill_path_;
+    uint64_t spill_size_ = 0;
+};
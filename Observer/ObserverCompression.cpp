@@ -0,0 +1,449 @@
+#include <windows.h>
+#include "ObserverCompression.h"
+
+#include <fstream>
+#include <cstring>
+#include <zlib.h>
+#include <stdexcept>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <exception>
+#include <chrono>
+#include <iterator>
+#include <condition_variable>
+
+namespace {
+    // read by the export worker threads while the settings UI may change them
+    std::atomic<uint8_t> selected_codec{static_cast<uint8_t>(CaptureCodec::Gzip)};
+    std::atomic<int> selected_level{9};
+
+    int ClampLevel(int level) {
+        return std::clamp(level, Z_BEST_SPEED, Z_BEST_COMPRESSION);
+    }
+}
+
+void SetCompressionSettings(const CompressionSettings& settings) {
+    const CaptureCodec codec = settings.codec < CaptureCodec::Count ? settings.codec : CaptureCodec::Gzip;
+    selected_codec.store(static_cast<uint8_t>(codec));
+    selected_level.store(ClampLevel(settings.level));
+}
+
+CompressionSettings GetCompressionSettings() {
+    CompressionSettings settings;
+    settings.codec = static_cast<CaptureCodec>(selected_codec.load());
+    settings.level = selected_level.load();
+    return settings;
+}
+
+const char* GetCaptureCodecName(CaptureCodec codec) {
+    switch (codec) {
+        case CaptureCodec::Gzip: return "gzip";
+        default: return "unknown";
+    }
+}
+
+std::vector<unsigned char> compress_gzip(const std::string& data) {
+    return compress_gzip(data, GetCompressionSettings());
+}
+
+std::vector<unsigned char> compress_gzip(const std::string& data, const CompressionSettings& settings) {
+    std::vector<unsigned char> compressed_data;
+    GzipSink sink(compressed_data, settings);
+    sink.Write(data.data(), data.size());
+    sink.Finish();
+    return compressed_data;
+}
+
+GzipSink::GzipSink(const std::filesystem::path& path, const CompressionSettings& settings)
+    : settings_(settings), path_(path), temp_path_(path) {
+    temp_path_ += ".tmp";
+}
+
+GzipSink::GzipSink(std::vector<unsigned char>& output, const CompressionSettings& settings)
+    : settings_(settings), memory_output_(&output) {
+}
+
+GzipSink::~GzipSink() {
+    // an unfinished sink (error or cancel) releases zlib and its partial file, the caller reports the error
+    if (started_ && !finished_) {
+        deflateEnd(zs_.get());
+    }
+    if (temp_file_) {
+        file_.close();
+        std::error_code ec;
+        std::filesystem::remove(temp_path_, ec);
+    }
+}
+
+// sets up deflate and opens the output on the first write
+void GzipSink::start() {
+    zs_ = std::make_unique<z_stream_s>();
+    memset(zs_.get(), 0, sizeof(z_stream_s));
+
+    const int level = ClampLevel(settings_.level);
+
+    // initialize for gzip compression (windowbits = 15 + 16 for gzip header)
+    if (deflateInit2(zs_.get(), level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw(std::runtime_error("deflateInit2 failed while compressing."));
+    }
+    started_ = true;
+
+    input_.resize(kBufferSize);
+    output_.resize(kBufferSize);
+
+    if (!memory_output_) {
+        file_.open(temp_path_, std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!file_.is_open()) {
+            // throw to be caught by the calling export/stream function's try-catch block.
+            throw std::runtime_error("File opening error.");
+        }
+        temp_file_ = true;
+    }
+}
+
+void GzipSink::Write(const char* text, size_t length) {
+    if (length == 0) return;
+    if (!started_) start();
+
+    while (length > 0) {
+        if (input_length_ == kBufferSize) deflateInput(Z_NO_FLUSH);
+        const size_t chunk = std::min(length, kBufferSize - input_length_);
+        memcpy(input_.data() + input_length_, text, chunk);
+        input_length_ += chunk;
+        text += chunk;
+        length -= chunk;
+    }
+}
+
+void GzipSink::Write(const wchar_t* text, size_t length) {
+    if (length == 0) return;
+    if (!started_) start();
+
+    for (size_t i = 0; i < length; ++i) {
+        uint32_t code_point = static_cast<uint32_t>(text[i]);
+        if (pending_high_surrogate_) {
+            const uint32_t high = static_cast<uint32_t>(pending_high_surrogate_);
+            pending_high_surrogate_ = 0;
+            if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+                appendUtf8(0x10000 + ((high - 0xD800) << 10) + (code_point - 0xDC00));
+                continue;
+            }
+            appendUtf8(0xFFFD); // lone high surrogate, replaced like WideCharToMultiByte does
+        }
+        if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+            pending_high_surrogate_ = text[i];
+        } else if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+            appendUtf8(0xFFFD); // lone low surrogate
+        } else {
+            appendUtf8(code_point);
+        }
+    }
+}
+
+void GzipSink::appendUtf8(uint32_t code_point) {
+    if (kBufferSize - input_length_ < 4) deflateInput(Z_NO_FLUSH); // room for the longest sequence
+
+    char* out = input_.data() + input_length_;
+    if (code_point < 0x80) {
+        out[0] = static_cast<char>(code_point);
+        input_length_ += 1;
+    } else if (code_point < 0x800) {
+        out[0] = static_cast<char>(0xC0 | (code_point >> 6));
+        out[1] = static_cast<char>(0x80 | (code_point & 0x3F));
+        input_length_ += 2;
+    } else if (code_point < 0x10000) {
+        out[0] = static_cast<char>(0xE0 | (code_point >> 12));
+        out[1] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out[2] = static_cast<char>(0x80 | (code_point & 0x3F));
+        input_length_ += 3;
+    } else {
+        out[0] = static_cast<char>(0xF0 | (code_point >> 18));
+        out[1] = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        out[2] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out[3] = static_cast<char>(0x80 | (code_point & 0x3F));
+        input_length_ += 4;
+    }
+}
+
+// runs the pending input through deflate, writing everything it produces
+void GzipSink::deflateInput(int flush) {
+    z_stream_s& zs = *zs_;
+    zs.next_in = reinterpret_cast<Bytef*>(input_.data());
+    zs.avail_in = static_cast<uInt>(input_length_);
+
+    int ret;
+    do {
+        zs.next_out = output_.data();
+        zs.avail_out = static_cast<uInt>(output_.size());
+
+        // perform the compression step, z_finish indicates the last block of input.
+        ret = deflate(&zs, flush);
+        if (ret != Z_STREAM_END && ret != Z_OK && ret != Z_BUF_ERROR) {
+            throw(std::runtime_error("exception during gzip compression: deflate failed (" + std::to_string(ret) + ")"));
+        }
+
+        writeOutput(output_.data(), output_.size() - zs.avail_out);
+    } while (zs.avail_out == 0); // continue if the buffer was filled
+
+    input_length_ = 0;
+}
+
+void GzipSink::writeOutput(const unsigned char* data, size_t length) {
+    if (length == 0) return;
+    if (memory_output_) {
+        memory_output_->insert(memory_output_->end(), data, data + length);
+        return;
+    }
+    file_.write(reinterpret_cast<const char*>(data), length);
+    if (!file_) {
+        throw std::runtime_error("File writing error.");
+    }
+}
+
+void GzipSink::Finish() {
+    if (!started_ || finished_) return; // nothing was written, no file either
+
+    if (pending_high_surrogate_) {
+        pending_high_surrogate_ = 0;
+        appendUtf8(0xFFFD);
+    }
+    deflateInput(Z_FINISH);
+    deflateEnd(zs_.get());
+    finished_ = true;
+
+    if (!memory_output_) {
+        file_.close();
+        // check for stream errors after closing.
+        if (!file_) {
+            throw std::runtime_error("File writing error.");
+        }
+        std::filesystem::rename(temp_path_, path_); // replaces the file of an earlier export
+        temp_file_ = false;
+    }
+}
+
+// inflates every gzip member of data one after another
+std::string decompress_gzip(const std::vector<unsigned char>& data) {
+    if (data.empty()) return {};
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 16) != Z_OK) {
+        throw std::runtime_error("inflateInit2 failed while decompressing.");
+    }
+
+    zs.next_in = (Bytef*)data.data();
+    zs.avail_in = static_cast<uInt>(data.size());
+
+    std::string decompressed;
+    std::vector<char> outbuffer(65536);
+    for (;;) {
+        zs.next_out = reinterpret_cast<Bytef*>(outbuffer.data());
+        zs.avail_out = static_cast<uInt>(outbuffer.size());
+
+        int ret = inflate(&zs, Z_NO_FLUSH);
+        decompressed.append(outbuffer.data(), outbuffer.size() - zs.avail_out);
+
+        if (ret == Z_STREAM_END) {
+            if (zs.avail_in == 0) break;
+            inflateReset(&zs); // streamed captures are several members appended together
+        } else if (ret != Z_OK) {
+            inflateEnd(&zs);
+            throw std::runtime_error("exception during gzip decompression: inflate failed (" + std::to_string(ret) + ")");
+        } else if (zs.avail_in == 0 && zs.avail_out != 0) {
+            inflateEnd(&zs);
+            throw std::runtime_error("exception during gzip decompression: truncated data");
+        }
+    }
+
+    inflateEnd(&zs);
+    return decompressed;
+}
+
+// helper to append compressed data (a complete gzip member) to a file.
+// gzip readers decompress concatenated members as one stream.
+void AppendCompressedFile(const std::filesystem::path& path, const std::vector<unsigned char>& data) {
+    if (data.empty()) return; // nothing to append
+
+    std::ofstream outfile(path, std::ios::binary | std::ios::out | std::ios::app);
+    if (!outfile.is_open()) {
+        // throw to be caught by the calling export/stream function's try-catch block.
+        throw std::runtime_error("File opening error.");
+    }
+    outfile.write(reinterpret_cast<const char*>(data.data()), data.size());
+    outfile.close();
+    if (!outfile) {
+        throw std::runtime_error("File writing error.");
+    }
+}
+
+struct ExportWorkerPool::Batch {
+    const std::vector<std::function<void()>>* jobs = nullptr; // only read while the submitter waits on it
+    size_t job_count = 0;
+    std::atomic<size_t> next_job{0};
+    std::atomic<size_t> done_jobs{0};
+    std::exception_ptr first_error;
+    std::mutex mutex; // guards first_error and the finished wait
+    std::condition_variable finished;
+};
+
+ExportWorkerPool::ExportWorkerPool(size_t worker_count) {
+    workers_.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers_.emplace_back(&ExportWorkerPool::workerLoop, this);
+    }
+}
+
+ExportWorkerPool::~ExportWorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : workers_) {
+        thread.join();
+    }
+}
+
+// pulls job indices until the batch has none left, reporting each finished job
+void ExportWorkerPool::runJobs(Batch& batch) {
+    for (;;) {
+        const size_t index = batch.next_job.fetch_add(1);
+        if (index >= batch.job_count) return;
+        try {
+            (*batch.jobs)[index]();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(batch.mutex);
+            if (!batch.first_error) batch.first_error = std::current_exception();
+        }
+        if (batch.done_jobs.fetch_add(1) + 1 == batch.job_count) {
+            std::lock_guard<std::mutex> lock(batch.mutex);
+            batch.finished.notify_all();
+        }
+    }
+}
+
+void ExportWorkerPool::removeBatch(const std::shared_ptr<Batch>& batch) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find(batches_.begin(), batches_.end(), batch);
+    if (it != batches_.end()) batches_.erase(it);
+}
+
+void ExportWorkerPool::workerLoop() {
+    for (;;) {
+        std::shared_ptr<Batch> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stopping_ || !batches_.empty(); });
+            if (stopping_) return;
+            batch = batches_.front();
+        }
+        runJobs(*batch);
+        // every job is handed out, the next batch in line gets the worker
+        removeBatch(batch);
+    }
+}
+
+void ExportWorkerPool::Run(const std::vector<std::function<void()>>& jobs) {
+    if (jobs.empty()) return;
+
+    auto batch = std::make_shared<Batch>();
+    batch->jobs = &jobs;
+    batch->job_count = jobs.size();
+    if (jobs.size() > 1) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            batches_.push_back(batch);
+        }
+        wake_.notify_all();
+    }
+
+    runJobs(*batch);
+    removeBatch(batch);
+    {
+        std::unique_lock<std::mutex> lock(batch->mutex);
+        batch->finished.wait(lock, [&] { return batch->done_jobs.load() == jobs.size(); });
+    }
+
+    if (batch->first_error) std::rethrow_exception(batch->first_error);
+}
+
+namespace {
+    // set between StartExportWorkers and StopExportWorkers, both called from the plugin's constructor/destructor
+    std::unique_ptr<ExportWorkerPool> export_workers;
+}
+
+void StartExportWorkers() {
+    if (export_workers) return;
+    // the thread running a batch works on it as well
+    const size_t core_count = std::max(1u, std::thread::hardware_concurrency());
+    export_workers = std::make_unique<ExportWorkerPool>(core_count - 1);
+}
+
+void StopExportWorkers() {
+    export_workers.reset();
+}
+
+void RunParallelJobs(const std::vector<std::function<void()>>& jobs) {
+    if (export_workers) {
+        export_workers->Run(jobs);
+        return;
+    }
+
+    std::exception_ptr first_error;
+    for (const auto& job : jobs) {
+        try {
+            job();
+        } catch (...) {
+            if (!first_error) first_error = std::current_exception();
+        }
+    }
+    if (first_error) std::rethrow_exception(first_error);
+}
+
+std::string LoadCaptureCorpus(const std::filesystem::path& match_dir) {
+    std::string corpus;
+    for (const char* sub_dir : {"StoC", "Agents"}) {
+        const std::filesystem::path dir = match_dir / sub_dir;
+        if (!std::filesystem::exists(dir)) continue;
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            if (!entry.is_regular_file() || entry.path().extension() != ".gz") continue;
+
+            std::ifstream infile(entry.path(), std::ios::binary);
+            if (!infile.is_open()) {
+                throw std::runtime_error("File opening error.");
+            }
+            std::vector<unsigned char> compressed((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+            corpus += decompress_gzip(compressed);
+        }
+    }
+    return corpus;
+}
+
+std::vector<CompressionBenchmarkResult> RunCompressionBenchmark(const std::string& corpus) {
+    constexpr int kRuns = 3;
+
+    // every zlib level for gzip, level 1 being the fast setting
+    std::vector<CompressionSettings> matrix;
+    for (int level = Z_BEST_SPEED; level <= Z_BEST_COMPRESSION; ++level) {
+        matrix.push_back({CaptureCodec::Gzip, level});
+    }
+
+    std::vector<CompressionBenchmarkResult> results;
+    for (const CompressionSettings& settings : matrix) {
+        CompressionBenchmarkResult result;
+        result.settings = settings;
+        result.input_bytes = corpus.size();
+        for (int run = 0; run < kRuns; ++run) {
+            const auto start = std::chrono::steady_clock::now();
+            const size_t output_bytes = compress_gzip(corpus, settings).size();
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (run == 0 || seconds < result.seconds) result.seconds = seconds;
+            result.output_bytes = output_bytes;
+        }
+        results.push_back(result);
+    }
+    return results;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+struct z_stream_s;
+
+// shared export helpers used by ObserverCapture and ObserverLoop
+
+// codecs available for capture files. gzip is the only one: its level 1 is the fast setting,
+// and every capture stays a standard gzip member readable by the same tools.
+enum class CaptureCodec : uint8_t {
+    Gzip,        // deflate with the default strategy, honours the level
+    Count
+};
+
+struct CompressionSettings {
+    CaptureCodec codec = CaptureCodec::Gzip;
+    int level = 9; // zlib level 1-9, used by the gzip codec
+};
+
+// selected settings, used by every capture and agent log export
+void SetCompressionSettings(const CompressionSettings& settings);
+CompressionSettings GetCompressionSettings();
+const char* GetCaptureCodecName(CaptureCodec codec);
+
+// streaming gzip writer used by the exporters. text is encoded into a fixed utf-8 buffer that feeds
+// deflate incrementally, and deflate output goes straight to the file (or to one in-memory member),
+// so memory stays constant however much text goes through it.
+class GzipSink {
+public:
+    // writes a gzip file through <path>.tmp, moved in place by Finish. the file is only created once the
+    // first byte is written, so an empty log leaves no file behind, and a sink destroyed before Finish
+    // (error or cancelled export) removes its temp file instead of leaving a truncated .gz
+    explicit GzipSink(const std::filesystem::path& path, const CompressionSettings& settings = GetCompressionSettings());
+    // collects one gzip member in memory, used for streamed chunks
+    explicit GzipSink(std::vector<unsigned char>& output, const CompressionSettings& settings = GetCompressionSettings());
+    ~GzipSink();
+
+    GzipSink(const GzipSink&) = delete;
+    GzipSink& operator=(const GzipSink&) = delete;
+
+    // throw on compression or write errors
+    void Write(const char* text, size_t length);      // utf-8 text
+    void Write(const wchar_t* text, size_t length);   // utf-16 text, encoded to utf-8 on the fly
+    void Finish();                                    // flushes the gzip trailer, closes and renames the file
+
+private:
+    void start();
+    void appendUtf8(uint32_t code_point);
+    void deflateInput(int flush);
+    void writeOutput(const unsigned char* data, size_t length);
+
+    static constexpr size_t kBufferSize = 64 * 1024;
+
+    std::unique_ptr<z_stream_s> zs_;
+    CompressionSettings settings_;
+    std::filesystem::path path_;
+    std::filesystem::path temp_path_;
+    std::ofstream file_;
+    bool temp_file_ = false;             // temp_path_ exists and was not moved in place yet
+    std::vector<unsigned char>* memory_output_ = nullptr;
+
+    std::vector<char> input_;            // pending utf-8 text, kBufferSize
+    size_t input_length_ = 0;
+    std::vector<unsigned char> output_;  // deflate output before it is written, kBufferSize
+    wchar_t pending_high_surrogate_ = 0; // first half of a pair split across two writes
+    bool started_ = false;
+    bool finished_ = false;
+};
+
+// compresses data using zlib (gzip format) with the selected settings, returns an empty vector for empty input
+std::vector<unsigned char> compress_gzip(const std::string& data);
+std::vector<unsigned char> compress_gzip(const std::string& data, const CompressionSettings& settings);
+
+// decompresses a gzip file's content, including files made of several appended members
+std::string decompress_gzip(const std::vector<unsigned char>& data);
+
+// appends compressed data as a new gzip member at the end of a file
+void AppendCompressedFile(const std::filesystem::path& path, const std::vector<unsigned char>& data);
+
+// core-sized worker threads kept for the plugin's lifetime, so exports and streaming seals don't
+// create and join threads on every call. batches are served in submission order
+class ExportWorkerPool {
+public:
+    explicit ExportWorkerPool(size_t worker_count);
+    ~ExportWorkerPool(); // lets the workers finish the batch they are on, then joins them
+
+    ExportWorkerPool(const ExportWorkerPool&) = delete;
+    ExportWorkerPool& operator=(const ExportWorkerPool&) = delete;
+
+    // the calling thread works on the batch too, so a job may run a batch of its own without
+    // deadlocking. the first exception thrown by a job is rethrown once all jobs are done
+    void Run(const std::vector<std::function<void()>>& jobs);
+
+private:
+    struct Batch;
+
+    static void runJobs(Batch& batch);
+    void workerLoop();
+    void removeBatch(const std::shared_ptr<Batch>& batch);
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::shared_ptr<Batch>> batches_; // batches with jobs left to hand out
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
+
+// the plugin's pool, started when the plugin is created and stopped once nothing can submit anymore
+void StartExportWorkers();
+void StopExportWorkers();
+
+// runs independent export jobs (compress + write) on the plugin's worker pool, or on the calling
+// thread alone when the pool is not running. the first exception thrown by a job is rethrown.
+void RunParallelJobs(const std::vector<std::function<void()>>& jobs);
+
+// one cell of the codec benchmark matrix
+struct CompressionBenchmarkResult {
+    CompressionSettings settings;
+    size_t input_bytes = 0;
+    size_t output_bytes = 0;
+    double seconds = 0.0; // best of the timed runs
+
+    double GetMegabytesPerSecond() const { return seconds > 0.0 ? input_bytes / (1024.0 * 1024.0) / seconds : 0.0; }
+    double GetRatio() const { return output_bytes > 0 ? static_cast<double>(input_bytes) / output_bytes : 0.0; }
+};
+
+// reads every .txt.gz of a recorded capture folder (StoC and Agents) into one plain text corpus, throws on errors
+std::string LoadCaptureCorpus(const std::filesystem::path& match_dir);
+
+// compresses the corpus with every codec and level, slow: call it off the game and render threads
+std::vector<CompressionBenchmarkResult> RunCompressionBenchmark(const std::string& corpus);
@@ -0,0 +1,125 @@
+#include "ObserverEvents.h"
+
+#include <GWCA/Packets/StoC.h>
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    // convert JumboMessage value to a simple party index string for logging
+    const wchar_t* JumboValueToPartyStr(uint32_t value) {
+        switch (value) {
+            case GW::Packet::StoC::JumboMessageValue::PARTY_ONE: return L"Party 1";
+            case GW::Packet::StoC::JumboMessageValue::PARTY_TWO: return L"Party 2";
+            default: return L"Unknown Party";
+        }
+    }
+}
+
+const char* GetCaptureCategoryFileName(CaptureCategory category) {
+    switch (category) {
+        case CaptureCategory::Skill:       return "skill_events.txt.gz";
+        case CaptureCategory::AttackSkill: return "attack_skill_events.txt.gz";
+        case CaptureCategory::BasicAttack: return "basic_attack_events.txt.gz";
+        case CaptureCategory::Combat:      return "combat_events.txt.gz";
+        case CaptureCategory::Agent:       return "agent_events.txt.gz";
+        case CaptureCategory::Jumbo:       return "jumbo_messages.txt.gz";
+        case CaptureCategory::Lord:        return "lord_events.txt.gz";
+        default:                           return "unknown_events.txt.gz";
+    }
+}
+
+int FormatCaptureEvent(const CaptureEvent& event, const CaptureEvent* continuation,
+                       const std::vector<std::wstring>* text_pool,
+                       wchar_t* buffer, size_t buffer_len)
+{
+    if (!buffer || buffer_len == 0) return 0;
+    buffer[0] = L'\0';
+
+    const wchar_t* identifier = GetCaptureEventIdentifier(event.kind);
+    int written = 0;
+
+    switch (event.kind) {
+        case CaptureEventKind::SkillActivated:
+        case CaptureEventKind::InstantSkillUsed:
+        case CaptureEventKind::AttackSkillActivated:
+            // format: identifier;skill_id;caster_id;target_id
+            written = swprintf(buffer, buffer_len, L"%ls;%u;%u;%u", identifier, event.skill_id, event.caster_id, event.target_id);
+            break;
+
+        case CaptureEventKind::AttackStarted:
+            // format: attack_started;caster_id;target_id
+            written = swprintf(buffer, buffer_len, L"%ls;%u;%u", identifier, event.caster_id, event.target_id);
+            break;
+
+        case CaptureEventKind::SkillFinished:
+        case CaptureEventKind::SkillStopped:
+        case CaptureEventKind::AttackSkillFinished:
+        case CaptureEventKind::AttackSkillStopped:
+        case CaptureEventKind::AttackFinished:
+        case CaptureEventKind::AttackStopped:
+        case CaptureEventKind::Interrupted:
+            // format: identifier;caster_id;skill_id;target_id
+            written = swprintf(buffer, buffer_len, L"%ls;%u;%u;%u", identifier, event.caster_id, event.skill_id, event.target_id);
+            break;
+
+        case CaptureEventKind::Damage:
+            // format: damage;caster_id;target_id;value;damage_type_id
+            written = swprintf(buffer, buffer_len, L"%ls;%u;%u;%f;%u", identifier, event.caster_id, event.target_id, event.value, static_cast<uint32_t>(event.aux));
+            break;
+
+        case CaptureEventKind::KnockedDown:
+            // format: knocked_down;target_id;cause_id
+            written = swprintf(buffer, buffer_len, L"%ls;%u;%u", identifier, event.target_id, event.caster_id);
+            break;
+
+        case CaptureEventKind::LordDamage: {
+            // format: lord_damage;caster_id;target_id;value;damage_type;attacking_team;damage;damage_before;damage_after
+            long damage_before = 0;
+            long damage_after = 0;
+            if (continuation && continuation->kind == CaptureEventKind::LordDamageTotals) {
+                damage_before = static_cast<int32_t>(continuation->caster_id);
+                damage_after = static_cast<int32_t>(continuation->target_id);
+            }
+            written = swprintf(buffer, buffer_len, L"%ls;%u;%u;%f;%u;%u;%ld;%ld;%ld", identifier,
+                               event.caster_id, event.target_id, event.value, static_cast<uint32_t>(event.aux),
+                               static_cast<uint32_t>(event.team_id), static_cast<long>(static_cast<int32_t>(event.skill_id)),
+                               damage_before, damage_after);
+            break;
+        }
+
+        case CaptureEventKind::AgentMoveToPoint: {
+            // format: game_smsg_agent_move_to_point;agent_id;x;y;plane
+            float y = 0.0f;
+            std::memcpy(&y, &event.skill_id, sizeof(y));
+            written = swprintf(buffer, buffer_len, L"%ls;%u;%.2f;%.2f;%u", identifier, event.caster_id, event.value, y, static_cast<uint32_t>(event.aux));
+            break;
+        }
+
+        case CaptureEventKind::JumboMessage:
+            // format: game_smsg_jumbo_message;type;value (party)
+            written = swprintf(buffer, buffer_len, L"%ls;%u;%u (%ls)", identifier, static_cast<uint32_t>(event.aux), event.target_id, JumboValueToPartyStr(event.target_id));
+            break;
+
+        case CaptureEventKind::AgentStateUpdate:
+            // format: agent_state_update;agent_id;state
+            written = swprintf(buffer, buffer_len, L"%ls;%u;%u", identifier, event.caster_id, event.target_id);
+            break;
+
+        case CaptureEventKind::DeathResurrection: {
+            // format: death_resurrection;message
+            const wchar_t* message = L"";
+            if (text_pool && event.skill_id < text_pool->size()) {
+                message = (*text_pool)[event.skill_id].c_str();
+            }
+            written = swprintf(buffer, buffer_len, L"%ls;%ls", identifier, message);
+            break;
+        }
+
+        default:
+            // LordDamageTotals is rendered as part of its LordDamage record
+            return 0;
+    }
+
+    return written > 0 ? written : 0;
+}
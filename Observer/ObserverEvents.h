@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+// kinds of StoC events recorded by ObserverCapture
+enum class CaptureEventKind : uint8_t {
+    SkillActivated,
+    InstantSkillUsed,
+    SkillFinished,
+    SkillStopped,
+    AttackSkillActivated,
+    AttackSkillFinished,
+    AttackSkillStopped,
+    AttackStarted,
+    AttackFinished,
+    AttackStopped,
+    Damage,
+    KnockedDown,
+    Interrupted,
+    LordDamage,
+    LordDamageTotals, // always stored right after its LordDamage record
+    AgentMoveToPoint,
+    JumboMessage,
+    AgentStateUpdate,
+    DeathResurrection,
+    Count
+};
+
+// export categories, one StoC/<file>.txt.gz per category
+enum class CaptureCategory : uint8_t {
+    Skill,
+    AttackSkill,
+    BasicAttack,
+    Combat,
+    Agent,
+    Jumbo,
+    Lord,
+    Unknown,
+    Count
+};
+
+constexpr size_t kCaptureCategoryCount = static_cast<size_t>(CaptureCategory::Count);
+
+// fixed-size record of one StoC event, text is only rendered at export (or chat) time.
+// field usage per kind:
+//   skill / attack kinds : caster_id, target_id, skill_id
+//   Damage               : caster_id, target_id, value, aux = damage type
+//   KnockedDown          : caster_id = cause, target_id
+//   LordDamage           : caster_id, target_id, value, aux = damage type, team_id = attacking team, skill_id = damage
+//   LordDamageTotals     : caster_id = team damage before the hit, target_id = team damage after the hit
+//   AgentMoveToPoint     : caster_id = agent, value = x, skill_id = y (float bits), aux = plane
+//   JumboMessage         : aux = message type, target_id = message value
+//   AgentStateUpdate     : caster_id = agent, target_id = state
+//   DeathResurrection    : caster_id = agent, aux = is_dead, skill_id = index of the message in the capture text pool
+struct CaptureEvent {
+    uint32_t time_ms = 0;
+    uint32_t sequence = 0; // arrival order across every category, stamped by ObserverCapture::AddEvent
+    CaptureEventKind kind = CaptureEventKind::Count;
+    uint8_t team_id = 0;
+    uint16_t aux = 0;
+    uint32_t caster_id = 0;
+    uint32_t target_id = 0;
+    uint32_t skill_id = 0;
+    float value = 0.0f;
+};
+static_assert(sizeof(CaptureEvent) == 28, "CaptureEvent is expected to stay 28 bytes");
+static_assert(std::is_trivially_copyable_v<CaptureEvent>, "CaptureEvent must stay a POD record");
+
+// fixed properties of an event kind, looked up by index instead of compared as text
+struct CaptureEventTraits {
+    const wchar_t* identifier;
+    CaptureCategory category; // agent state updates ([AST]) have no dedicated file and end up in unknown_events
+    bool ends_action;         // completions that release the caster's active action, stops keep it
+};
+
+// one entry per CaptureEventKind, in declaration order
+inline constexpr CaptureEventTraits kCaptureEventTraits[] = {
+    { L"SKILL_ACTIVATED",               CaptureCategory::Skill,       false },
+    { L"INSTANT_SKILL_USED",            CaptureCategory::Skill,       false },
+    { L"SKILL_FINISHED",                CaptureCategory::Skill,       true  },
+    { L"SKILL_STOPPED",                 CaptureCategory::Skill,       false },
+    { L"ATTACK_SKILL_ACTIVATED",        CaptureCategory::AttackSkill, false },
+    { L"ATTACK_SKILL_FINISHED",         CaptureCategory::AttackSkill, true  },
+    { L"ATTACK_SKILL_STOPPED",          CaptureCategory::AttackSkill, false },
+    { L"ATTACK_STARTED",                CaptureCategory::BasicAttack, false },
+    { L"ATTACK_FINISHED",               CaptureCategory::BasicAttack, true  },
+    { L"ATTACK_STOPPED",                CaptureCategory::BasicAttack, false },
+    { L"DAMAGE",                        CaptureCategory::Combat,      false },
+    { L"KNOCKED_DOWN",                  CaptureCategory::Combat,      false },
+    { L"INTERRUPTED",                   CaptureCategory::Combat,      true  },
+    { L"LORD_DAMAGE",                   CaptureCategory::Lord,        false },
+    { L"LORD_DAMAGE_TOTALS",            CaptureCategory::Lord,        false },
+    { L"GAME_SMSG_AGENT_MOVE_TO_POINT", CaptureCategory::Agent,       false },
+    { L"GAME_SMSG_JUMBO_MESSAGE",       CaptureCategory::Jumbo,       false },
+    { L"AGENT_STATE_UPDATE",            CaptureCategory::Unknown,     false },
+    { L"DEATH_RESURRECTION",            CaptureCategory::Unknown,     false },
+};
+static_assert(std::size(kCaptureEventTraits) == static_cast<size_t>(CaptureEventKind::Count),
+              "kCaptureEventTraits needs one entry per CaptureEventKind");
+
+inline constexpr CaptureEventTraits kUnknownCaptureEventTraits = { L"UNKNOWN", CaptureCategory::Unknown, false };
+
+constexpr const CaptureEventTraits& GetCaptureEventTraits(CaptureEventKind kind) {
+    return kind < CaptureEventKind::Count ? kCaptureEventTraits[static_cast<size_t>(kind)] : kUnknownCaptureEventTraits;
+}
+constexpr CaptureCategory GetCaptureEventCategory(CaptureEventKind kind) { return GetCaptureEventTraits(kind).category; }
+constexpr const wchar_t* GetCaptureEventIdentifier(CaptureEventKind kind) { return GetCaptureEventTraits(kind).identifier; }
+
+static_assert(GetCaptureEventCategory(CaptureEventKind::DeathResurrection) == CaptureCategory::Unknown, "traits out of order");
+static_assert(GetCaptureEventTraits(CaptureEventKind::Interrupted).ends_action, "traits out of order");
+
+const char* GetCaptureCategoryFileName(CaptureCategory category);
+
+// renders the semicolon-delimited message of an event (without timestamp or marker).
+// continuation is the record following a LordDamage event, text_pool resolves DeathResurrection messages.
+// returns the number of characters written, 0 if the event has no text of its own.
+int FormatCaptureEvent(const CaptureEvent& event, const CaptureEvent* continuation,
+                       const std::vector<std::wstring>* text_pool,
+                       wchar_t* buffer, size_t buffer_len);
@@ -0,0 +1,157 @@
+#include <windows.h>
+#include "ObserverExport.h"
+
+#include <GWCA/Managers/ChatMgr.h>
+#include <GWCA/Managers/GameThreadMgr.h>
+
+#include <algorithm>
+
+const char* GetExportPhaseName(ExportPhase phase) {
+    switch (phase) {
+        case ExportPhase::Infos: return "Infos";
+        case ExportPhase::StoC: return "StoC";
+        case ExportPhase::Agents: return "Agents";
+        case ExportPhase::Finishing: return "Finishing";
+        case ExportPhase::Packing: return "Packing";
+        default: return "Idle";
+    }
+}
+
+void ExportProgress::BeginPhase(ExportPhase phase, uint32_t total_steps) {
+    ThrowIfCancelled();
+    done_steps_ = 0;
+    total_steps_ = total_steps;
+    phase_ = phase;
+}
+
+void ExportProgress::ThrowIfCancelled() const {
+    if (cancel_requested_.load()) {
+        throw ExportCancelled();
+    }
+}
+
+float ExportProgress::GetFraction() const {
+    const uint32_t total = total_steps_.load();
+    if (total == 0) return 0.0f;
+    return static_cast<float>(std::min(done_steps_.load(), total)) / static_cast<float>(total);
+}
+
+ObserverExportQueue::ObserverExportQueue() {
+    worker_ = std::thread(&ObserverExportQueue::run, this);
+}
+
+ObserverExportQueue::~ObserverExportQueue() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stop_ = true;
+        queue_.clear();
+        progress_.cancel_requested_ = true;
+    }
+    queue_cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+void ObserverExportQueue::Enqueue(const std::wstring& name, Job job) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        queue_.emplace_back(name, std::move(job));
+    }
+    queue_cv_.notify_one();
+}
+
+void ObserverExportQueue::CancelAll() {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    queue_.clear();
+    if (running_) {
+        progress_.cancel_requested_ = true;
+    }
+}
+
+void ObserverExportQueue::WaitIdle() {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    idle_cv_.wait(lock, [this]() { return !running_ && queue_.empty(); });
+}
+
+bool ObserverExportQueue::IsBusy() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return running_ || !queue_.empty();
+}
+
+size_t ObserverExportQueue::GetQueuedCount() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return queue_.size();
+}
+
+std::wstring ObserverExportQueue::GetRunningName() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return running_name_;
+}
+
+void ObserverExportQueue::run() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+            if (stop_) break;
+            running_name_ = queue_.front().first;
+            job = std::move(queue_.front().second);
+            queue_.pop_front();
+            running_ = true;
+            progress_.cancel_requested_ = false;
+            progress_.done_steps_ = 0;
+            progress_.total_steps_ = 0;
+        }
+
+        try {
+            job(progress_);
+        } catch (const ExportCancelled&) {
+            PostChatMessage(L"Export of '" + running_name_ + L"' cancelled.");
+        } catch (const std::exception& e) {
+            // jobs report their own errors, this only catches what escaped them
+            PostExportError("Export worker error: ", e.what());
+        } catch (...) {
+            PostChatMessage(L"An unexpected error occurred during export.");
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            running_ = false;
+            running_name_.clear();
+            progress_.phase_ = ExportPhase::Idle;
+        }
+        idle_cv_.notify_all();
+    }
+
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    running_ = false;
+    idle_cv_.notify_all();
+}
+
+void PostChatMessage(const std::wstring& message) {
+    GW::GameThread::Enqueue([message]() {
+        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, message.c_str());
+    });
+}
+
+// converts the narrow error string to a wide string for chat
+static void FormatExportError(const char* prefix, const char* what, wchar_t (&werror_msg)[512]) {
+    std::string error_msg_str = prefix;
+    error_msg_str += what;
+    werror_msg[0] = L'\0';
+    MultiByteToWideChar(CP_UTF8, 0, error_msg_str.c_str(), -1, werror_msg, 512);
+}
+
+void PostExportError(const char* prefix, const char* what) {
+    wchar_t werror_msg[512];
+    FormatExportError(prefix, what, werror_msg);
+    PostChatMessage(werror_msg);
+}
+
+void WriteExportError(const char* prefix, const char* what) {
+    wchar_t werror_msg[512];
+    FormatExportError(prefix, what, werror_msg);
+    GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, werror_msg);
+}
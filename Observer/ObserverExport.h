@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <cstdint>
+
+// phases of a job on the export queue. exports run Infos to Finishing in order
+enum class ExportPhase : uint8_t {
+    Idle,
+    Infos,
+    StoC,
+    Agents,
+    Finishing, // archive table of contents, summary
+    Packing,   // compressing a retained match session in memory
+};
+
+const char* GetExportPhaseName(ExportPhase phase);
+
+// thrown by export code once cancellation was requested
+class ExportCancelled : public std::runtime_error {
+public:
+    ExportCancelled() : std::runtime_error("Export cancelled.") {}
+};
+
+// progress of the running export, written by the worker and read by the ui
+class ExportProgress {
+public:
+    void BeginPhase(ExportPhase phase, uint32_t total_steps); // steps are StoC categories or agents
+    void Step() { ++done_steps_; }
+    void ThrowIfCancelled() const; // called by export jobs between files and batches
+
+    ExportPhase GetPhase() const { return phase_.load(); }
+    uint32_t GetDoneSteps() const { return done_steps_.load(); }
+    uint32_t GetTotalSteps() const { return total_steps_.load(); }
+    float GetFraction() const; // of the current phase
+
+private:
+    friend class ObserverExportQueue;
+
+    std::atomic<ExportPhase> phase_{ExportPhase::Idle};
+    std::atomic<uint32_t> done_steps_{0};
+    std::atomic<uint32_t> total_steps_{0};
+    std::atomic<bool> cancel_requested_{false};
+};
+
+// runs queued exports one after the other on a background worker, so neither the render thread
+// nor the InstanceLoadInfo hook waits on compression. jobs must only work on data snapshotted
+// when they were queued, the next match may be capturing meanwhile.
+class ObserverExportQueue {
+public:
+    using Job = std::function<void(ExportProgress& progress)>;
+
+    ObserverExportQueue();
+    ~ObserverExportQueue(); // cancels whatever is left and joins the worker
+
+    void Enqueue(const std::wstring& name, Job job);
+    void CancelAll();  // cancels the running export and drops the queued ones
+    void WaitIdle();   // blocks until every queued export has run
+
+    bool IsBusy() const;
+    size_t GetQueuedCount() const; // not counting the running export
+    std::wstring GetRunningName() const;
+    const ExportProgress& GetProgress() const { return progress_; }
+
+private:
+    void run();
+
+    mutable std::mutex queue_mutex_;
+    std::condition_variable queue_cv_; // wakes the worker on new jobs and on shutdown
+    std::condition_variable idle_cv_;  // wakes WaitIdle callers
+    std::deque<std::pair<std::wstring, Job>> queue_;
+    std::wstring running_name_;
+    bool running_ = false;
+    bool stop_ = false;
+    ExportProgress progress_;
+    std::thread worker_;
+};
+
+// chat output for worker threads, the message is written on the game thread
+void PostChatMessage(const std::wstring& message);
+// reports an export or sealing error in chat as prefix + what, from whichever thread hit it
+void PostExportError(const char* prefix, const char* what);
+// the same, written right away for callers already on the game thread
+void WriteExportError(const char* prefix, const char* what);
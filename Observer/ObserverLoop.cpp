@@ -1,6 +1,12 @@
 #include "ObserverLoop.h"
 #include "ObserverPlugin.h"
 #include "ObserverMatch.h"
+#include "ObserverCompression.h"
+#include "ObserverStream.h"
+#include "ObserverTrajectory.h"
+#include "ObserverArchive.h"
+#include "ObserverExport.h"
+#include "ObserverChunks.h"
 
 #include <GWCA/GWCA.h>
 #include <GWCA/Managers/AgentMgr.h>
@@ -18,8 +24,8 @@
 
 #include <filesystem>
 #include <chrono>
-#include <sstream>
-#include <iomanip>
+#include <cstdio>
+#include <algorithm>
 #include <cmath> 
 #include <limits> 
 
@@ -28,10 +34,6 @@
 #include <GWCA/GameEntities/Party.h>
 #include <GWCA/GameEntities/Player.h>
 
-// shared export helpers from ObserverCapture.cpp
-extern std::vector<unsigned char> compress_gzip(const std::string& data); // compress_gzip
-extern std::string WStringToUTF8(const std::wstring& wstr); // WStringToUTF8
-extern void WriteCompressedFile(const std::filesystem::path& path, const std::vector<unsigned char>& data); // WriteCompressedFile
 
 
 
@@ -66,8 +68,12 @@ float ManhattanDistance(float x1, float y1, float z1, float x2, float y2, float
     return std::abs(x1 - x2) + std::abs(y1 - y2) + std::abs(z1 - z2); // calculate the Manhattan distance between two points
 }
 
+// not streaming: snapshots of an agent sealed into one compressed chunk, a few minutes of a moving player
+constexpr size_t kAgentChunkSnapshots = 1024;
+
 ObserverLoop::ObserverLoop(ObserverPlugin* owner_plugin, ObserverMatch* match_handler) 
-    : owner_(owner_plugin), match_handler_(match_handler), run_loop_(false) {
+    : owner_(owner_plugin), match_handler_(match_handler), run_loop_(false),
+      agent_chunks_(std::make_shared<CaptureChunkStore>()) {
 }
 
 ObserverLoop::~ObserverLoop() {
@@ -97,134 +103,365 @@ void ObserverLoop::Stop() {
     // clear last entries map when stopping to ensure fresh data on next start
     std::lock_guard<std::mutex> lock(log_mutex_);
     last_agent_state_.clear();
+    agent_attributes_.Clear(); // agent ids are reused by the next instance
 }
 
 void ObserverLoop::ClearAgentLogs() {
     {
+        std::lock_guard<std::mutex> seal_lock(seal_mutex_); // waits for a running seal
         std::lock_guard<std::mutex> lock(log_mutex_);
         agent_logs_.clear();
         last_agent_state_.clear();
+        agent_chunks_ = std::make_shared<CaptureChunkStore>();
+        agent_chunk_counts_.clear();
+        agent_chunking_failed_ = false;
     }
+    streamed_agent_chunks_ = 0;
     // clear party logs via match_handler_
     if (match_handler_) {
         match_handler_->GetMatchInfo().ClearAgentInfoMap();
     }
 }
 
-bool ObserverLoop::ExportAgentLogs(const wchar_t* folder_name) {
-    if (!owner_) return false;
-    
-    // create a local copy of the logs to avoid locking during entire export
-    std::map<uint32_t, std::vector<std::pair<uint32_t, AgentState>>> logs_copy;
+bool ObserverLoop::HasAgentLogs() const {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    return !agent_logs_.empty() || !agent_chunk_counts_.empty();
+}
+
+size_t ObserverLoop::GetAgentLogMemoryBytes() const {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    size_t bytes = static_cast<size_t>(agent_chunks_->GetMemoryBytes());
+    for (const auto& agent_log : agent_logs_) {
+        bytes += agent_log.second.GetMemoryBytes();
+    }
+    return bytes;
+}
+
+size_t AgentLogSnapshot::GetMemoryBytes() const {
+    size_t bytes = chunks ? static_cast<size_t>(chunks->GetMemoryBytes()) : 0;
+    for (const auto& agent_log : logs) {
+        bytes += agent_log.second.GetMemoryBytes();
+    }
+    return bytes;
+}
+
+// formats one agent state snapshot as a timestamped semicolon-delimited line, floats with 3 decimals.
+// returns the line length including its newline, 0 if it didn't fit
+static size_t FormatAgentLogLine(char* buffer, size_t size, uint32_t timestamp_ms, const AgentState& state) {
+    const int length = snprintf(buffer, size,
+        "[%02u:%02u.%03u] "
+        "%.3f;%.3f;%.3f;%.3f;%u;%u;%u;"
+        "%d;%d;%.3f;%d;%u;"
+        "%d;%d;%d;%d;%d;%d;%d;%d;%d;%d;"
+        "%d;%d;%u;%u;%u;%u;%u;"
+        "%.3f;%.3f;%u;%u;%u;%.3f;%.3f;%u;%.3f;"
+        "%u;%u;%u;%.3f;%.3f;%u;%u;%u;%u;%u\n",
+        (timestamp_ms / 1000) / 60, (timestamp_ms / 1000) % 60, timestamp_ms % 1000,
+        state.x, state.y, state.z, state.rotation_angle, state.weapon_id, state.model_id, state.gadget_id,
+        state.Has(AgentStateFlag::Alive) ? 1 : 0, state.Has(AgentStateFlag::Dead) ? 1 : 0, state.health_pct, state.Has(AgentStateFlag::Knocked) ? 1 : 0, state.max_hp,
+        state.Has(AgentStateFlag::Condition) ? 1 : 0, state.Has(AgentStateFlag::DeepWound) ? 1 : 0, state.Has(AgentStateFlag::Bleeding) ? 1 : 0,
+        state.Has(AgentStateFlag::Crippled) ? 1 : 0, state.Has(AgentStateFlag::Blind) ? 1 : 0, state.Has(AgentStateFlag::Poison) ? 1 : 0,
+        state.Has(AgentStateFlag::Hex) ? 1 : 0, state.Has(AgentStateFlag::DegenHex) ? 1 : 0,
+        state.Has(AgentStateFlag::Enchantment) ? 1 : 0, state.Has(AgentStateFlag::WeaponSpell) ? 1 : 0,
+        state.Has(AgentStateFlag::Holding) ? 1 : 0, state.Has(AgentStateFlag::Casting) ? 1 : 0, state.skill_id,
+        static_cast<uint32_t>(state.weapon_item_type), static_cast<uint32_t>(state.offhand_item_type),
+        static_cast<uint32_t>(state.weapon_item_id), static_cast<uint32_t>(state.offhand_item_id),
+        state.move_x, state.move_y, static_cast<uint32_t>(state.visual_effects), static_cast<uint32_t>(state.team_id),
+        static_cast<uint32_t>(state.weapon_type), state.weapon_attack_speed, state.attack_speed_modifier,
+        static_cast<uint32_t>(state.dagger_status), state.hp_pips,
+        state.model_state, state.animation_code, state.animation_id, state.animation_speed, state.animation_type,
+        state.in_spirit_range, static_cast<uint32_t>(state.agent_model_type),
+        state.item_id, state.item_extra_type, state.gadget_extra_type);
+    return (length > 0 && static_cast<size_t>(length) < size) ? static_cast<size_t>(length) : 0;
+}
+
+// expands the snapshots of a delta encoded log into the sink through a small fixed buffer,
+// and into the binary trajectory when one is written
+static void WriteAgentLogLines(GzipSink& sink, TrajectoryWriter* trajectory, const AgentStateLog& log) {
+    char line[1024];
+    AgentStateLog::Reader reader(log);
+    uint32_t timestamp_ms;
+    AgentState state;
+    while (reader.Next(timestamp_ms, state)) {
+        const size_t length = FormatAgentLogLine(line, sizeof(line), timestamp_ms, state);
+        sink.Write(line, length);
+        if (trajectory) trajectory->Add(timestamp_ms, state);
+    }
+}
+
+// one agent of a snapshot: its sealed chunks, then its snapshots still in memory
+struct AgentLogRange {
+    uint32_t agent_id = 0;
+    size_t chunk_count = 0;
+    const AgentStateLog* log = nullptr; // nullptr when every snapshot of the agent was sealed
+    size_t snapshot_count = 0;          // about, chunks are counted as full
+};
+
+// the chunks of a range unpacked one at a time, in order. checks for cancellation between chunks
+template <typename Visit>
+static void ForEachAgentChunk(const AgentLogSnapshot& logs, const AgentLogRange& range, const ExportProgress* progress,
+                              Visit&& visit) {
+    for (size_t i = 0; i < range.chunk_count; ++i) {
+        if (progress) progress->ThrowIfCancelled();
+        AgentStateLog chunk;
+        UnpackAgentStateLog(logs.chunks->LoadPacked(range.agent_id, i), chunk);
+        visit(static_cast<const AgentStateLog&>(chunk));
+    }
+    if (range.log) visit(*range.log);
+}
+
+// orders agents by snapshot count, largest first, so long jobs don't end up last on the pool
+static void SortBySnapshotCount(std::vector<AgentLogRange>& ranges) {
+    std::stable_sort(ranges.begin(), ranges.end(), [](const auto& a, const auto& b) {
+        return a.snapshot_count > b.snapshot_count;
+    });
+}
+
+// every agent of a snapshot, largest first
+static std::vector<AgentLogRange> CollectAgentLogRanges(const AgentLogSnapshot& logs) {
+    std::vector<AgentLogRange> ranges;
+    for (const auto& [agent_id, chunk_count] : logs.chunk_counts) {
+        ranges.push_back({agent_id, chunk_count, nullptr, chunk_count * kAgentChunkSnapshots});
+    }
+    for (const auto& [agent_id, log] : logs.logs) {
+        auto it = std::find_if(ranges.begin(), ranges.end(), [id = agent_id](const AgentLogRange& range) {
+            return range.agent_id == id;
+        });
+        if (it == ranges.end()) it = ranges.insert(ranges.end(), AgentLogRange{agent_id});
+        it->log = &log;
+        it->snapshot_count += log.Size();
+    }
+    SortBySnapshotCount(ranges);
+    return ranges;
+}
+
+AgentLogSnapshot ObserverLoop::TakeAgentLogSnapshot() const {
+    // the logs are delta encoded and the chunks shared, so copying is far cheaper than expanding them
+    AgentLogSnapshot snapshot;
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    snapshot.logs = agent_logs_;
+    snapshot.chunks = agent_chunks_;
+    snapshot.chunk_counts = agent_chunk_counts_;
+    return snapshot;
+}
+
+AgentLogSnapshot ObserverLoop::DetachAgentLogs() {
+    AgentLogSnapshot detached;
     {
+        std::lock_guard<std::mutex> seal_lock(seal_mutex_);
         std::lock_guard<std::mutex> lock(log_mutex_);
-        // only copy if there are logs to prevent unnecessary work
-        if (!agent_logs_.empty()){
-            logs_copy = agent_logs_;
-        } else {
-             // if no logs, report and exit early
-             if (owner_) {
-                GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, L"No agent logs to export.");
-             }
-             return false; 
+        detached.logs.swap(agent_logs_);
+        detached.chunk_counts.swap(agent_chunk_counts_);
+        detached.chunks = std::move(agent_chunks_);
+        agent_chunks_ = std::make_shared<CaptureChunkStore>();
+        agent_chunking_failed_ = false;
+        last_agent_state_.clear(); // the next snapshot of every agent is logged in full
+        detached.stream = std::move(stream_);
+        detached.streamed_chunk_count = streamed_agent_chunks_.exchange(0);
+    }
+    return detached;
+}
+
+void ObserverLoop::SetStream(std::shared_ptr<ObserverStream> stream) {
+    std::lock_guard<std::mutex> seal_lock(seal_mutex_); // a running seal finishes with the stream it started on
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    stream_ = std::move(stream);
+    streamed_agent_chunks_ = 0;
+}
+
+// streaming: the agent files hold what was sealed during the match, only the detached tail is left to append.
+// never cancelled halfway, like the StoC flush
+bool ObserverLoop::FlushAgentStream(const wchar_t* folder_name, const AgentLogSnapshot& tail, ExportProgress* progress) {
+    if (!tail.stream) return false;
+    if (tail.streamed_chunk_count == 0 && tail.Empty()) {
+        PostChatMessage(L"No agent logs to export.");
+        return false;
+    }
+
+    try {
+        tail.stream->Relocate(folder_name);
+
+        std::vector<AgentLogRange> ranges = CollectAgentLogRanges(tail);
+        if (progress) progress->BeginPhase(ExportPhase::Agents, static_cast<uint32_t>(ranges.size()));
+        std::vector<std::function<void()>> jobs;
+        for (const AgentLogRange& range : ranges) {
+            jobs.push_back([&tail, &range, progress]() {
+                std::vector<unsigned char> chunk;
+                GzipSink sink(chunk);
+                ForEachAgentChunk(tail, range, nullptr, [&sink](const AgentStateLog& log) {
+                    WriteAgentLogLines(sink, nullptr, log);
+                });
+                sink.Finish();
+                tail.stream->Append(std::filesystem::path("Agents") / (std::to_wstring(range.agent_id) + L".txt.gz"), chunk);
+                if (progress) progress->Step();
+            });
         }
-    } // mutex released here
-    
-    // check again if the copy is empty (although the previous check should handle this)
-    if (logs_copy.empty()) {
+        RunParallelJobs(jobs);
+        return true;
+    } catch (const std::exception& e) {
+        PostExportError("Error exporting agent logs: ", e.what());
         return false;
     }
-    
+}
+
+bool ObserverLoop::ExportAgentLogs(const wchar_t* folder_name, const AgentLogSnapshot& logs,
+                                   ObserverArchiveWriter* archive, ExportProgress* progress) {
+    if (!owner_) return false;
+
+    std::vector<AgentLogRange> ranges = CollectAgentLogRanges(logs);
+    if (ranges.empty()) {
+        // if no logs, report and exit early
+        PostChatMessage(L"No agent logs to export.");
+        return false;
+    }
+
     try {
         std::filesystem::path base_dir = "captures";
         std::filesystem::path match_dir = base_dir / folder_name;
         std::filesystem::path agents_dir = match_dir / "Agents";
         
         // create directories if they don't exist
-        std::filesystem::create_directories(agents_dir);
+        if (!archive) std::filesystem::create_directories(agents_dir);
         
-        // export each agent's logs to its own file
-        for (const auto& [agent_id, log_entries] : logs_copy) {
-            // format log entries from AgentState structs
-            std::wstringstream buffer;
-            buffer << std::fixed << std::setprecision(3); 
-            for (const auto& entry_pair : log_entries) {
-                const uint32_t timestamp_ms = entry_pair.first;
-                const AgentState& state = entry_pair.second;
-
-                // format timestamp
-                wchar_t timestamp[32];
-                swprintf(timestamp, 32, L"[%02u:%02u.%03u] ", 
-                         (timestamp_ms / 1000) / 60, 
-                         (timestamp_ms / 1000) % 60, 
-                         timestamp_ms % 1000);
-                buffer << timestamp;                // format AgentState back into the semicolon-delimited string
-                buffer << state.x << L";" << state.y << L";" << state.z << L";"
-                       << state.rotation_angle << L";" << state.weapon_id << L";"
-                       << state.model_id << L";" << state.gadget_id << L";"
-                       << (state.is_alive ? L"1" : L"0") << L";"
-                       << (state.is_dead ? L"1" : L"0") << L";"
-                       << state.health_pct << L";"
-                       << (state.is_knocked ? L"1" : L"0") << L";"
-                       << state.max_hp << L";"
-                       << (state.has_condition ? L"1" : L"0") << L";"
-                       << (state.has_deep_wound ? L"1" : L"0") << L";"
-                       << (state.has_bleeding ? L"1" : L"0") << L";"
-                       << (state.has_crippled ? L"1" : L"0") << L";"
-                       << (state.has_blind ? L"1" : L"0") << L";"
-                       << (state.has_poison ? L"1" : L"0") << L";"
-                       << (state.has_hex ? L"1" : L"0") << L";"
-                       << (state.has_degen_hex ? L"1" : L"0") << L";"
-                       << (state.has_enchantment ? L"1" : L"0") << L";"
-                       << (state.has_weapon_spell ? L"1" : L"0") << L";"
-                       << (state.is_holding ? L"1" : L"0") << L";"
-                       << (state.is_casting ? L"1" : L"0") << L";"
-                       << state.skill_id << L";"
-                       << static_cast<uint32_t>(state.weapon_item_type) << L";"
-                       << static_cast<uint32_t>(state.offhand_item_type) << L";"
-                       << state.weapon_item_id << L";"
-                       << state.offhand_item_id << L";"
-                       << state.move_x << L";" << state.move_y << L";"
-                       << state.visual_effects << L";" << static_cast<uint32_t>(state.team_id) << L";"
-                       << state.weapon_type << L";"
-                       << state.weapon_attack_speed << L";" << state.attack_speed_modifier << L";"
-                       << static_cast<uint32_t>(state.dagger_status) << L";"
-                       << state.hp_pips << L";"
-                       << state.model_state << L";" << state.animation_code << L";"
-                       << state.animation_id << L";" << state.animation_speed << L";"
-                       << state.animation_type << L";"
-                       << state.in_spirit_range << L";" << state.agent_model_type << L";"
-                       << state.item_id << L";"
-                       << state.item_extra_type << L";" << state.gadget_extra_type;
-
-                buffer << L"\n";
-            }
-            
-            // create file name using agent ID
-            std::wstring filename = std::to_wstring(agent_id) + L".txt.gz";
-            std::filesystem::path agent_file = agents_dir / filename;
-            
-            // compress and write data
-            WriteCompressedFile(agent_file, compress_gzip(WStringToUTF8(buffer.str())));
+        // export each agent's logs to its own file, one job per agent on the worker pool
+        const bool write_trajectories = owner_->export_agent_trajectories;
+        if (progress) progress->BeginPhase(ExportPhase::Agents, static_cast<uint32_t>(ranges.size()));
+        std::vector<std::function<void()>> jobs;
+        for (const AgentLogRange& range : ranges) {
+            jobs.push_back([range, &logs, &agents_dir, archive, progress, write_trajectories]() {
+                if (progress) progress->ThrowIfCancelled();
+
+                // create file name using agent ID
+                const uint32_t agent_id = range.agent_id;
+                std::wstring filename = std::to_wstring(agent_id) + L".txt.gz";
+                const std::filesystem::path trajectory_path = agents_dir / (std::to_wstring(agent_id) + L".traj");
+                std::vector<unsigned char> text_data;       // archive exports build both files in memory
+                std::vector<unsigned char> trajectory_data;
+                std::optional<GzipSink> sink;
+                std::optional<TrajectoryWriter> trajectory;
+                if (archive) {
+                    sink.emplace(text_data);
+                    if (write_trajectories) trajectory.emplace(trajectory_data, agent_id);
+                } else {
+                    sink.emplace(agents_dir / filename);
+                    if (write_trajectories) trajectory.emplace(trajectory_path, agent_id);
+                }
+
+                ForEachAgentChunk(logs, range, progress, [&](const AgentStateLog& log) {
+                    WriteAgentLogLines(*sink, trajectory ? &*trajectory : nullptr, log);
+                });
+                sink->Finish();
+                if (trajectory) trajectory->Finish();
+
+                if (archive) {
+                    const std::string name = "Agents/" + std::to_string(agent_id);
+                    archive->AddStream(name + ".txt.gz", ArchiveCodec::Gzip, std::move(text_data));
+                    if (trajectory) archive->AddStream(name + ".traj", ArchiveCodec::Stored, std::move(trajectory_data));
+                }
+                if (progress) progress->Step();
+            });
         }
+        RunParallelJobs(jobs);
         
         return true;
+    } catch (const ExportCancelled&) {
+        throw; // reported once by the export queue
     } catch (const std::exception& e) {
-        if (owner_) {
-            wchar_t werror_msg[512] = {0}; // initialize buffer
-            std::string error_msg = "Error exporting agent logs: "; // error message
-            error_msg += e.what(); // add the error message
-            MultiByteToWideChar(CP_UTF8, 0, error_msg.c_str(), -1, werror_msg, 512); // convert the error message to a wide string
-            GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, werror_msg); // write the error message to the chat
-        }
+        PostExportError("Error exporting agent logs: ", e.what());
         return false;
     }
 }
 
+void ObserverLoop::SealAgentLogs() {
+    std::lock_guard<std::mutex> seal_lock(seal_mutex_); // detach waits for the chunks to be in
+
+    // take the pending snapshots, the loop keeps filling a fresh map meanwhile
+    std::shared_ptr<ObserverStream> stream;
+    AgentLogMap pending_logs;
+    {
+        std::lock_guard<std::mutex> lock(log_mutex_);
+        if (!stream_ || !stream_->IsActive()) return;
+        stream = stream_;
+        pending_logs.swap(agent_logs_);
+    }
+
+    // one job per agent, each agent file only gets one chunk per seal so appends can't reorder
+    std::vector<std::function<void()>> jobs;
+    std::vector<uint8_t> written(pending_logs.size(), 0);
+    size_t index = 0;
+    for (auto it = pending_logs.begin(); it != pending_logs.end(); ++it, ++index) {
+        if (it->second.Empty()) continue;
+        jobs.push_back([this, &stream, it, &written, index]() {
+            std::vector<unsigned char> chunk;
+            GzipSink sink(chunk);
+            WriteAgentLogLines(sink, nullptr, it->second);
+            sink.Finish();
+
+            std::filesystem::path agent_file = std::filesystem::path("Agents") / (std::to_wstring(it->first) + L".txt.gz");
+            stream->Append(agent_file, chunk);
+            written[index] = 1;
+            streamed_agent_chunks_ += 1;
+        });
+    }
+
+    try {
+        RunParallelJobs(jobs);
+    } catch (...) {
+        // put back what was not written, ahead of the snapshots taken since
+        std::lock_guard<std::mutex> lock(log_mutex_);
+        index = 0;
+        for (auto it = pending_logs.begin(); it != pending_logs.end(); ++it, ++index) {
+            if (written[index]) continue;
+            agent_logs_[it->first].Prepend(it->second);
+        }
+        throw;
+    }
+}
+
+// runs on the loop thread, the only one appending snapshots, so a log can't grow while its copy is packed
+void ObserverLoop::sealAgentChunks() {
+    std::lock_guard<std::mutex> seal_lock(seal_mutex_); // detach and clear wait for the chunks to be in
+    std::vector<std::pair<uint32_t, AgentStateLog>> full_logs;
+    {
+        std::lock_guard<std::mutex> lock(log_mutex_);
+        if (agent_chunking_failed_) return;
+        for (const auto& [agent_id, log] : agent_logs_) {
+            if (log.Size() >= kAgentChunkSnapshots) full_logs.emplace_back(agent_id, log);
+        }
+    }
+    if (full_logs.empty()) return;
+
+    try {
+        std::vector<std::vector<unsigned char>> packed;
+        for (const auto& full_log : full_logs) {
+            packed.push_back(PackAgentStateLog(full_log.second));
+        }
+        {
+            // the chunks and the drops land together, a snapshot sees the snapshots in exactly one of them
+            std::lock_guard<std::mutex> lock(log_mutex_);
+            for (size_t i = 0; i < full_logs.size(); ++i) {
+                const auto& [agent_id, log] = full_logs[i];
+                agent_chunks_->Append(agent_id, std::move(packed[i]), log.Size());
+                ++agent_chunk_counts_[agent_id];
+                agent_logs_[agent_id].DropFront(log.Size());
+            }
+        }
+        CaptureChunkStore::SpillOverBudget();
+    } catch (const std::exception& e) {
+        {
+            std::lock_guard<std::mutex> lock(log_mutex_);
+            agent_chunking_failed_ = true;
+        }
+        PostExportError("Agent log chunk sealing stopped, snapshots stay uncompressed: ", e.what());
+    }
+}
+
 void ObserverLoop::RunLoop() {
     const uint32_t kLoopInterval = 200; // milliseconds between updates
     const float kPositionThreshold = 30.0f;
     const float kDistanceThresholdSq = kPositionThreshold * kPositionThreshold; 
+    const auto kStreamSealInterval = std::chrono::seconds(30); // streaming: how often snapshots are sealed to disk
+    auto last_seal = std::chrono::steady_clock::now();
     
     while (run_loop_.load()) {
         uint32_t instance_time_ms = GW::Map::GetInstanceTime(); // get the instance time
@@ -236,11 +473,22 @@ void ObserverLoop::RunLoop() {
         GW::AgentArray* agents = GW::Agents::GetAgentArray(); // get the agent array
         if (agents && agents->valid()) { // check if the agent array is valid
             std::lock_guard<std::mutex> lock(log_mutex_); // lock the log mutex
+            agent_attributes_.BeginUpdate();
             for (size_t i = 0; i < agents->size(); i++) { // iterate through the agents
                 GW::Agent* agent = (*agents)[i]; // get the agent
                 if (!agent) continue; // if the agent is invalid, continue
                 
                 uint32_t current_agent_id = agent->agent_id; // get the agent id
+
+                // attributes the StoC hooks read per packet
+                StoCAgentSnapshot attributes;
+                if (GW::AgentLiving* living = agent->GetAsAgentLiving()) {
+                    attributes.is_living = 1;
+                    attributes.max_hp = living->max_hp;
+                    attributes.player_number = static_cast<uint16_t>(living->player_number);
+                    attributes.team_id = static_cast<uint8_t>(living->team_id);
+                }
+                agent_attributes_.Set(current_agent_id, attributes);
                 AgentState current_state = GetAgentState(agent); // get the agent state
 
                 auto it = last_agent_state_.find(current_agent_id); // find the agent in the last agent state
@@ -253,27 +501,41 @@ void ObserverLoop::RunLoop() {
                     float dz = current_state.z - last_state.z;
                     float distSq = dx*dx + dy*dy + dz*dz;
 
-                    // create temporary copies excluding position for full state comparison
-                    AgentState current_state_no_pos = current_state;
-                    current_state_no_pos.x = current_state_no_pos.y = current_state_no_pos.z = 0.0f;
-                    AgentState last_state_no_pos = last_state;
-                    last_state_no_pos.x = last_state_no_pos.y = last_state_no_pos.z = 0.0f;
-
-                    if (distSq < kDistanceThresholdSq && current_state_no_pos == last_state_no_pos) {
+                    if (distSq < kDistanceThresholdSq && current_state.SameExceptPosition(last_state)) {
                         // only position changed slightly, and rest of state is identical
                         should_log = false; // don't log this minor movement
                     }
                 }
 
                 if (should_log) {
-                    agent_logs_[current_agent_id].push_back({instance_time_ms, current_state}); // add the current state to the agent logs
+                    agent_logs_[current_agent_id].Append(instance_time_ms, current_state); // add the current state to the agent logs
                     last_agent_state_[current_agent_id] = current_state; // update the last agent state
                 }
             }
+            agent_attributes_.EndUpdate();
         }
 
         UpdatePartiesInformations(); 
 
+        // streaming: periodically move the snapshots out of memory into the agent files,
+        // otherwise long logs are sealed into chunks under the capture memory budget
+        std::shared_ptr<ObserverStream> stream;
+        {
+            std::lock_guard<std::mutex> lock(log_mutex_);
+            stream = stream_;
+        }
+        const bool streaming = stream && stream->IsActive();
+        if (!streaming) sealAgentChunks();
+        if (streaming && std::chrono::steady_clock::now() - last_seal >= kStreamSealInterval) {
+            last_seal = std::chrono::steady_clock::now();
+            try {
+                SealAgentLogs();
+            } catch (const std::exception& e) {
+                stream->End();
+                PostExportError("Capture streaming stopped, agent logs stay in memory: ", e.what());
+            }
+        }
+
         std::this_thread::sleep_for(std::chrono::milliseconds(kLoopInterval));
     }
 }
@@ -476,6 +738,9 @@ void ObserverLoop::UpdatePartiesInformations() {
             }
         }
     }
+
+    // packet handlers read the roster lock-free, hand them the new one if an agent joined or changed
+    match_info.PublishRoster();
 }
 
 AgentState ObserverLoop::GetAgentState(GW::Agent* agent) {
@@ -499,28 +764,28 @@ AgentState ObserverLoop::GetAgentState(GW::Agent* agent) {
         state.model_id = living->player_number;
         
         // health and status
-        state.is_alive = !living->GetIsDead();
-        state.is_dead = living->GetIsDead();
+        state.Set(AgentStateFlag::Alive, !living->GetIsDead());
+        state.Set(AgentStateFlag::Dead, living->GetIsDead());
         state.health_pct = living->hp;
-        state.is_knocked = living->GetIsKnockedDown();
+        state.Set(AgentStateFlag::Knocked, living->GetIsKnockedDown());
         state.max_hp = living->max_hp;
         
         // condition flags
-        state.has_condition = living->GetIsConditioned();
-        state.has_deep_wound = living->GetIsDeepWounded(); 
-        state.has_bleeding = living->GetIsBleeding(); 
-        state.has_crippled = living->GetIsCrippled(); 
-        state.has_blind = false; // placeholder - to implement later
-        state.has_poison = living->GetIsPoisoned();
-        state.has_hex = living->GetIsHexed();
-        state.has_degen_hex = living->GetIsDegenHexed(); 
+        state.Set(AgentStateFlag::Condition, living->GetIsConditioned());
+        state.Set(AgentStateFlag::DeepWound, living->GetIsDeepWounded());
+        state.Set(AgentStateFlag::Bleeding, living->GetIsBleeding());
+        state.Set(AgentStateFlag::Crippled, living->GetIsCrippled());
+        // AgentStateFlag::Blind is a placeholder - to implement later
+        state.Set(AgentStateFlag::Poison, living->GetIsPoisoned());
+        state.Set(AgentStateFlag::Hex, living->GetIsHexed());
+        state.Set(AgentStateFlag::DegenHex, living->GetIsDegenHexed());
         
         // buff status
-        state.has_enchantment = living->GetIsEnchanted();
-        state.has_weapon_spell = living->GetIsWeaponSpelled();
+        state.Set(AgentStateFlag::Enchantment, living->GetIsEnchanted());
+        state.Set(AgentStateFlag::WeaponSpell, living->GetIsWeaponSpelled());
         // action status
-        state.is_holding = (living->model_state & 0x400) != 0;
-        state.is_casting = living->GetIsCasting(); 
+        state.Set(AgentStateFlag::Holding, (living->model_state & 0x400) != 0);
+        state.Set(AgentStateFlag::Casting, living->GetIsCasting());
         state.skill_id = living->skill;
         // weapon and offhand equipment
         state.weapon_item_type = living->weapon_item_type;
@@ -5,6 +5,10 @@
 #include "ObserverMatchData.h"
 #include "ObserverCapture.h" 
 #include "ObserverLoop.h"    
+#include "ObserverStream.h"
+#include "ObserverArchive.h"
+#include "ObserverExport.h"
+#include "ObserverSession.h"
 #include "TextUtils.h"
 
 #include <GWCA/Managers/StoCMgr.h>     
@@ -28,15 +32,35 @@
 #include <sstream>    
 #include <vector>     
 #include <algorithm>  
+#include <chrono>
+#include <optional>
+#include <memory>
 #include <windows.h>  
 
 #include <GWCA/Utilities/Scanner.h>
 
+namespace {
+    // fields of the loop's refresh that the team view reads
+    bool SameTeamViewFields(const AgentDetails& a, const AgentDetails& b) {
+        return a.type == b.type && a.team_id == b.team_id && a.player_number == b.player_number &&
+               a.primary_profession == b.primary_profession && a.secondary_profession == b.secondary_profession &&
+               a.guild_id == b.guild_id && a.encoded_name == b.encoded_name;
+    }
+
+    std::string ToUtf8(const std::wstring& str) {
+        if (str.empty()) return "";
+        const int size_needed = WideCharToMultiByte(CP_UTF8, 0, str.c_str(), (int)str.size(), NULL, 0, NULL, NULL);
+        if (size_needed <= 0) return "";
+        std::string utf8(size_needed, 0);
+        WideCharToMultiByte(CP_UTF8, 0, str.c_str(), (int)str.size(), &utf8[0], size_needed, NULL, NULL);
+        return utf8;
+    }
+}
 
 ObserverMatch::ObserverMatch(ObserverStoC* stoc_handler)
-    : stoc_handler_(stoc_handler)
+    : stoc_handler_(stoc_handler), current_match_info_(std::make_shared<MatchInfo>())
 {
-    current_match_info_.Reset();
+    live_match_info_.store(current_match_info_.get());
 }
 
 // registers the callback for InstanceLoadInfo packets
@@ -79,18 +103,16 @@ void ObserverMatch::HandleInstanceLoadInfo(const GW::HookStatus* /*status*/, con
         // entered observer mode - clear logs and start fresh
         GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, L"Entered Observer Mode instance. Clearing old logs, resetting match info, and registering StoC callbacks.");
 
-        // reset match info and set map ID for the new match
-        current_match_info_.Reset();
-        current_match_info_.map_id = packet->map_id;
-        current_match_info_.end_time_formatted = L"";
-        current_match_info_.end_time_ms = 0;
-        current_match_info_.winner_party_id = 0;
+        // keep the previous match for export, then start a new match info with the map ID of the new match
+        this->RetireSession();
+        this->swapMatchInfo(packet->map_id);
 
         // clear StoC/Agent logs if this is a new observer match
         ObserverMatchData::InitializeLordDamage();
         ObserverMatchData::InitializeTeamKillCount();
         if (owner_plugin) {
             this->ClearLogs();
+            this->BeginCaptureStream();
         }
 
         stoc_handler_->RegisterCallbacks();
@@ -115,14 +137,15 @@ void ObserverMatch::HandleInstanceLoadInfo(const GW::HookStatus* /*status*/, con
         // so the last match's info can still be exported.
         // it will be reset upon entering the *next* observer instance.
     } else if (is_observing) {
-        if (current_match_info_.map_id != packet->map_id) {
+        if (current_match_info_->map_id != packet->map_id) {
              GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, L"Observer Mode map change detected (unexpected?). Resetting match info.");
-             current_match_info_.Reset();
-             current_match_info_.map_id = packet->map_id;
+             this->RetireSession();
+             this->swapMatchInfo(packet->map_id);
              ObserverMatchData::InitializeLordDamage();
              ObserverMatchData::InitializeTeamKillCount();
              if (owner_plugin) {
                 this->ClearLogs();
+                this->BeginCaptureStream();
              }
         }
         GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, L"Still in Observer Mode instance.");
@@ -145,22 +168,22 @@ void ObserverMatch::SetMatchEndInfo(uint32_t end_time_ms, uint32_t raw_winner_id
         party_id_to_store = 0;
     }
 
-    current_match_info_.end_time_ms = end_time_ms;
-    current_match_info_.winner_party_id = party_id_to_store;
+    current_match_info_->end_time_ms = end_time_ms;
+    current_match_info_->winner_party_id = party_id_to_store;
 
-    // format the original timestamp like in ObserverCapture::AddLogEntry
+    // format the original timestamp like the capture export does
     uint32_t total_seconds_orig = end_time_ms / 1000;
     uint32_t minutes_orig = total_seconds_orig / 60;
     uint32_t seconds_orig = total_seconds_orig % 60;
     uint32_t milliseconds_orig = end_time_ms % 1000;
     wchar_t formatted_time[32];
     swprintf(formatted_time, _countof(formatted_time), L"%02u:%02u.%03u", minutes_orig, seconds_orig, milliseconds_orig);
-    current_match_info_.end_time_formatted = formatted_time;
+    current_match_info_->end_time_formatted = formatted_time;
 
     // store original match duration (without adjustment)
     wchar_t original_duration_str[16];
     swprintf(original_duration_str, _countof(original_duration_str), L"%02u:%02u", minutes_orig, seconds_orig);
-    current_match_info_.match_original_duration = original_duration_str;
+    current_match_info_->match_original_duration = original_duration_str;
 
     // calculate and format adjusted match duration
     uint32_t adjusted_duration_ms;
@@ -174,164 +197,143 @@ void ObserverMatch::SetMatchEndInfo(uint32_t end_time_ms, uint32_t raw_winner_id
     uint32_t adj_seconds = adj_total_seconds % 60;
     wchar_t adjusted_formatted_str[16];
     swprintf(adjusted_formatted_str, _countof(adjusted_formatted_str), L"%02u:%02u", adj_minutes, adj_seconds);
-    current_match_info_.match_duration = adjusted_formatted_str;
+    current_match_info_->match_duration = adjusted_formatted_str;
 
     wchar_t msg[256];
-    swprintf_s(msg, L"Match end info captured by ObserverMatch: Time=[%ls], Winner Party=%u", formatted_time, current_match_info_.winner_party_id);
+    swprintf_s(msg, L"Match end info captured by ObserverMatch: Time=[%ls], Winner Party=%u", formatted_time, current_match_info_->winner_party_id);
     GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, msg);
 }
 
+MatchRoster::MatchRoster(const AgentTable& agents) {
+    agents_.reserve(agents.size());
+    uint32_t max_slot_id = 0;
+    for (size_t i = 0; i < agents.size(); ++i) {
+        const AgentDetails& info = agents.Details(i);
+        agents_.push_back(RosterAgent{info.agent_id, info.party_id, info.type, info.team_id, info.encoded_name});
+        if (info.agent_id <= kMaxSlotAgentId && info.agent_id > max_slot_id) max_slot_id = info.agent_id;
+    }
+    if (agents_.empty()) return;
+    std::sort(agents_.begin(), agents_.end(),
+              [](const RosterAgent& a, const RosterAgent& b) { return a.agent_id < b.agent_id; });
+
+    slots_.assign(static_cast<size_t>(max_slot_id) + 1, -1);
+    for (size_t i = 0; i < agents_.size(); ++i) {
+        if (agents_[i].agent_id <= kMaxSlotAgentId) {
+            slots_[agents_[i].agent_id] = static_cast<int32_t>(i);
+        }
+    }
+}
+
+const RosterAgent* MatchRoster::Find(uint32_t agent_id) const {
+    if (agent_id < slots_.size()) {
+        const int32_t index = slots_[agent_id];
+        return index >= 0 ? &agents_[index] : nullptr;
+    }
+    if (agent_id <= kMaxSlotAgentId) return nullptr;
+    auto it = std::lower_bound(agents_.begin(), agents_.end(), agent_id,
+                               [](const RosterAgent& agent, uint32_t id) { return agent.agent_id < id; });
+    return (it != agents_.end() && it->agent_id == agent_id) ? &*it : nullptr;
+}
+
+int32_t AgentTable::FindSlot(uint32_t agent_id) const {
+    if (agent_id < slot_by_id_.size()) return slot_by_id_[agent_id];
+    if (agent_id <= kMaxIndexedAgentId) return -1;
+    for (size_t i = 0; i < details_.size(); ++i) {
+        if (details_[i].agent_id == agent_id) return static_cast<int32_t>(i);
+    }
+    return -1;
+}
+
+size_t AgentTable::AddSlot(uint32_t agent_id) {
+    const size_t slot = details_.size();
+    details_.emplace_back().agent_id = agent_id;
+    if (agent_id <= kMaxIndexedAgentId) {
+        if (agent_id >= slot_by_id_.size()) slot_by_id_.resize(static_cast<size_t>(agent_id) + 1, -1);
+        slot_by_id_[agent_id] = static_cast<int32_t>(slot);
+    }
+    return slot;
+}
+
+void AgentTable::Clear() {
+    details_.clear();
+    slot_by_id_.clear();
+}
+
 void MatchInfo::UpdateAgentInfo(const AgentInfo& info) {
     if (info.agent_id == 0) return;
 
     std::lock_guard<std::mutex> lock(agents_info_mutex);
-    // find the agent in the agents_info map
-    auto it = agents_info.find(info.agent_id);
-    if (it != agents_info.end()) {
-        std::vector<uint32_t> existing_skills = it->second.used_skill_ids;
-        long existing_damage = it->second.total_damage;
-        uint32_t existing_attacks_started = it->second.attacks_started;
-        uint32_t existing_attacks_finished = it->second.attacks_finished;
-        uint32_t existing_attacks_stopped = it->second.attacks_stopped;
-        uint32_t existing_skills_activated = it->second.skills_activated;
-        uint32_t existing_skills_finished = it->second.skills_finished;
-        uint32_t existing_skills_stopped = it->second.skills_stopped;
-        uint32_t existing_attack_skills_activated = it->second.attack_skills_activated;
-        uint32_t existing_attack_skills_finished = it->second.attack_skills_finished;
-        uint32_t existing_attack_skills_stopped = it->second.attack_skills_stopped;
-        uint32_t existing_interrupted_count = it->second.interrupted_count;
-        uint32_t existing_interrupted_skills_count = it->second.interrupted_skills_count;
-        uint32_t existing_cancelled_attacks_count = it->second.cancelled_attacks_count;
-        uint32_t existing_cancelled_skills_count = it->second.cancelled_skills_count;
-        uint32_t existing_crits_dealt = it->second.crits_dealt;
-        uint32_t existing_crits_received = it->second.crits_received;
-        uint32_t existing_deaths = it->second.deaths;
-        uint32_t existing_kills = it->second.kills;
-        it->second = info;
-        it->second.used_skill_ids = std::move(existing_skills);
-        it->second.total_damage = existing_damage;
-        it->second.attacks_started = existing_attacks_started;
-        it->second.attacks_finished = existing_attacks_finished;
-        it->second.attacks_stopped = existing_attacks_stopped;
-        it->second.skills_activated = existing_skills_activated;
-        it->second.skills_finished = existing_skills_finished;
-        it->second.skills_stopped = existing_skills_stopped;
-        it->second.attack_skills_activated = existing_attack_skills_activated;
-        it->second.attack_skills_finished = existing_attack_skills_finished;
-        it->second.attack_skills_stopped = existing_attack_skills_stopped;
-        it->second.interrupted_count = existing_interrupted_count;
-        it->second.interrupted_skills_count = existing_interrupted_skills_count;
-        it->second.cancelled_attacks_count = existing_cancelled_attacks_count;
-        it->second.cancelled_skills_count = existing_cancelled_skills_count;
-        it->second.crits_dealt = existing_crits_dealt;
-        it->second.crits_received = existing_crits_received;
-        it->second.deaths = existing_deaths;
-        it->second.kills = existing_kills;
-    } else {
-        agents_info[info.agent_id] = info;
+    int32_t slot = agents_info.FindSlot(info.agent_id);
+    const bool is_new = slot < 0;
+    if (is_new) {
+        slot = static_cast<int32_t>(agents_info.AddSlot(info.agent_id));
+        agent_stats.Track(info.agent_id);
+        roster_dirty = true;
+        roster_version.fetch_add(1, std::memory_order_release);
+    }
+
+    // the loop refreshes the details, used skills and their template are kept: the packet handlers own them
+    AgentDetails& details = agents_info.Details(slot);
+    if (details.party_id != info.party_id || details.type != info.type ||
+        details.team_id != info.team_id || details.encoded_name != info.encoded_name) {
+        roster_dirty = true;
+    }
+    if (!SameTeamViewFields(details, info)) {
+        roster_version.fetch_add(1, std::memory_order_release);
+    }
+    const bool template_dirty = is_new || details.skill_template_dirty ||
+                                details.primary_profession != info.primary_profession ||
+                                details.secondary_profession != info.secondary_profession;
+    UsedSkillSet existing_skills = std::move(details.used_skill_ids);
+    std::string existing_template = std::move(details.skill_template_code);
+    details = static_cast<const AgentDetails&>(info);
+    details.used_skill_ids = std::move(existing_skills);
+    details.skill_template_code = std::move(existing_template);
+    details.skill_template_dirty = template_dirty;
+}
+
+std::vector<AgentInfo> MatchInfo::GetAgentsInfoCopy() const {
+    std::vector<AgentInfo> agents;
+    {
+        std::lock_guard<std::mutex> lock(agents_info_mutex);
+        agents.reserve(agents_info.size());
+        for (size_t i = 0; i < agents_info.size(); ++i) {
+            agents.emplace_back();
+            static_cast<AgentDetails&>(agents.back()) = agents_info.Details(i);
+        }
+    }
+    // the counters keep moving while the details are copied, every agent's are read in one consistent piece
+    const std::shared_ptr<const SkillMetaTable> skills = GetSkillTable();
+    for (AgentInfo& agent : agents) {
+        agent_stats.Read(agent.agent_id, agent);
+        agent.used_skill_ids.Order(*skills, agent.primary_profession);
     }
+    std::sort(agents.begin(), agents.end(), [](const AgentInfo& a, const AgentInfo& b) { return a.agent_id < b.agent_id; });
+    return agents;
 }
 
-std::map<uint32_t, AgentInfo> MatchInfo::GetAgentsInfoCopy() const {
+void MatchInfo::PublishRoster() {
     std::lock_guard<std::mutex> lock(agents_info_mutex);
-    return agents_info; // return a copy of the map
+    if (!roster_dirty) return;
+    roster.store(std::make_shared<const MatchRoster>(agents_info));
+    roster_dirty = false;
 }
 
 void MatchInfo::AddSkillUsed(uint32_t agent_id, uint32_t skill_id) {
     if (agent_id == 0 || skill_id == 0) return; // ignore invalid IDs
 
     std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        // Check if the skill ID already exists in the vector (mimic set behavior)
-        auto& skill_ids = it->second.used_skill_ids;
-        if (std::find(skill_ids.begin(), skill_ids.end(), skill_id) == skill_ids.end()) {
-            // Skill not found, add it
-            skill_ids.push_back(skill_id);
-            // Sort skills immediately when a new one is added
-            SortAgentSkills(agent_id);
-        }
+    const int32_t slot = agents_info.FindSlot(agent_id);
+    if (slot >= 0 && agents_info.Details(slot).used_skill_ids.Insert(skill_id)) {
+        // the set is ordered when a copy of it is handed out, not on every new skill
+        agents_info.Details(slot).skill_template_dirty = true;
+        roster_version.fetch_add(1, std::memory_order_release);
     }
     // if agent not found, do nothing. agent info should be populated by ObserverLoop first.
 }
 
-void MatchInfo::SortAgentSkills(uint32_t agent_id) {
-    auto it = agents_info.find(agent_id);
-    if (it == agents_info.end()) return;
-
-    auto& agent = it->second;
-    auto& skills = agent.used_skill_ids;
-    
-    if (skills.empty()) return;
-    
-    // determine if the agent has an elite skill
-    bool has_elite = false;
-    uint32_t elite_profession = 0;
-    
-    for (uint32_t skill_id : skills) {
-        GW::Skill* skill = GW::SkillbarMgr::GetSkillConstantData(static_cast<GW::Constants::SkillID>(skill_id));
-        if (skill && skill->IsElite()) {
-            has_elite = true;
-            elite_profession = static_cast<uint32_t>(skill->profession);
-            break;
-        }
-    }
-    
-    // second step: sort skills
-    std::sort(skills.begin(), skills.end(), [&agent, has_elite, elite_profession](uint32_t skill_id1, uint32_t skill_id2) -> bool {
-        // get skill data
-        GW::Skill* skill1 = GW::SkillbarMgr::GetSkillConstantData(static_cast<GW::Constants::SkillID>(skill_id1));
-        GW::Skill* skill2 = GW::SkillbarMgr::GetSkillConstantData(static_cast<GW::Constants::SkillID>(skill_id2));
-        
-        if (!skill1 || !skill2) {
-            // if one skill has no data, place the one with data first
-            return skill1 != nullptr;
-        }
-        
-        uint32_t prof1 = static_cast<uint32_t>(skill1->profession);
-        uint32_t prof2 = static_cast<uint32_t>(skill2->profession);
-        bool is_elite1 = skill1->IsElite();
-        bool is_elite2 = skill2->IsElite();
-        
-        // case 1: if we have an elite
-        if (has_elite) {
-            // the elite will always be first
-            if (is_elite1 && !is_elite2) return true;
-            if (!is_elite1 && is_elite2) return false;
-            
-            // skills of the same profession as the elite are prioritized
-            bool is_elite_prof1 = (prof1 == elite_profession);
-            bool is_elite_prof2 = (prof2 == elite_profession);
-            if (is_elite_prof1 != is_elite_prof2) {
-                return is_elite_prof1;
-            }
-            
-            // same profession, sort by type
-            if (skill1->type != skill2->type) {
-                return skill1->type < skill2->type;
-            }
-            
-            // same type, sort by ID
-            return skill_id1 < skill_id2;
-        }
-        // case 2: no elite, sort by primary/secondary profession
-        else {
-            // primary profession first
-            bool is_primary1 = (prof1 == agent.primary_profession);
-            bool is_primary2 = (prof2 == agent.primary_profession);
-            if (is_primary1 != is_primary2) {
-                return is_primary1;
-            }
-            
-            // same profession status, sort by type
-            if (skill1->type != skill2->type) {
-                return skill1->type < skill2->type;
-            }
-            
-            // same type, sort by ID
-            return skill_id1 < skill_id2;
-        }
-    });
+void MatchInfo::BuildSkillTable() {
+    skill_table.store(std::make_shared<const SkillMetaTable>(SkillMetaTable::BuildFromGame()));
 }
 
 void MatchInfo::UpdateGuildInfo(const GuildInfo& info) {
@@ -339,6 +341,10 @@ void MatchInfo::UpdateGuildInfo(const GuildInfo& info) {
 
     std::lock_guard<std::mutex> lock(guilds_info_mutex);
 
+    auto it = guilds_info.find(info.guild_id);
+    if (it == guilds_info.end() || it->second.name != info.name || it->second.tag != info.tag) {
+        roster_version.fetch_add(1, std::memory_order_release);
+    }
     guilds_info[info.guild_id] = info;
 }
 
@@ -347,6 +353,83 @@ std::map<uint16_t, GuildInfo> MatchInfo::GetGuildsInfoCopy() const {
     return guilds_info; // return a copy of the map
 }
 
+bool MatchTeamView::CanDisplayTeams() const {
+    if (teams.size() < 2) return false;
+    int teams_with_players = 0;
+    for (const TeamView& team : teams) {
+        if (team.has_player) teams_with_players++;
+    }
+    return teams_with_players >= 2;
+}
+
+std::shared_ptr<const MatchTeamView> MatchInfo::GetTeamView() const {
+    // read before the copies: a change made while building leaves the view stale and the next call rebuilds it
+    const uint64_t version = roster_version.load(std::memory_order_acquire);
+
+    std::lock_guard<std::mutex> lock(team_view_mutex);
+    if (team_view && team_view->version == version) return team_view;
+
+    auto view = std::make_shared<MatchTeamView>();
+    view->version = version;
+
+    std::map<uint32_t, TeamView> teams;
+    {
+        std::lock_guard<std::mutex> agents_lock(agents_info_mutex);
+        view->has_agents = !agents_info.empty();
+        for (size_t i = 0; i < agents_info.size(); ++i) {
+            const AgentDetails& agent = agents_info.Details(i);
+            if (agent.team_id == 0 ||
+                (agent.type != AgentType::PLAYER && agent.type != AgentType::HERO && agent.type != AgentType::HENCHMAN)) {
+                continue;
+            }
+            TeamView& team = teams[agent.team_id];
+            team.team_id = agent.team_id;
+            team.has_player = team.has_player || agent.type == AgentType::PLAYER;
+            team.members.push_back(agent);
+        }
+    }
+
+    std::map<uint16_t, GuildInfo> guilds = GetGuildsInfoCopy();
+    const std::shared_ptr<const SkillMetaTable> skills = GetSkillTable();
+    view->teams.reserve(teams.size());
+    for (auto& [team_id, team] : teams) {
+        std::sort(team.members.begin(), team.members.end(), [](const AgentDetails& a, const AgentDetails& b) {
+            if (a.type != b.type) return a.type < b.type;
+            return a.player_number < b.player_number;
+        });
+        for (AgentDetails& agent : team.members) {
+            agent.used_skill_ids.Order(*skills, agent.primary_profession);
+        }
+
+        // the team carries the name of the guild most of its players are in, the lowest id on a tie
+        std::map<uint16_t, int> guild_counts;
+        for (const AgentDetails& agent : team.members) {
+            if (agent.type == AgentType::PLAYER && agent.guild_id != 0) {
+                guild_counts[agent.guild_id]++;
+            }
+        }
+        uint16_t most_common_guild_id = 0;
+        int highest_count = 0;
+        for (const auto& [guild_id, count] : guild_counts) {
+            if (count > highest_count) {
+                highest_count = count;
+                most_common_guild_id = guild_id;
+            }
+        }
+
+        team.name = "Team " + std::to_string(team_id);
+        auto it = guilds.find(most_common_guild_id);
+        if (most_common_guild_id != 0 && it != guilds.end()) {
+            team.name = ToUtf8(it->second.name);
+            team.tag = ToUtf8(it->second.tag);
+        }
+        view->teams.push_back(std::move(team));
+    }
+
+    team_view = std::move(view);
+    return team_view;
+}
+
 
 void ObserverMatch::ClearLogs() {
     if (owner_plugin && owner_plugin->capture_handler) {
@@ -357,369 +440,577 @@ void ObserverMatch::ClearLogs() {
     }
 }
 
-bool ObserverMatch::ExportLogsToFolder(const wchar_t* folder_name) {
-    bool any_success = false;
-    bool infos_success = false;
-    bool stoc_success = false;
-    bool agent_success = false;
+void ObserverMatch::BeginCaptureStream() {
+    if (!owner_plugin) return;
+
+    // a previous match's stream is dropped, its files are complete once exported
+    std::shared_ptr<ObserverStream> stream;
+    if (owner_plugin->stream_capture_to_disk && strlen(owner_plugin->export_folder_name) > 0) {
+        std::wstring folder_name = owner_plugin->StringToWString(owner_plugin->export_folder_name);
+        stream = std::make_shared<ObserverStream>();
+        if (!stream->Begin(folder_name.c_str())) stream.reset();
+    }
+    owner_plugin->stream_handler = stream;
+    if (owner_plugin->capture_handler) owner_plugin->capture_handler->SetStream(stream);
+    if (owner_plugin->loop_handler) owner_plugin->loop_handler->SetStream(stream);
+}
+
+// an export queued on the worker: the session it writes and how
+struct MatchExportJob {
+    std::shared_ptr<MatchSession> session;
+    bool streaming = false;  // capture files are already on disk, the session holds their stream and tail
+    bool archive = false;    // write captures/<name>.obsm instead of the folder
+};
+
+// the parts of the current match a session starts from, cheap enough for the game thread:
+// the match info is shared and infos.json is rendered from it by the export worker
+std::shared_ptr<MatchSession> ObserverMatch::takeSession(const std::wstring& name) {
+    auto session = std::make_shared<MatchSession>();
+    session->name = name;
+    session->map_id = current_match_info_->map_id;
+    session->match_info = current_match_info_;
+    session->result = current_match_info_->GetResult();
+    session->team_kills = {ObserverMatchData::GetTeamKillCount(1), ObserverMatchData::GetTeamKillCount(2)};
+    session->taken_at = std::time(nullptr);
+    return session;
+}
 
+void ObserverMatch::detachCapture(MatchSession& session) {
+    if (owner_plugin->capture_handler) session.capture = owner_plugin->capture_handler->DetachEvents();
+    if (owner_plugin->loop_handler) session.agent_logs = owner_plugin->loop_handler->DetachAgentLogs();
+    owner_plugin->stream_handler.reset();
+}
+
+void ObserverMatch::swapMatchInfo(uint32_t map_id) {
+    auto match_info = std::make_shared<MatchInfo>();
+    match_info->BuildSkillTable();
+    match_info->map_id = map_id;
+    // a handler that read the retired one just before the swap finishes with it, it outlives the next swap
+    previous_match_info_ = std::move(current_match_info_);
+    current_match_info_ = std::move(match_info);
+    live_match_info_.store(current_match_info_.get());
+}
+
+bool ObserverMatch::QueueExport(const wchar_t* folder_name) {
+    if (!owner_plugin || !owner_plugin->export_queue) {
+        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, L"Error: export queue not available.");
+        return false;
+    }
+
+    auto job = std::make_shared<MatchExportJob>();
     try {
         this->UpdateAgentSkillTemplates();
 
-        std::filesystem::path base_dir = "captures";
-        std::filesystem::path match_dir = base_dir / folder_name;
+        // events and logs are copied here, on the calling thread
+        job->session = this->takeSession(folder_name);
+        // a streamed capture already has its files on disk, so it keeps the folder layout
+        job->streaming = owner_plugin->stream_handler && owner_plugin->stream_handler->IsActive();
+        job->archive = owner_plugin->export_match_archive && !job->streaming;
+        if (job->streaming) {
+            if (owner_plugin->export_match_archive) {
+                GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR,
+                                    L"'Export as Match Archive' does not apply to a capture streamed to disk, it is exported as a folder.");
+            }
+            // the stream and what it has not sealed yet go with the job, the worker never touches the live capture
+            this->detachCapture(*job->session);
+            if (is_observing) {
+                GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR,
+                                    L"Streaming to disk ended with this export, the rest of the match is kept in memory.");
+            }
+        } else {
+            if (owner_plugin->capture_handler) job->session->capture = owner_plugin->capture_handler->TakeSnapshot();
+            if (owner_plugin->loop_handler) job->session->agent_logs = owner_plugin->loop_handler->TakeAgentLogSnapshot();
+        }
+        job->session->UpdateStats();
+    } catch (const std::exception& e) {
+        WriteExportError("Error preparing export: ", e.what());
+        return false;
+    }
+
+    owner_plugin->export_queue->Enqueue(job->session->name, [this, job](ExportProgress& progress) {
+        this->runExport(*job, progress);
+    });
+
+    wchar_t msg[512];
+    swprintf_s(msg, L"Export of '%ls' queued.", folder_name);
+    GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, msg);
+    return true;
+}
+
+bool ObserverMatch::QueueSessionExport(const std::shared_ptr<MatchSession>& session) {
+    if (!session || !owner_plugin || !owner_plugin->export_queue) return false;
+
+    auto job = std::make_shared<MatchExportJob>();
+    job->session = session;
+    job->archive = owner_plugin->export_match_archive;
+    owner_plugin->export_queue->Enqueue(session->name, [this, job](ExportProgress& progress) {
+        this->runExport(*job, progress);
+    });
+
+    wchar_t msg[512];
+    swprintf_s(msg, L"Export of previous match '%ls' queued.", session->name.c_str());
+    GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, msg);
+    return true;
+}
+
+void ObserverMatch::RetireSession() {
+    if (!owner_plugin) return;
+    const size_t retained_count = static_cast<size_t>(std::max(0, owner_plugin->retained_match_count));
+    const bool streaming = owner_plugin->stream_handler && owner_plugin->stream_handler->IsActive();
+    const bool has_logs = (owner_plugin->capture_handler && owner_plugin->capture_handler->GetLogCount() > 0) ||
+                          (owner_plugin->loop_handler && owner_plugin->loop_handler->HasAgentLogs());
+
+    // a streamed match is on disk already, but for the tail it had not sealed yet. it goes to the worker
+    // with its stream, which appends the tail to the match's own folder while the next match streams
+    if (streaming) {
+        auto job = std::make_shared<MatchExportJob>();
+        job->streaming = true;
+        job->session = this->takeSession(owner_plugin->stream_handler->GetFolder().filename().wstring());
+        this->detachCapture(*job->session);
+        last_match_name_.clear();
+        if (!has_logs || !owner_plugin->export_queue) return;
+
+        owner_plugin->export_queue->Enqueue(job->session->name, [this, job](ExportProgress& progress) {
+            this->runExport(*job, progress);
+        });
+        wchar_t msg[512];
+        swprintf_s(msg, L"Previous match '%ls' was streamed to disk, its last events are written in the background.", job->session->name.c_str());
+        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, msg);
+        return;
+    }
+    if (retained_count == 0 || !has_logs) return;
 
-        // ensure the base directory exists
-        std::filesystem::create_directories(match_dir);
+    // the live buffers are swapped out, the new match starts capturing right away
+    auto session = this->takeSession(last_match_name_.empty() ? owner_plugin->StringToWString(owner_plugin->export_folder_name) : last_match_name_);
+    this->detachCapture(*session);
+    session->UpdateStats();
+    last_match_name_.clear();
 
-        // export infos.json using current_match_info_
-        const MatchInfo& match_info = this->GetMatchInfo(); 
-        std::map<uint32_t, AgentInfo> agents_info = match_info.GetAgentsInfoCopy();
-        std::filesystem::path info_file = match_dir / "infos.json";
-        std::ofstream outfile(info_file);
-        if (outfile.is_open()) {             outfile << "{\n";            outfile << "  \"map_id\": " << match_info.map_id;
+    {
+        std::lock_guard<std::mutex> lock(retained_sessions_mutex_);
+        retained_sessions_.push_front(session);
+        while (retained_sessions_.size() > retained_count) {
+            retained_sessions_.pop_back(); // a queued export of it keeps its own reference
+        }
+    }
+
+    // packed in the background, exports of it are queued on the same worker so they can't overlap
+    if (owner_plugin->export_queue) {
+        owner_plugin->export_queue->Enqueue(session->name, [session](ExportProgress& progress) {
+            session->Pack(progress);
+        });
+    }
+
+    wchar_t msg[512];
+    swprintf_s(msg, L"Previous match '%ls' kept in memory for export.", session->name.c_str());
+    GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, msg);
+}
+
+std::vector<std::shared_ptr<MatchSession>> ObserverMatch::GetRetainedSessions() const {
+    std::lock_guard<std::mutex> lock(retained_sessions_mutex_);
+    return {retained_sessions_.begin(), retained_sessions_.end()};
+}
+
+void ObserverMatch::ClearRetainedSessions() {
+    std::lock_guard<std::mutex> lock(retained_sessions_mutex_);
+    retained_sessions_.clear();
+}
+
+// renders infos.json from the session's match info, its result copied when the session was taken
+std::string ObserverMatch::BuildInfosJson(const MatchSession& session) {
+    const MatchInfo& match_info = *session.match_info;
+    const MatchResult& result = session.result;
+    std::vector<AgentInfo> agents_info = match_info.GetAgentsInfoCopy();
+    std::ostringstream outfile;
+    {
+        outfile << "{\n";            outfile << "  \"map_id\": " << session.map_id;
+        outfile << ",\n";
+            time_t t = session.taken_at;
+            std::tm tm;
+            localtime_s(&tm, &t);
+            
+            // flux
+            std::vector<std::string> monthly_flux = {
+                "Odran's Razor",               // January (tm_mon = 0)
+                "Amateur Hour",                // February
+                "Hidden Talent",               // March
+                "There Can Be Only One",       // April
+                "Meek Shall Inherit",          // May
+                "Jack of All Trades",          // June
+                "Chain Combo",                 // July
+                "Xinrae's Revenge",            // August
+                "Like a Boss (and The Boss)",  // September
+                "Minion Apocalypse",           // October
+                "All In",                      // November
+                "Parting Gift (and Gift of Battle)" // December
+            };
+            std::string current_flux = "Unknown Flux"; // Default fallback
+            if (tm.tm_mon >= 0 && tm.tm_mon < 12) {
+                current_flux = monthly_flux[tm.tm_mon];
+            }
+            outfile << ",\n";
+            outfile << "  \"flux\": \"" << current_flux << "\"";
+            
+            // date
+            outfile << ",\n";
+            outfile << "  \"day\": " << tm.tm_mday;
             outfile << ",\n";
-                time_t t = std::time(nullptr);
-                std::tm tm;
-                localtime_s(&tm, &t);
-                
-                // flux
-                std::vector<std::string> monthly_flux = {
-                    "Odran's Razor",               // January (tm_mon = 0)
-                    "Amateur Hour",                // February
-                    "Hidden Talent",               // March
-                    "There Can Be Only One",       // April
-                    "Meek Shall Inherit",          // May
-                    "Jack of All Trades",          // June
-                    "Chain Combo",                 // July
-                    "Xinrae's Revenge",            // August
-                    "Like a Boss (and The Boss)",  // September
-                    "Minion Apocalypse",           // October
-                    "All In",                      // November
-                    "Parting Gift (and Gift of Battle)" // December
-                };
-                std::string current_flux = "Unknown Flux"; // Default fallback
-                if (tm.tm_mon >= 0 && tm.tm_mon < 12) {
-                    current_flux = monthly_flux[tm.tm_mon];
+            outfile << "  \"month\": " << tm.tm_mon + 1; // tm_mon is 0-11, we need 1-12
+            outfile << ",\n";
+            outfile << "  \"year\": " << tm.tm_year + 1900; // tm_year is years since 1900
+            
+            // occasion
+            outfile << ",\n";
+            outfile << "  \"occasion\": \"General Scrimmage\"";
+
+            // match duration (adjusted - minus 1 min)
+            if (!result.match_duration.empty()) {
+                std::string utf8_duration;
+                try {
+                    int size_needed = WideCharToMultiByte(CP_UTF8, 0, result.match_duration.c_str(), (int)result.match_duration.size(), NULL, 0, NULL, NULL);
+                    if (size_needed > 0) {
+                        utf8_duration.resize(size_needed, 0);
+                        WideCharToMultiByte(CP_UTF8, 0, result.match_duration.c_str(), (int)result.match_duration.size(), &utf8_duration[0], size_needed, NULL, NULL);
+                    }
+                } catch (...) {
+                    utf8_duration = "[conversion_error]";
                 }
                 outfile << ",\n";
-                outfile << "  \"flux\": \"" << current_flux << "\"";
-                
-                // date
+                outfile << "  \"match_duration\": \"" << utf8_duration << "\"";
+            }
+            
+            // original match duration (without adjustment)
+            if (!result.match_original_duration.empty()) {
+                std::string utf8_orig_duration;
+                try {
+                    int size_needed = WideCharToMultiByte(CP_UTF8, 0, result.match_original_duration.c_str(), (int)result.match_original_duration.size(), NULL, 0, NULL, NULL);
+                    if (size_needed > 0) {
+                        utf8_orig_duration.resize(size_needed, 0);
+                        WideCharToMultiByte(CP_UTF8, 0, result.match_original_duration.c_str(), (int)result.match_original_duration.size(), &utf8_orig_duration[0], size_needed, NULL, NULL);
+                    }
+                } catch (...) {
+                    utf8_orig_duration = "[conversion_error]";
+                }
                 outfile << ",\n";
-                outfile << "  \"day\": " << tm.tm_mday;
+                outfile << "  \"match_original_duration\": \"" << utf8_orig_duration << "\"";
+            }
+            
+            if (result.end_time_ms > 0) {
                 outfile << ",\n";
-                outfile << "  \"month\": " << tm.tm_mon + 1; // tm_mon is 0-11, we need 1-12
+                outfile << "  \"match_end_time_ms\": " << result.end_time_ms;
+
+                std::string utf8_formatted_time;
+                try {
+                     int size_needed = WideCharToMultiByte(CP_UTF8, 0, result.end_time_formatted.c_str(), (int)result.end_time_formatted.size(), NULL, 0, NULL, NULL);
+                     if (size_needed > 0) {
+                          utf8_formatted_time.resize(size_needed, 0);
+                          WideCharToMultiByte(CP_UTF8, 0, result.end_time_formatted.c_str(), (int)result.end_time_formatted.size(), &utf8_formatted_time[0], size_needed, NULL, NULL);
+                     }
+                } catch (...) {
+                     utf8_formatted_time = "[conversion_error]";
+                }
                 outfile << ",\n";
-                outfile << "  \"year\": " << tm.tm_year + 1900; // tm_year is years since 1900
-                
-                // occasion
+                outfile << "  \"match_end_time_formatted\": \"" << utf8_formatted_time << "\"";
+            }
+            if (result.winner_party_id > 0) {
                 outfile << ",\n";
-                outfile << "  \"occasion\": \"General Scrimmage\"";
-
-                // match duration (adjusted - minus 1 min)
-                if (!match_info.match_duration.empty()) {
-                    std::string utf8_duration;
-                    try {
-                        int size_needed = WideCharToMultiByte(CP_UTF8, 0, match_info.match_duration.c_str(), (int)match_info.match_duration.size(), NULL, 0, NULL, NULL);
-                        if (size_needed > 0) {
-                            utf8_duration.resize(size_needed, 0);
-                            WideCharToMultiByte(CP_UTF8, 0, match_info.match_duration.c_str(), (int)match_info.match_duration.size(), &utf8_duration[0], size_needed, NULL, NULL);
-                        }
-                    } catch (...) {
-                        utf8_duration = "[conversion_error]";
-                    }
-                    outfile << ",\n";
-                    outfile << "  \"match_duration\": \"" << utf8_duration << "\"";
-                }
-                
-                // original match duration (without adjustment)
-                if (!match_info.match_original_duration.empty()) {
-                    std::string utf8_orig_duration;
-                    try {
-                        int size_needed = WideCharToMultiByte(CP_UTF8, 0, match_info.match_original_duration.c_str(), (int)match_info.match_original_duration.size(), NULL, 0, NULL, NULL);
-                        if (size_needed > 0) {
-                            utf8_orig_duration.resize(size_needed, 0);
-                            WideCharToMultiByte(CP_UTF8, 0, match_info.match_original_duration.c_str(), (int)match_info.match_original_duration.size(), &utf8_orig_duration[0], size_needed, NULL, NULL);
-                        }
-                    } catch (...) {
-                        utf8_orig_duration = "[conversion_error]";
-                    }
-                    outfile << ",\n";
-                    outfile << "  \"match_original_duration\": \"" << utf8_orig_duration << "\"";
-                }
-                
-                if (match_info.end_time_ms > 0) {
-                    outfile << ",\n";
-                    outfile << "  \"match_end_time_ms\": " << match_info.end_time_ms;
-
-                    std::string utf8_formatted_time;
-                    try {
-                         int size_needed = WideCharToMultiByte(CP_UTF8, 0, match_info.end_time_formatted.c_str(), (int)match_info.end_time_formatted.size(), NULL, 0, NULL, NULL);
-                         if (size_needed > 0) {
-                              utf8_formatted_time.resize(size_needed, 0);
-                              WideCharToMultiByte(CP_UTF8, 0, match_info.end_time_formatted.c_str(), (int)match_info.end_time_formatted.size(), &utf8_formatted_time[0], size_needed, NULL, NULL);
-                         }
-                    } catch (...) {
-                         utf8_formatted_time = "[conversion_error]";
-                    }
-                    outfile << ",\n";
-                    outfile << "  \"match_end_time_formatted\": \"" << utf8_formatted_time << "\"";
-                }
-                if (match_info.winner_party_id > 0) {
-                    outfile << ",\n";
-                    outfile << "  \"winner_party_id\": " << match_info.winner_party_id;
+                outfile << "  \"winner_party_id\": " << result.winner_party_id;
+            }
+
+            // add team kill counts
+            outfile << ",\n";
+            outfile << "  \"team_kills\": {";
+            uint32_t team1_kills = session.team_kills[0];
+            uint32_t team2_kills = session.team_kills[1];
+            outfile << "\n";
+            outfile << "    \"1\": " << team1_kills << ",\n";
+            outfile << "    \"2\": " << team2_kills << "\n";
+            outfile << "  }";
+
+            outfile << ",\n";
+            outfile << "  \"team_damage\": {";
+            long team1_damage = match_info.GetTeamDamage(1);
+            long team2_damage = match_info.GetTeamDamage(2);
+            outfile << "\n";
+            outfile << "    \"1\": " << team1_damage << ",\n";
+            outfile << "    \"2\": " << team2_damage << "\n";
+            outfile << "  }";
+
+            auto AgentTypeToJSONString = [](AgentType type) -> const char* {
+                switch (type) {
+                    case AgentType::PLAYER: return "PLAYER";
+                    case AgentType::HERO: return "PARTY_COMPLETE";
+                    case AgentType::HENCHMAN: return "PARTY_COMPLETE";
+                    case AgentType::PARTY_COMPLETE: return "PARTY_COMPLETE";
+                    case AgentType::OTHER: return "OTHER";
+                    default: return "UNKNOWN";
                 }
+            };
 
-                // add team kill counts
-                outfile << ",\n";
-                outfile << "  \"team_kills\": {";
-                uint32_t team1_kills = ObserverMatchData::GetTeamKillCount(1);
-                uint32_t team2_kills = ObserverMatchData::GetTeamKillCount(2);
-                outfile << "\n";
-                outfile << "    \"1\": " << team1_kills << ",\n";
-                outfile << "    \"2\": " << team2_kills << "\n";
-                outfile << "  }";
+            // sort for structured JSON output
+            std::vector<AgentInfo>& sorted_agent_list = agents_info;
+            std::sort(sorted_agent_list.begin(), sorted_agent_list.end(), [](const AgentInfo& a, const AgentInfo& b) {
+                if (a.party_id != b.party_id) return a.party_id < b.party_id;
+                if (a.type != b.type) return static_cast<int>(a.type) < static_cast<int>(b.type); // Enum comparison
+                return a.agent_id < b.agent_id;
+            });
 
-                outfile << ",\n";
-                outfile << "  \"team_damage\": {";
-                long team1_damage = match_info.GetTeamDamage(1);
-                long team2_damage = match_info.GetTeamDamage(2);
+            // add structured parties section
+            outfile << ",\n";
+            outfile << "  \"parties\": {";
+            if (!sorted_agent_list.empty()) {
                 outfile << "\n";
-                outfile << "    \"1\": " << team1_damage << ",\n";
-                outfile << "    \"2\": " << team2_damage << "\n";
-                outfile << "  }";
-
-                auto AgentTypeToJSONString = [](AgentType type) -> const char* {
-                    switch (type) {
-                        case AgentType::PLAYER: return "PLAYER";
-                        case AgentType::HERO: return "PARTY_COMPLETE";
-                        case AgentType::HENCHMAN: return "PARTY_COMPLETE";
-                        case AgentType::PARTY_COMPLETE: return "PARTY_COMPLETE";
-                        case AgentType::OTHER: return "OTHER";
-                        default: return "UNKNOWN";
-                    }
-                };
 
-                // create aa vector and sort for structured JSON output
-                std::vector<AgentInfo> sorted_agent_list;
-                sorted_agent_list.reserve(agents_info.size());
-                for(const auto& pair : agents_info) {
-                    sorted_agent_list.push_back(pair.second);
-                }
-                std::sort(sorted_agent_list.begin(), sorted_agent_list.end(), [](const AgentInfo& a, const AgentInfo& b) {
-                    if (a.party_id != b.party_id) return a.party_id < b.party_id;
-                    if (a.type != b.type) return static_cast<int>(a.type) < static_cast<int>(b.type); // Enum comparison
-                    return a.agent_id < b.agent_id;
-                });
+                uint32_t current_party_id = (uint32_t)-1;
+                AgentType current_type = (AgentType)-1;
+                bool first_party = true;
+                bool first_type_in_party = true;
 
-                // add structured parties section
-                outfile << ",\n";
-                outfile << "  \"parties\": {";
-                if (!sorted_agent_list.empty()) {
-                    outfile << "\n";
-
-                    uint32_t current_party_id = (uint32_t)-1;
-                    AgentType current_type = (AgentType)-1;
-                    bool first_party = true;
-                    bool first_type_in_party = true;
-
-                    for (size_t i = 0; i < sorted_agent_list.size(); ++i) {
-                        const auto& agent = sorted_agent_list[i];
-
-                        // start new party object
-                        if (agent.party_id != current_party_id) {
-                            // close previous type array and party object if needed
-                            if (!first_party) {
-                                outfile << " ]"; // close last type array
-                                outfile << "\n    }"; // close last party object
-                            }
-
-                            if (!first_party) outfile << ",\n";
-                            outfile << "    \"" << agent.party_id << "\": {";
-                            current_party_id = agent.party_id;
-                            first_party = false;
-                            first_type_in_party = true;
-                            current_type = (AgentType)-1; // reset type for new party
-                        }
+                for (size_t i = 0; i < sorted_agent_list.size(); ++i) {
+                    const auto& agent = sorted_agent_list[i];
 
-                        // start new type array
-                        if (agent.type != current_type) {
-                             // close previous type array if needed
-                            if (!first_type_in_party) {
-                                outfile << " ]";
-                            }
-                            if (!first_type_in_party) outfile << ",";
-                            outfile << "\n      \"" << AgentTypeToJSONString(agent.type) << "\": ["; // start array (no trailing space)
-                            current_type = agent.type;
-                            first_type_in_party = false;
+                    // start new party object
+                    if (agent.party_id != current_party_id) {
+                        // close previous type array and party object if needed
+                        if (!first_party) {
+                            outfile << " ]"; // close last type array
+                            outfile << "\n    }"; // close last party object
                         }
 
-                        // determine if a comma is needed before this agent
-                        bool needs_comma = false;
-                        if (i > 0 && sorted_agent_list[i-1].party_id == agent.party_id && sorted_agent_list[i-1].type == agent.type) {
-                            // needs comma if previous agent was in the same party and of the same type
-                            needs_comma = true;
-                        }
-                        if (needs_comma) {
-                             outfile << ", ";
-                        }
+                        if (!first_party) outfile << ",\n";
+                        outfile << "    \"" << agent.party_id << "\": {";
+                        current_party_id = agent.party_id;
+                        first_party = false;
+                        first_type_in_party = true;
+                        current_type = (AgentType)-1; // reset type for new party
+                    }
 
-                        // decode and properly format the agent name for JSON
-                        std::string decoded_name_json = ObserverUtils::DecodeAgentNameForJSON(agent.encoded_name);
-                        
-                        outfile << "{\"id\": " << agent.agent_id
-                                << ", \"primary\": " << agent.primary_profession
-                                << ", \"secondary\": " << agent.secondary_profession
-                                << ", \"level\": " << agent.level
-                                << ", \"team_id\": " << agent.team_id
-                                << ", \"player_number\": " << agent.player_number
-                                << ", \"guild_id\": " << agent.guild_id
-                                << ", \"model_id\": " << agent.model_id
-                                << ", \"gadget_id\": " << agent.gadget_id
-                                << ", \"encoded_name\": " << decoded_name_json
-                                << ", \"total_damage\": " << agent.total_damage
-                                << ", \"attacks_started\": " << agent.attacks_started
-                                << ", \"attacks_finished\": " << agent.attacks_finished
-                                << ", \"attacks_stopped\": " << agent.attacks_stopped
-                                << ", \"skills_activated\": " << agent.skills_activated
-                                << ", \"skills_finished\": " << agent.skills_finished
-                                << ", \"skills_stopped\": " << agent.skills_stopped
-                                << ", \"attack_skills_activated\": " << agent.attack_skills_activated
-                                << ", \"attack_skills_finished\": " << agent.attack_skills_finished
-                                << ", \"attack_skills_stopped\": " << agent.attack_skills_stopped
-                                << ", \"interrupted_count\": " << agent.interrupted_count
-                                << ", \"interrupted_skills_count\": " << agent.interrupted_skills_count
-                                << ", \"cancelled_attacks_count\": " << agent.cancelled_attacks_count
-                                << ", \"cancelled_skills_count\": " << agent.cancelled_skills_count
-                                << ", \"crits_dealt\": " << agent.crits_dealt
-                                << ", \"crits_received\": " << agent.crits_received
-                                << ", \"deaths\": " << agent.deaths
-                                << ", \"kills\": " << agent.kills;
-
-                        if (!agent.skill_template_code.empty()) {
-                            outfile << ", \"skill_template_code\": \"" << agent.skill_template_code << "\"";
+                    // start new type array
+                    if (agent.type != current_type) {
+                         // close previous type array if needed
+                        if (!first_type_in_party) {
+                            outfile << " ]";
                         }
-                        
-                        outfile << ", \"used_skills\": [";
-                        // add used skills to the array
-                        bool first_skill = true;
-                        for (uint32_t skill_id : agent.used_skill_ids) {
-                            if (!first_skill) outfile << ",";
-                            outfile << skill_id;
-                            first_skill = false;
-                        }
-                        outfile << "] }"; // close used_skills array and agent object
+                        if (!first_type_in_party) outfile << ",";
+                        outfile << "\n      \"" << AgentTypeToJSONString(agent.type) << "\": ["; // start array (no trailing space)
+                        current_type = agent.type;
+                        first_type_in_party = false;
+                    }
 
-                        // close last structures if this is the last agent overall
-                        if (i == sorted_agent_list.size() - 1) {
-                             outfile << " ]"; // close last type array
-                            outfile << "\n    }"; // close last party object
-                        }
+                    // determine if a comma is needed before this agent
+                    bool needs_comma = false;
+                    if (i > 0 && sorted_agent_list[i-1].party_id == agent.party_id && sorted_agent_list[i-1].type == agent.type) {
+                        // needs comma if previous agent was in the same party and of the same type
+                        needs_comma = true;
+                    }
+                    if (needs_comma) {
+                         outfile << ", ";
                     }
-                    outfile << "\n  ";
-                }
-                outfile << "}\n";
 
-                outfile << ",\n";
-                outfile << "  \"guilds\": {";
-                std::map<uint16_t, GuildInfo> guilds_info = match_info.GetGuildsInfoCopy();
-                if (!guilds_info.empty()) {
-                    outfile << "\n";
-                    bool first_guild = true;
-                    for (const auto& [guild_id, guild_info] : guilds_info) {
-                        if (!first_guild) outfile << ",\n";
-                        std::string escaped_name = ObserverUtils::EscapeWideStringForJSON(guild_info.name);
-                        std::string escaped_tag = ObserverUtils::EscapeWideStringForJSON(guild_info.tag);
-                        outfile << "    \"" << guild_id << "\": {" << std::endl
-                                << "      \"id\": " << guild_info.guild_id << "," << std::endl
-                                << "      \"name\": " << escaped_name << "," << std::endl
-                                << "      \"tag\": " << escaped_tag << "," << std::endl
-                                << "      \"rank\": " << guild_info.rank << "," << std::endl
-                                << "      \"features\": " << guild_info.features << "," << std::endl
-                                << "      \"rating\": " << guild_info.rating << "," << std::endl
-                                << "      \"faction\": " << guild_info.faction << "," << std::endl
-                                << "      \"faction_points\": " << guild_info.faction_points << "," << std::endl
-                                << "      \"qualifier_points\": " << guild_info.qualifier_points << "," << std::endl
-                                << "      \"cape\": { " << std::endl
-                                << "          \"bg_color\": " << guild_info.cape.cape_bg_color << "," << std::endl
-                                << "          \"detail_color\": " << guild_info.cape.cape_detail_color << "," << std::endl
-                                << "          \"emblem_color\": " << guild_info.cape.cape_emblem_color << "," << std::endl
-                                << "          \"shape\": " << guild_info.cape.cape_shape << "," << std::endl
-                                << "          \"detail\": " << guild_info.cape.cape_detail << "," << std::endl
-                                << "          \"emblem\": " << guild_info.cape.cape_emblem << "," << std::endl
-                                << "          \"trim\": " << guild_info.cape.cape_trim << std::endl
-                                << "        }" << std::endl
-                                << "      }";
-                        first_guild = false;
+                    // decode and properly format the agent name for JSON
+                    std::string decoded_name_json = ObserverUtils::DecodeAgentNameForJSON(agent.encoded_name);
+                    
+                    outfile << "{\"id\": " << agent.agent_id
+                            << ", \"primary\": " << agent.primary_profession
+                            << ", \"secondary\": " << agent.secondary_profession
+                            << ", \"level\": " << agent.level
+                            << ", \"team_id\": " << agent.team_id
+                            << ", \"player_number\": " << agent.player_number
+                            << ", \"guild_id\": " << agent.guild_id
+                            << ", \"model_id\": " << agent.model_id
+                            << ", \"gadget_id\": " << agent.gadget_id
+                            << ", \"encoded_name\": " << decoded_name_json
+                            << ", \"total_damage\": " << agent.total_damage
+                            << ", \"attacks_started\": " << agent.attacks_started
+                            << ", \"attacks_finished\": " << agent.attacks_finished
+                            << ", \"attacks_stopped\": " << agent.attacks_stopped
+                            << ", \"skills_activated\": " << agent.skills_activated
+                            << ", \"skills_finished\": " << agent.skills_finished
+                            << ", \"skills_stopped\": " << agent.skills_stopped
+                            << ", \"attack_skills_activated\": " << agent.attack_skills_activated
+                            << ", \"attack_skills_finished\": " << agent.attack_skills_finished
+                            << ", \"attack_skills_stopped\": " << agent.attack_skills_stopped
+                            << ", \"interrupted_count\": " << agent.interrupted_count
+                            << ", \"interrupted_skills_count\": " << agent.interrupted_skills_count
+                            << ", \"cancelled_attacks_count\": " << agent.cancelled_attacks_count
+                            << ", \"cancelled_skills_count\": " << agent.cancelled_skills_count
+                            << ", \"crits_dealt\": " << agent.crits_dealt
+                            << ", \"crits_received\": " << agent.crits_received
+                            << ", \"deaths\": " << agent.deaths
+                            << ", \"kills\": " << agent.kills;
+
+                    if (!agent.skill_template_code.empty()) {
+                        outfile << ", \"skill_template_code\": \"" << agent.skill_template_code << "\"";
+                    }
+                    
+                    outfile << ", \"used_skills\": [";
+                    // add used skills to the array
+                    bool first_skill = true;
+                    for (uint32_t skill_id : agent.used_skill_ids) {
+                        if (!first_skill) outfile << ",";
+                        outfile << skill_id;
+                        first_skill = false;
+                    }
+                    outfile << "] }"; // close used_skills array and agent object
+
+                    // close last structures if this is the last agent overall
+                    if (i == sorted_agent_list.size() - 1) {
+                         outfile << " ]"; // close last type array
+                        outfile << "\n    }"; // close last party object
                     }
-                    outfile << "\n  ";
                 }
-                outfile << "}\n"; 
+                outfile << "\n  ";
+            }
+            outfile << "}\n";
 
-                outfile << "}\n";
-                outfile.close();
-                infos_success = !outfile.fail(); // check for errors after closing
+            outfile << ",\n";
+            outfile << "  \"guilds\": {";
+            std::map<uint16_t, GuildInfo> guilds_info = match_info.GetGuildsInfoCopy();
+            if (!guilds_info.empty()) {
+                outfile << "\n";
+                bool first_guild = true;
+                for (const auto& [guild_id, guild_info] : guilds_info) {
+                    if (!first_guild) outfile << ",\n";
+                    std::string escaped_name = ObserverUtils::EscapeWideStringForJSON(guild_info.name);
+                    std::string escaped_tag = ObserverUtils::EscapeWideStringForJSON(guild_info.tag);
+                    outfile << "    \"" << guild_id << "\": {" << std::endl
+                            << "      \"id\": " << guild_info.guild_id << "," << std::endl
+                            << "      \"name\": " << escaped_name << "," << std::endl
+                            << "      \"tag\": " << escaped_tag << "," << std::endl
+                            << "      \"rank\": " << guild_info.rank << "," << std::endl
+                            << "      \"features\": " << guild_info.features << "," << std::endl
+                            << "      \"rating\": " << guild_info.rating << "," << std::endl
+                            << "      \"faction\": " << guild_info.faction << "," << std::endl
+                            << "      \"faction_points\": " << guild_info.faction_points << "," << std::endl
+                            << "      \"qualifier_points\": " << guild_info.qualifier_points << "," << std::endl
+                            << "      \"cape\": { " << std::endl
+                            << "          \"bg_color\": " << guild_info.cape.cape_bg_color << "," << std::endl
+                            << "          \"detail_color\": " << guild_info.cape.cape_detail_color << "," << std::endl
+                            << "          \"emblem_color\": " << guild_info.cape.cape_emblem_color << "," << std::endl
+                            << "          \"shape\": " << guild_info.cape.cape_shape << "," << std::endl
+                            << "          \"detail\": " << guild_info.cape.cape_detail << "," << std::endl
+                            << "          \"emblem\": " << guild_info.cape.cape_emblem << "," << std::endl
+                            << "          \"trim\": " << guild_info.cape.cape_trim << std::endl
+                            << "        }" << std::endl
+                            << "      }";
+                    first_guild = false;
+                }
+                outfile << "\n  ";
+            }
+            outfile << "}\n"; 
+
+            outfile << "}\n";
+    }
+    return outfile.str();
+}
+
+// runs on the export worker, only reads the job's session and the stream detached into it
+void ObserverMatch::runExport(const MatchExportJob& job, ExportProgress& progress) {
+    bool any_success = false;
+    bool infos_success = false;
+    bool stoc_success = false;
+    bool agent_success = false;
+    const MatchSession& session = *job.session;
+    const wchar_t* folder_name = session.name.c_str();
+    const auto export_start = std::chrono::steady_clock::now();
+
+    try {
+        std::filesystem::path base_dir = "captures";
+        std::filesystem::path match_dir = base_dir / folder_name;
+
+        // match archive: every stream goes into captures/<name>.obsm instead of the folder
+        std::optional<ObserverArchiveWriter> archive;
+        if (job.archive) {
+            std::filesystem::create_directories(base_dir);
+            archive.emplace(base_dir / (session.name + L".obsm"));
+        } else {
+            // ensure the base directory exists
+            std::filesystem::create_directories(match_dir);
+        }
+
+        progress.BeginPhase(ExportPhase::Infos, 1);
+        const std::string infos = BuildInfosJson(session);
+        if (archive) {
+            archive->AddStream("infos.json", ArchiveCodec::Stored, std::vector<unsigned char>(infos.begin(), infos.end()));
+            infos_success = true;
+        } else {
+            std::filesystem::path info_file = match_dir / "infos.json";
+            std::ofstream infos_file(info_file);
+            if (infos_file.is_open()) {
+                infos_file << infos;
+                infos_file.close();
+                infos_success = !infos_file.fail(); // check for errors after closing
             } else {
                 std::wstring error_msg = L"Failed to open infos.json for writing: ";
                 error_msg += info_file.wstring();
-                GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, error_msg.c_str());
+                PostChatMessage(error_msg);
             }
-        
+        }
+        progress.Step();
+
         // export StoC logs via owner_plugin
-        if (owner_plugin && owner_plugin->capture_handler) {
-            stoc_success = owner_plugin->capture_handler->ExportLogsToFolder(folder_name);
+        if (owner_plugin->capture_handler) {
+            if (job.streaming) {
+                stoc_success = owner_plugin->capture_handler->FlushStreamToFolder(folder_name, session.capture, &progress);
+            } else if (session.IsPacked()) {
+                // a retained session, inflated for the length of the export
+                const CaptureSnapshot capture = session.UnpackCapture();
+                stoc_success = owner_plugin->capture_handler->ExportLogsToFolder(folder_name, capture, archive ? &*archive : nullptr, &progress);
+            } else {
+                stoc_success = owner_plugin->capture_handler->ExportLogsToFolder(folder_name, session.capture, archive ? &*archive : nullptr, &progress);
+            }
         } else {
-            GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, L"Capture handler invalid (via owner plugin), cannot export StoC logs.");
+            PostChatMessage(L"Capture handler invalid (via owner plugin), cannot export StoC logs.");
         }
 
         // export Loop logs via owner_plugin
-        if (owner_plugin && owner_plugin->loop_handler) {
-            agent_success = owner_plugin->loop_handler->ExportAgentLogs(folder_name);
+        if (owner_plugin->loop_handler) {
+            if (job.streaming) {
+                agent_success = owner_plugin->loop_handler->FlushAgentStream(folder_name, session.agent_logs, &progress);
+            } else {
+                agent_success = owner_plugin->loop_handler->ExportAgentLogs(folder_name, session.agent_logs, archive ? &*archive : nullptr, &progress);
+            }
         } else {
-            GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, L"Loop handler invalid (via owner plugin), cannot export Agent logs.");
+            PostChatMessage(L"Loop handler invalid (via owner plugin), cannot export Agent logs.");
         }
 
-        if (!owner_plugin) {
-            GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, L"Error: ObserverPlugin instance not available for string conversion in export.");
-            return false; 
+        any_success = infos_success || stoc_success || agent_success;
+
+        if (archive && any_success) {
+            progress.BeginPhase(ExportPhase::Finishing, 1);
+            archive->Finish();
+            std::wstring success_msg = L"Match archive written: ";
+            success_msg += std::filesystem::absolute(base_dir / (session.name + L".obsm")).wstring();
+            PostChatMessage(success_msg);
         }
 
+    } catch (const ExportCancelled&) {
+        throw; // a partial archive is removed with its writer, the queue reports the cancel
     } catch (const std::filesystem::filesystem_error& e) {
-        std::string error_msg_str = "Filesystem error during export: ";
-        error_msg_str += e.what();
-        wchar_t werror_msg[512] = {0};
-        MultiByteToWideChar(CP_UTF8, 0, error_msg_str.c_str(), -1, werror_msg, 512);
-        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, werror_msg);
+        PostExportError("Filesystem error during export: ", e.what());
         any_success = false;
     } catch (const std::exception& e) {
-        std::string error_msg_str = "Generic error during export: ";
-        error_msg_str += e.what();
-        wchar_t werror_msg[512] = {0};
-        MultiByteToWideChar(CP_UTF8, 0, error_msg_str.c_str(), -1, werror_msg, 512);
-        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, werror_msg);
+        PostExportError("Generic error during export: ", e.what());
         any_success = false;
-    } catch (...) {
-         GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, L"An unexpected error occurred during export.");
-         any_success = false;
     }
 
+    last_export_duration_ms_ = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - export_start).count());
+
     // overall success message
     if (any_success) {
         wchar_t msg[512];
-        swprintf_s(msg, L"Export attempt finished for '%ls'. Infos: %ls, StoC: %ls, Agents: %ls.", 
+        swprintf_s(msg, L"Export attempt finished for '%ls' in %u ms. Infos: %ls, StoC: %ls, Agents: %ls.", 
                    folder_name, 
+                   last_export_duration_ms_.load(),
                    infos_success ? L"OK" : L"FAIL", 
                    stoc_success ? L"OK" : L"FAIL",
                    agent_success ? L"OK" : L"FAIL");
-        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, msg);
+        PostChatMessage(msg);
     } else {
-        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, L"Export completely failed.");
+        PostChatMessage(L"Export completely failed.");
     }
-    
-    return any_success;
 }
-
 void ObserverMatch::HandleMatchEnd() {
     GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, L"Observer mode ended (handled by ObserverMatch).");
 
@@ -728,6 +1019,10 @@ void ObserverMatch::HandleMatchEnd() {
     }
 
     this->UpdateAgentSkillTemplates();
+    if (owner_plugin) {
+        // the match keeps this name if it is retained, even when the name is auto-reset below
+        last_match_name_ = owner_plugin->StringToWString(owner_plugin->export_folder_name);
+    }
 
     if (owner_plugin && owner_plugin->auto_export_on_match_end) {
         GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, L"Auto-export triggered...");
@@ -737,11 +1032,8 @@ void ObserverMatch::HandleMatchEnd() {
             errno_t err = mbstowcs_s(&converted, wfoldername, sizeof(owner_plugin->export_folder_name), owner_plugin->export_folder_name, _TRUNCATE);
 
             if (err == 0) {
-                if (this->ExportLogsToFolder(wfoldername)) { 
-                     wchar_t msg[512];
-                     swprintf_s(msg, L"Successfully auto-exported logs to 'captures/%ls'.", wfoldername); 
-                     GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, msg);
-                } else {
+                // runs on the export worker, the hook returns right away
+                if (!this->QueueExport(wfoldername)) { 
                      wchar_t msg[512];
                      swprintf_s(msg, L"Auto-export failed. Check previous errors. Folder was 'captures/%ls'.", wfoldername);
                      GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, msg);
@@ -766,40 +1058,30 @@ void ObserverMatch::HandleMatchEnd() {
     }
 }
 
-void MatchInfo::Reset() {
-    map_id = 0;
-    end_time_ms = 0;
-    end_time_formatted = L"";
-    winner_party_id = 0;
-    ClearAgentInfoMap(); 
-    ClearGuildInfoMap();
-    {
-        std::lock_guard<std::mutex> lock(team_damage_mutex);
-        team_damage.clear();
-    }
+MatchResult MatchInfo::GetResult() const {
+    MatchResult result;
+    result.end_time_ms = end_time_ms;
+    result.end_time_formatted = end_time_formatted;
+    result.match_duration = match_duration;
+    result.match_original_duration = match_original_duration;
+    result.winner_party_id = winner_party_id;
+    return result;
 }
 
 void MatchInfo::ClearAgentInfoMap() {
     std::lock_guard<std::mutex> lock(agents_info_mutex);
-    agents_info.clear();
+    agents_info.Clear();
+    agent_stats.Clear();
+    roster.store(std::make_shared<const MatchRoster>());
+    roster_dirty = false;
+    roster_version.fetch_add(1, std::memory_order_release);
+    skill_template_codes.clear();
 }
 
 void MatchInfo::ClearGuildInfoMap() {
     std::lock_guard<std::mutex> lock(guilds_info_mutex);
     guilds_info.clear();
-}
-
-void MatchInfo::AddPlayerDamage(uint32_t agent_id, long damage) {
-    if (agent_id == 0) return;
-    
-    std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        it->second.total_damage += damage;
-        if (it->second.total_damage < 0) {
-            it->second.total_damage = 0;
-        }
-    }
+    roster_version.fetch_add(1, std::memory_order_release);
 }
 
 void MatchInfo::AddTeamDamage(uint32_t team_id, long damage) {
@@ -818,153 +1100,6 @@ long MatchInfo::GetTeamDamage(uint32_t team_id) const {
     return (it != team_damage.end()) ? it->second : 0L;
 }
 
-void MatchInfo::IncrementAttacksStarted(uint32_t agent_id) {
-    if (agent_id == 0) return;
-    std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        it->second.attacks_started++;
-    }
-}
-
-void MatchInfo::IncrementAttacksFinished(uint32_t agent_id) {
-    if (agent_id == 0) return;
-    std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        it->second.attacks_finished++;
-    }
-}
-
-void MatchInfo::IncrementAttacksStopped(uint32_t agent_id) {
-    if (agent_id == 0) return;
-    std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        it->second.attacks_stopped++;
-    }
-}
-
-void MatchInfo::IncrementSkillsActivated(uint32_t agent_id) {
-    if (agent_id == 0) return;
-    std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        it->second.skills_activated++;
-    }
-}
-
-void MatchInfo::IncrementSkillsFinished(uint32_t agent_id) {
-    if (agent_id == 0) return;
-    std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        it->second.skills_finished++;
-    }
-}
-
-void MatchInfo::IncrementSkillsStopped(uint32_t agent_id) {
-    if (agent_id == 0) return;
-    std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        it->second.skills_stopped++;
-    }
-}
-
-void MatchInfo::IncrementAttackSkillsActivated(uint32_t agent_id) {
-    if (agent_id == 0) return;
-    std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        it->second.attack_skills_activated++;
-    }
-}
-
-void MatchInfo::IncrementAttackSkillsFinished(uint32_t agent_id) {
-    if (agent_id == 0) return;
-    std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        it->second.attack_skills_finished++;
-    }
-}
-
-void MatchInfo::IncrementAttackSkillsStopped(uint32_t agent_id) {
-    if (agent_id == 0) return;
-    std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        it->second.attack_skills_stopped++;
-    }
-}
-
-void MatchInfo::IncrementInterrupted(uint32_t agent_id, bool is_skill) {
-    if (agent_id == 0) return;
-    std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        it->second.interrupted_count++;
-        if (is_skill) {
-            it->second.interrupted_skills_count++;
-        }
-    }
-}
-
-void MatchInfo::IncrementCancelledAttack(uint32_t agent_id) {
-    if (agent_id == 0) return;
-    std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        it->second.cancelled_attacks_count++;
-    }
-}
-
-void MatchInfo::IncrementCancelledSkill(uint32_t agent_id) {
-    if (agent_id == 0) return;
-    std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        it->second.cancelled_skills_count++;
-    }
-}
-
-void MatchInfo::IncrementCritsDealt(uint32_t agent_id) {
-    if (agent_id == 0) return;
-    std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        it->second.crits_dealt++;
-    }
-}
-
-void MatchInfo::IncrementCritsReceived(uint32_t agent_id) {
-    if (agent_id == 0) return;
-    std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        it->second.crits_received++;
-    }
-}
-
-void MatchInfo::IncrementDeaths(uint32_t agent_id) {
-    if (agent_id == 0) return;
-    std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        it->second.deaths++;
-    }
-}
-
-void MatchInfo::IncrementKills(uint32_t agent_id) {
-    if (agent_id == 0) return;
-    std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it != agents_info.end()) {
-        it->second.kills++;
-    }
-}
-
 void ObserverMatch::SetOwnerPlugin(ObserverPlugin* plugin) {
     owner_plugin = plugin;
 }
@@ -974,54 +1109,51 @@ bool ObserverMatch::IsObserving() const {
 }
 
 MatchInfo& ObserverMatch::GetMatchInfo() {
-    return current_match_info_;
+    return *live_match_info_.load();
 }
 
-void MatchInfo::UpdateAgentSkillTemplate(uint32_t agent_id) {
-    if (agent_id == 0) return;
+void MatchInfo::UpdateSkillTemplates() {
+    const std::shared_ptr<const SkillMetaTable> skills = GetSkillTable();
 
     std::lock_guard<std::mutex> lock(agents_info_mutex);
-    auto it = agents_info.find(agent_id);
-    if (it == agents_info.end()) return;
+    for (size_t slot = 0; slot < agents_info.size(); ++slot) {
+        AgentDetails& agent = agents_info.Details(slot);
+        if (!agent.skill_template_dirty) continue;
+        agent.skill_template_dirty = false;
+        agent.used_skill_ids.Order(*skills, agent.primary_profession);
+
+        // here we convert PvP skills to PvE skills if needed, the key holds the ids the template is encoded with
+        std::array<uint32_t, 10> key{agent.primary_profession, agent.secondary_profession};
+        const size_t max_skills = std::min(agent.used_skill_ids.size(), static_cast<size_t>(8));
+        for (size_t i = 0; i < max_skills; i++) {
+            uint32_t skill_id = agent.used_skill_ids[i];
+            if (const SkillMeta* skill = skills->Find(skill_id)) {
+                skill_id = skill->template_skill_id;
+            }
+            key[2 + i] = skill_id;
+        }
 
-    AgentInfo& agent = it->second;
-    
-    GW::SkillbarMgr::SkillTemplate skill_template;
-    
-    skill_template.primary = static_cast<GW::Constants::Profession>(agent.primary_profession);
-    skill_template.secondary = static_cast<GW::Constants::Profession>(agent.secondary_profession);
-      skill_template.attributes_count = 0;
-    memset(skill_template.attribute_ids, 0, sizeof(skill_template.attribute_ids));
-    memset(skill_template.attribute_values, 0, sizeof(skill_template.attribute_values));
-    
-    memset(skill_template.skills, 0, sizeof(skill_template.skills));
-    const size_t max_skills = std::min(agent.used_skill_ids.size(), static_cast<size_t>(8));
-    for (size_t i = 0; i < max_skills; i++) {
-        uint32_t skill_id = agent.used_skill_ids[i];
-        
-        // here we convert PvP skills to PvE skills if needed
-        GW::Skill* skill = GW::SkillbarMgr::GetSkillConstantData(static_cast<GW::Constants::SkillID>(skill_id));
-        if (skill && skill->IsPvP() && static_cast<uint32_t>(skill->skill_id_pvp) != 0) {
-            // if it's a PvP skill, we use skill_id_pvp which is actually the PvE version
-            skill_id = static_cast<uint32_t>(skill->skill_id_pvp);
+        auto it = skill_template_codes.find(key);
+        if (it == skill_template_codes.end()) {
+            GW::SkillbarMgr::SkillTemplate skill_template;
+            skill_template.primary = static_cast<GW::Constants::Profession>(key[0]);
+            skill_template.secondary = static_cast<GW::Constants::Profession>(key[1]);
+            skill_template.attributes_count = 0;
+            memset(skill_template.attribute_ids, 0, sizeof(skill_template.attribute_ids));
+            memset(skill_template.attribute_values, 0, sizeof(skill_template.attribute_values));
+            for (size_t i = 0; i < 8; i++) {
+                skill_template.skills[i] = static_cast<GW::Constants::SkillID>(key[2 + i]);
+            }
+
+            char template_code[128] = {0};
+            const bool encoded = GW::SkillbarMgr::EncodeSkillTemplate(skill_template, template_code, sizeof(template_code));
+            it = skill_template_codes.emplace(key, encoded ? template_code : "").first;
         }
-        
-        skill_template.skills[i] = static_cast<GW::Constants::SkillID>(skill_id);
-    }
-    
-    char template_code[128] = {0};
-    if (GW::SkillbarMgr::EncodeSkillTemplate(skill_template, template_code, sizeof(template_code))) {
-        agent.skill_template_code = template_code;
-    } else {
-        agent.skill_template_code = "";
+        agent.skill_template_code = it->second;
     }
 }
 
-// implementation of the function to update the skill templates of all agents
+// encodes the skill templates of the agents whose skills changed since the last update
 void ObserverMatch::UpdateAgentSkillTemplates() {
-    std::map<uint32_t, AgentInfo> agents_copy = current_match_info_.GetAgentsInfoCopy();
-    for (const auto& pair : agents_copy) {
-        current_match_info_.UpdateAgentSkillTemplate(pair.first);
-    }
-
+    current_match_info_->UpdateSkillTemplates();
 }
@@ -6,11 +6,21 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <array>
 #include <set>
 #include <mutex>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <initializer_list>
+#include "ObserverAgentStats.h"
+#include "ObserverSkillTable.h"
 #include <GWCA/GameEntities/Guild.h>  
 class ObserverStoC; 
 class ObserverPlugin;
+class ExportProgress;
+struct MatchExportJob;
+struct MatchSession;
 
 namespace GW { namespace Packet { namespace StoC { struct InstanceLoadInfo; } } }
 
@@ -25,7 +35,8 @@ enum class AgentType {
     OTHER // NPCs (Guild Lord, Bodyguard, Flag?, etc.)
 };
 
-struct AgentInfo {
+// identity and rarely written fields of an agent (names, skills, template code)
+struct AgentDetails {
     uint32_t agent_id = 0;
     uint32_t party_id = 0; 
     AgentType type = AgentType::UNKNOWN;
@@ -36,28 +47,62 @@ struct AgentInfo {
     uint32_t player_number = 0; 
     std::wstring encoded_name; 
     uint16_t guild_id = 0; 
-    std::vector<uint32_t> used_skill_ids;
+    UsedSkillSet used_skill_ids; // ordered for display by the copies MatchInfo hands out
     uint32_t model_id = 0;
     uint32_t gadget_id = 0;
     std::string skill_template_code;
-    long total_damage = 0;
-    uint32_t attacks_started = 0;
-    uint32_t attacks_finished = 0;
-    uint32_t attacks_stopped = 0;
-    uint32_t skills_activated = 0;
-    uint32_t skills_finished = 0;
-    uint32_t skills_stopped = 0;
-    uint32_t attack_skills_activated = 0;
-    uint32_t attack_skills_finished = 0;
-    uint32_t attack_skills_stopped = 0;
-    uint32_t interrupted_count = 0;
-    uint32_t interrupted_skills_count = 0;
-    uint32_t cancelled_attacks_count = 0;
-    uint32_t cancelled_skills_count = 0;
-    uint32_t crits_dealt = 0;
-    uint32_t crits_received = 0;
-    uint32_t deaths = 0;
-    uint32_t kills = 0;
+    bool skill_template_dirty = false; // used skills or professions changed since skill_template_code was encoded
+};
+
+// an agent as handed out by MatchInfo, details and counters copied out of their tables
+struct AgentInfo : AgentDetails, AgentCounters {};
+
+// agent details of the match in slots reached through a dense agent id index, so a lookup is an array
+// index. the counters live in MatchInfo::agent_stats, the per-packet bumps never touch the details.
+// slots are never removed, only the whole table is cleared with the match.
+class AgentTable {
+public:
+    static constexpr uint32_t kMaxIndexedAgentId = 65535; // larger ids are found by a linear scan
+
+    int32_t FindSlot(uint32_t agent_id) const; // -1 for unknown agents
+    size_t AddSlot(uint32_t agent_id);         // expects an unknown agent
+    void Clear();
+
+    size_t size() const { return details_.size(); }
+    bool empty() const { return details_.empty(); }
+    AgentDetails& Details(size_t slot) { return details_[slot]; }
+    const AgentDetails& Details(size_t slot) const { return details_[slot]; }
+
+private:
+    std::vector<AgentDetails> details_;
+    std::vector<int32_t> slot_by_id_; // -1 for ids without a slot
+};
+
+// agent fields the packet handlers look up, copied out of agents_info when the roster changes
+struct RosterAgent {
+    uint32_t agent_id = 0;
+    uint32_t party_id = 0;
+    AgentType type = AgentType::UNKNOWN;
+    uint32_t team_id = 0;
+    std::wstring encoded_name;
+};
+
+// immutable snapshot of the known agents. it is published whole and never modified afterwards,
+// so readers keep it through a shared_ptr without locks or copies while the next one is built
+class MatchRoster {
+public:
+    MatchRoster() = default;
+    explicit MatchRoster(const AgentTable& agents);
+
+    const RosterAgent* Find(uint32_t agent_id) const; // nullptr for agents outside the roster
+    bool Contains(uint32_t agent_id) const { return Find(agent_id) != nullptr; }
+    size_t size() const { return agents_.size(); }
+
+private:
+    static constexpr uint32_t kMaxSlotAgentId = 65535; // larger ids fall back to a binary search
+
+    std::vector<RosterAgent> agents_; // sorted by agent id
+    std::vector<int32_t> slots_;      // index into agents_ by agent id, -1 for unknown ids
 };
 
 struct GuildInfo {
@@ -75,6 +120,36 @@ struct GuildInfo {
 
 };
 
+// one team as the composition and lord damage windows draw it
+struct TeamView {
+    uint32_t team_id = 0;
+    std::string name; // utf-8 name of the team's most common guild, "Team N" without one
+    std::string tag;  // utf-8 tag of that guild, empty without one
+    bool has_player = false;
+    std::vector<AgentDetails> members; // players, heroes and henchmen, by type then player number
+};
+
+// immutable teams of the match built from agents_info and guilds_info, rebuilt by MatchInfo::GetTeamView
+// only after roster_version moved, so the windows draw from it every frame without copying or sorting
+struct MatchTeamView {
+    uint64_t version = 0; // roster_version the view was built from
+    bool has_agents = false;
+    std::vector<TeamView> teams; // by team id
+    bool CanDisplayTeams() const; // at least two teams with a player
+};
+
+// end of match fields of a MatchInfo. the game thread writes them without a lock,
+// so a session takes a copy for its export
+struct MatchResult {
+    uint32_t end_time_ms = 0;
+    std::wstring end_time_formatted;
+    std::wstring match_duration;
+    std::wstring match_original_duration;
+    uint32_t winner_party_id = 0;
+};
+
+// one observed match. a new one is swapped in when a match starts, the previous one stays
+// with its session, so exports read it through its locks while the next match fills its own
 struct MatchInfo {
     uint32_t map_id = 0;
     uint32_t end_time_ms = 0;
@@ -83,47 +158,47 @@ struct MatchInfo {
     std::wstring match_original_duration = L""; // store original duration without adjustment [mm:ss]
     uint32_t winner_party_id = 0; // 0 = not set, 1 = party 1, 2 = party 2
 
-    std::map<uint32_t, AgentInfo> agents_info;
+    AgentTable agents_info;
     mutable std::mutex agents_info_mutex; 
+    AgentStatTable agent_stats; // agents are tracked once UpdateAgentInfo has seen them
+    bool roster_dirty = false; // agents_info changed a roster field since the last PublishRoster, guarded by agents_info_mutex
+    std::atomic<std::shared_ptr<const MatchRoster>> roster{std::make_shared<const MatchRoster>()};
     std::map<uint16_t, GuildInfo> guilds_info;
     mutable std::mutex guilds_info_mutex;
+    std::atomic<uint64_t> roster_version{0}; // bumped when an agent or guild field the team view reads changes
+    mutable std::shared_ptr<const MatchTeamView> team_view; // last built view, guarded by team_view_mutex
+    mutable std::mutex team_view_mutex;
+    std::atomic<std::shared_ptr<const SkillMetaTable>> skill_table{std::make_shared<const SkillMetaTable>()};
+    // encoded codes by {primary, secondary, 8 template skill ids}, shared by agents with the same bar.
+    // guarded by agents_info_mutex
+    std::map<std::array<uint32_t, 10>, std::string> skill_template_codes;
     
     std::map<uint32_t, long> team_damage;
     mutable std::mutex team_damage_mutex;
 
-    void Reset();
+    MatchResult GetResult() const; // game thread
 
     void ClearAgentInfoMap();
 
     void ClearGuildInfoMap();
 
     void UpdateAgentInfo(const AgentInfo& info);
-    std::map<uint32_t, AgentInfo> GetAgentsInfoCopy() const;
+    std::vector<AgentInfo> GetAgentsInfoCopy() const; // sorted by agent id
+    void PublishRoster(); // rebuilds the roster snapshot if agents_info changed since the last one
+    std::shared_ptr<const MatchRoster> GetRoster() const { return roster.load(); } // never null
     void AddSkillUsed(uint32_t agent_id, uint32_t skill_id); 
-    void SortAgentSkills(uint32_t agent_id);
-    void UpdateAgentSkillTemplate(uint32_t agent_id);
-    void AddPlayerDamage(uint32_t agent_id, long damage);
+    void BuildSkillTable(); // reads the skills' constant data for the match, game thread
+    std::shared_ptr<const SkillMetaTable> GetSkillTable() const { return skill_table.load(); } // never null
+    void UpdateSkillTemplates(); // encodes the templates of agents whose skills changed since the last call
+    // counts for agents known to agents_info, without locks. safe from any thread
+    void Bump(uint32_t agent_id, AgentStat stat, long amount = 1) { agent_stats.Bump(agent_id, stat, amount); }
+    void Bump(uint32_t agent_id, std::initializer_list<AgentStat> stats) { agent_stats.Bump(agent_id, stats); }
     void AddTeamDamage(uint32_t team_id, long damage);
     long GetTeamDamage(uint32_t team_id) const;
-    void IncrementAttacksStarted(uint32_t agent_id);
-    void IncrementAttacksFinished(uint32_t agent_id);
-    void IncrementAttacksStopped(uint32_t agent_id);
-    void IncrementSkillsActivated(uint32_t agent_id);
-    void IncrementSkillsFinished(uint32_t agent_id);
-    void IncrementSkillsStopped(uint32_t agent_id);
-    void IncrementAttackSkillsActivated(uint32_t agent_id);
-    void IncrementAttackSkillsFinished(uint32_t agent_id);
-    void IncrementAttackSkillsStopped(uint32_t agent_id);
-    void IncrementInterrupted(uint32_t agent_id, bool is_skill);
-    void IncrementCancelledAttack(uint32_t agent_id);
-    void IncrementCancelledSkill(uint32_t agent_id);
-    void IncrementCritsDealt(uint32_t agent_id);
-    void IncrementCritsReceived(uint32_t agent_id);
-    void IncrementDeaths(uint32_t agent_id);
-    void IncrementKills(uint32_t agent_id);
 
     void UpdateGuildInfo(const GuildInfo& info);
     std::map<uint16_t, GuildInfo> GetGuildsInfoCopy() const;
+    std::shared_ptr<const MatchTeamView> GetTeamView() const; // never null, rebuilt only if roster_version moved
 };
 
 class ObserverMatch {
@@ -141,17 +216,43 @@ public:
     void SetMatchEndInfo(uint32_t end_time_ms, uint32_t raw_winner_id);
 
     void ClearLogs();
-    bool ExportLogsToFolder(const wchar_t* folder_name);
+    // snapshots the match and queues its export, the files are written by the export worker.
+    // returns false if nothing was queued
+    bool QueueExport(const wchar_t* folder_name);
+    bool QueueSessionExport(const std::shared_ptr<MatchSession>& session); // exports a retained match under its own name
+
+    // previous matches kept for export, newest first
+    std::vector<std::shared_ptr<MatchSession>> GetRetainedSessions() const;
+    void ClearRetainedSessions();
     void HandleMatchEnd();
     void UpdateAgentSkillTemplates();
+    void BeginCaptureStream(); // starts streaming into captures/<Match Name>/ if enabled
+    uint32_t GetLastExportDurationMs() const { return last_export_duration_ms_.load(); }
 
 private:
     void HandleInstanceLoadInfo(const GW::HookStatus* status, const GW::Packet::StoC::InstanceLoadInfo* packet);
+    static std::string BuildInfosJson(const MatchSession& session); // export worker
+    // swaps the live buffers into a retained session when a new match starts.
+    // a streamed match is handed with its stream to the export worker, which appends its tail
+    void RetireSession();
+    void swapMatchInfo(uint32_t map_id); // starts a new MatchInfo, the retired one stays with its session
+    std::shared_ptr<MatchSession> takeSession(const std::wstring& name); // shares the match info, no buffers yet
+    void detachCapture(MatchSession& session); // moves the capture, the agent logs and the stream into session
+    void runExport(const MatchExportJob& job, ExportProgress& progress);
 
     GW::HookEntry InstanceLoadInfo_Entry; // manages the hook for instance load info packets
     bool is_observing = false;            // flag to indicate if the current map is an observer mode instance
     ObserverStoC* stoc_handler_ = nullptr; // pointer to the StoC handler
     ObserverPlugin* owner_plugin = nullptr; // pointer to the owner plugin
 
-    MatchInfo current_match_info_; // holds info for the current/last observed match
+    // info of the current/last observed match, swapped on the game thread. the handler threads read it
+    // through live_match_info_, and the previous one is kept a match longer for a handler still holding it
+    std::shared_ptr<MatchInfo> current_match_info_;
+    std::shared_ptr<MatchInfo> previous_match_info_;
+    std::atomic<MatchInfo*> live_match_info_{nullptr};
+    std::atomic<uint32_t> last_export_duration_ms_{0}; // wall time of the last export job
+
+    mutable std::mutex retained_sessions_mutex_; // the ui lists them while a new match retires one
+    std::deque<std::shared_ptr<MatchSession>> retained_sessions_;
+    std::wstring last_match_name_; // Match Name at the end of the last match, before any auto-reset
 }; 
\ No newline at end of file
@@ -3,6 +3,9 @@
 #include "ObserverCapture.h"
 #include "ObserverLoop.h"
 #include "ObserverMatchData.h"
+#include "ObserverCompression.h"
+#include "ObserverSession.h"
+#include "ObserverChunks.h"
 
 #include <GWCA/Constants/Constants.h>
 #include <GWCA/Managers/MapMgr.h>
@@ -58,11 +61,13 @@ ObserverPlugin::ObserverPlugin() :
     show_match_compositions_settings_window(false),
     show_lord_damage_window(false)
 {
+    StartExportWorkers();
     stoc_handler = new ObserverStoC(this);
     match_handler = new ObserverMatch(stoc_handler);
     match_handler->SetOwnerPlugin(this);
     capture_handler = new ObserverCapture();
     loop_handler = new ObserverLoop(this, match_handler);
+    export_queue = new ObserverExportQueue();
 
     match_compositions_settings_window_ = new MatchCompositionsSettingsWindow();
 
@@ -97,6 +102,11 @@ ObserverPlugin::ObserverPlugin() :
 // destructor needs to be defined if we manually delete handlers
 ObserverPlugin::~ObserverPlugin()
 {
+    // the export worker uses the handlers below, it goes first
+    if (export_queue) {
+        delete export_queue;
+        export_queue = nullptr;
+    }
     if (stoc_handler) {
         delete stoc_handler;
         stoc_handler = nullptr;
@@ -113,6 +123,9 @@ ObserverPlugin::~ObserverPlugin()
         delete loop_handler;
         loop_handler = nullptr;
     }
+    stream_handler.reset();
+    // nothing runs export jobs anymore
+    StopExportWorkers();
     if (match_compositions_settings_window_) {
         delete match_compositions_settings_window_;
         match_compositions_settings_window_ = nullptr;
@@ -173,9 +186,18 @@ void ObserverPlugin::LoadSettings(const wchar_t* folder)
     
     PLUGIN_LOAD_BOOL(auto_export_on_match_end);
     PLUGIN_LOAD_BOOL(auto_reset_name_on_match_end);
+    PLUGIN_LOAD_BOOL(stream_capture_to_disk);
+    PLUGIN_LOAD_BOOL(export_agent_trajectories);
+    PLUGIN_LOAD_BOOL(export_match_archive);
+    PLUGIN_LOAD_INT(compression_level);
+    PLUGIN_LOAD_INT(retained_match_count);
+    PLUGIN_LOAD_INT(capture_memory_budget_mb);
     PLUGIN_LOAD_BOOL(show_match_compositions_window);
     PLUGIN_LOAD_BOOL(show_match_compositions_settings_window);
     PLUGIN_LOAD_BOOL(show_lord_damage_window);
+
+    SetCompressionSettings({CaptureCodec::Gzip, compression_level});
+    CaptureChunkStore::SetMemoryBudget(static_cast<uint64_t>(capture_memory_budget_mb) * 1024 * 1024);
 }
 
 void ObserverPlugin::SaveSettings(const wchar_t* folder)
@@ -233,6 +255,12 @@ void ObserverPlugin::SaveSettings(const wchar_t* folder)
     
     PLUGIN_SAVE_BOOL(auto_export_on_match_end);
     PLUGIN_SAVE_BOOL(auto_reset_name_on_match_end);
+    PLUGIN_SAVE_BOOL(stream_capture_to_disk);
+    PLUGIN_SAVE_BOOL(export_agent_trajectories);
+    PLUGIN_SAVE_BOOL(export_match_archive);
+    PLUGIN_SAVE_INT(compression_level);
+    PLUGIN_SAVE_INT(retained_match_count);
+    PLUGIN_SAVE_INT(capture_memory_budget_mb);
     PLUGIN_SAVE_BOOL(show_match_compositions_window);
     PLUGIN_SAVE_BOOL(show_match_compositions_settings_window);
     PLUGIN_SAVE_BOOL(show_lord_damage_window);
@@ -248,8 +276,20 @@ const char* ObserverPlugin::Name() const {
     return "Observer Plugin";
 }
 
-void ObserverPlugin::AddLogEntry(const wchar_t* entry) {
-    if (capture_handler) capture_handler->AddLogEntry(entry);
+void ObserverPlugin::AddEvent(const CaptureEvent& event, CaptureCategory category) {
+    if (capture_handler) capture_handler->AddEvent(event, category);
+}
+
+void ObserverPlugin::AddEvents(const CaptureEvent* events, size_t count, CaptureCategory category) {
+    if (capture_handler) capture_handler->AddEvents(events, count, category);
+}
+
+CaptureTextRef ObserverPlugin::AddEventText(const wchar_t* text) {
+    return capture_handler ? capture_handler->AddText(text) : CaptureTextRef{};
+}
+
+void ObserverPlugin::SetEventText(const CaptureTextRef& text_ref, const wchar_t* text) {
+    if (capture_handler) capture_handler->SetText(text_ref, text);
 }
 
 void ObserverPlugin::GenerateDefaultFolderName() {
@@ -288,6 +328,9 @@ void ObserverPlugin::SignalTerminate()
     if (loop_handler) {
         loop_handler->Stop(); // ensure agent loop is stopped
     }
+    if (export_queue) {
+        export_queue->WaitIdle(); // queued exports hold the last match, let them finish
+    }
 }
 
 // main draw function, called every frame
@@ -343,7 +386,7 @@ void ObserverPlugin::Draw(
                     std::wstring wfoldername = StringToWString(export_folder_name);
                     if (!wfoldername.empty()) {
                         if (match_handler) {
-                           match_handler->ExportLogsToFolder(wfoldername.c_str());
+                           match_handler->QueueExport(wfoldername.c_str());
                         } else {
                             GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, L"Error: Match handler not available.");
                         }
@@ -355,7 +398,29 @@ void ObserverPlugin::Draw(
                 }
             }
              if (ImGui::IsItemHovered()) {
-                ImGui::SetTooltip("Exports all captured StoC events and Agent Loop snapshots for the current match to the specified 'captures/<Match Name>/' folder.");
+                ImGui::SetTooltip("Exports all captured StoC events and Agent Loop snapshots for the current match to the specified 'captures/<Match Name>/' folder.\nThe export runs in the background, capture goes on meanwhile.");
+            }
+
+            // progress of the background export
+            if (export_queue && export_queue->IsBusy()) {
+                const ExportProgress& progress = export_queue->GetProgress();
+                const std::string running_name = WStringToString(export_queue->GetRunningName());
+                char overlay[128];
+                snprintf(overlay, sizeof(overlay), "%s %u/%u", GetExportPhaseName(progress.GetPhase()),
+                         progress.GetDoneSteps(), progress.GetTotalSteps());
+                ImGui::Text("%s '%s'", progress.GetPhase() == ExportPhase::Packing ? "Packing" : "Exporting", running_name.c_str());
+                ImGui::ProgressBar(progress.GetFraction(), ImVec2(ImGui::GetContentRegionAvail().x * 0.6f, 0), overlay);
+                ImGui::SameLine();
+                if (ImGui::Button("Cancel##CancelExport")) {
+                    export_queue->CancelAll();
+                }
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("Stops the running export and drops the queued ones.\nA cancelled folder export keeps only the files it completed,\npartly written ones are removed.");
+                }
+                const size_t queued = export_queue->GetQueuedCount();
+                if (queued > 0) {
+                    ImGui::TextDisabled("%zu more export(s) queued", queued);
+                }
             }
 
             ImGui::Spacing();
@@ -368,6 +433,63 @@ void ObserverPlugin::Draw(
             if (ImGui::IsItemHovered()) {
                 ImGui::SetTooltip("If checked, automatically generates a new default match name when observer mode ends.");
             }
+            ImGui::Checkbox("Stream Capture to Disk", &stream_capture_to_disk);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("If checked, logs are compressed into 'captures/<Match Name>/' in chunks during the match,\nso exporting at match end only flushes the last seconds. Applies from the next match.");
+            }
+            ImGui::Checkbox("Export Agent Trajectories", &export_agent_trajectories);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("If checked, exports also write 'Agents/<id>.traj', a binary format split in compressed\n10 second blocks with a time index, so replay tools can jump to any time.\nNot written when streaming the capture to disk.");
+            }
+            ImGui::Checkbox("Export as Match Archive", &export_match_archive);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("If checked, exports write a single 'captures/<Match Name>.obsm' file holding every log\nwith a table of contents, instead of a folder of files.\nNot used when streaming the capture to disk.");
+            }
+
+            // compression used by every export and streamed chunk
+            bool compression_changed = ImGui::SliderInt("Compression Level", &compression_level, 1, 9);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("gzip level for exports and streamed chunks: 1 is the fastest, 9 the smallest.\nUse 1 when exports are cpu bound.");
+            }
+            if (compression_changed) {
+                SetCompressionSettings({CaptureCodec::Gzip, compression_level});
+            }
+
+            ImGui::SliderInt("Matches Kept for Export", &retained_match_count, 0, 10);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("When a new observer match starts, the previous one is kept in memory (compressed)\ninstead of being cleared, so it can still be exported. 0 clears it like before.\nNot used when streaming the capture to disk, the match is on disk already.");
+            }
+
+            if (ImGui::SliderInt("Capture Memory Budget (MB)", &capture_memory_budget_mb, 16, 2048)) {
+                CaptureChunkStore::SetMemoryBudget(static_cast<uint64_t>(capture_memory_budget_mb) * 1024 * 1024);
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("StoC events and long agent logs are compressed in memory in chunks during the match.\nPast this much compressed data across every match, the oldest chunks are moved\nto a temp file until the export reads them.");
+            }
+
+            // previous matches kept in memory, newest first
+            if (match_handler) {
+                const auto sessions = match_handler->GetRetainedSessions();
+                if (!sessions.empty() && ImGui::TreeNode("Previous Matches")) {
+                    for (size_t i = 0; i < sessions.size(); ++i) {
+                        const MatchSession& session = *sessions[i];
+                        const std::string session_name = WStringToString(session.name);
+                        ImGui::Text("%s (map %u, %zu events, %.1f MB%s)", session_name.c_str(), session.map_id,
+                                    session.GetEventCount(), session.GetMemoryBytes() / (1024.0 * 1024.0),
+                                    session.IsPacked() ? ", packed" : "");
+                        ImGui::SameLine();
+                        ImGui::PushID(static_cast<int>(i));
+                        if (ImGui::Button("Export")) {
+                            match_handler->QueueSessionExport(sessions[i]);
+                        }
+                        ImGui::PopID();
+                    }
+                    if (ImGui::Button("Forget Previous Matches")) {
+                        match_handler->ClearRetainedSessions();
+                    }
+                    ImGui::TreePop();
+                }
+            }
 
             ImGui::Unindent();
             ImGui::TreePop(); 
@@ -414,7 +536,7 @@ void ObserverPlugin::Draw(
 #endif
 
         ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.6f, 0.6f, 0.6f, 1.0f)); 
-        ImGui::TextWrapped("Note: Captured match data (StoC events & Agent states) remains in memory after observer mode ends. You can still export the previous match using the 'Export' button above. Data will be cleared automatically when a new observer session begins.");
+        ImGui::TextWrapped("Note: Captured match data (StoC events & Agent states) remains in memory after observer mode ends. You can still export the previous match using the 'Export' button above. When a new observer session begins, it moves to 'Previous Matches' (if kept) and the capture starts over.");
         ImGui::PopStyleColor();
           }
     ImGui::End();
@@ -490,9 +612,8 @@ std::wstring ObserverPlugin::StringToWString(const std::string_view str) {
     return dest;
 }
 
-void ObserverPlugin::HandleMatchEndSignal(uint32_t winner_party_raw_id) {
-    uint32_t end_time_ms = GW::Map::GetInstanceTime();
-
+void ObserverPlugin::HandleMatchEndSignal(uint32_t winner_party_raw_id, uint32_t end_time_ms) {
+    // end_time_ms is the time of the victory packet, this runs a little later on the game thread
     if (match_handler) {
         match_handler->SetMatchEndInfo(end_time_ms, winner_party_raw_id);
     }
@@ -19,6 +19,8 @@
 #include "ObserverMatch.h"
 #include "ObserverCapture.h"
 #include "ObserverLoop.h"
+#include "ObserverStream.h"
+#include "ObserverExport.h"
 #include "Debug/CaptureStatusWindow.h"
 #include "Debug/LivePartyInfoWindow.h"
 #include "Debug/LiveGuildInfoWindow.h"
@@ -55,13 +57,24 @@ public:
     ObserverMatch* match_handler = nullptr;
     ObserverCapture* capture_handler = nullptr;
     ObserverLoop* loop_handler = nullptr;
+    std::shared_ptr<ObserverStream> stream_handler; // stream of the match being captured, one per match, game thread
+    ObserverExportQueue* export_queue = nullptr; // background worker for exports
 
     // proxy methods for log capture
-    void AddLogEntry(const wchar_t* entry);
+    void AddEvent(const CaptureEvent& event, CaptureCategory category);
+    void AddEvents(const CaptureEvent* events, size_t count, CaptureCategory category); // appended together
+    CaptureTextRef AddEventText(const wchar_t* text);
+    void SetEventText(const CaptureTextRef& text_ref, const wchar_t* text);
     
     // Main window controls
     bool auto_export_on_match_end = false;
     bool auto_reset_name_on_match_end = false;
+    bool stream_capture_to_disk = false; // seal logs into captures/<name>/ during the match
+    bool export_agent_trajectories = false; // also write Agents/<id>.traj (binary, seekable) on export
+    bool export_match_archive = false;   // export into a single captures/<name>.obsm file instead of a folder
+    int retained_match_count = 3;        // previous matches kept in memory for export
+    int capture_memory_budget_mb = 256;  // compressed capture chunks kept in memory before spilling to a temp file
+    int compression_level = 9;           // zlib level 1-9 used for exported and streamed logs
     char export_folder_name[128]; // buffer for folder name input
 
     // Debug window visibility
@@ -126,7 +139,7 @@ public:
     // public helper functions for use by other classes in the plugin
     std::string WStringToString(const std::wstring_view str);
     std::wstring StringToWString(const std::string_view str);
-    void HandleMatchEndSignal(uint32_t winner_party_raw_id);
+    void HandleMatchEndSignal(uint32_t winner_party_raw_id, uint32_t end_time_ms);
 
 private:
     CaptureStatusWindow capture_status_window;
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// bounded lock-free single-producer/single-consumer ring buffer.
+// the producer (game thread hook) only writes head_, the consumer only writes tail_,
+// so no locks are needed. Capacity must be a power of two.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "SpscRing only stores POD records");
+
+public:
+    // producer side, returns false (and leaves the ring untouched) when full
+    bool TryPush(const T& item) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head - cached_tail_ >= Capacity) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head - cached_tail_ >= Capacity) return false;
+        }
+        slots_[head & kMask] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side, returns false when empty
+    bool TryPop(T& out) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == cached_head_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail == cached_head_) return false;
+        }
+        out = slots_[tail & kMask];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // approximate number of queued items, safe to call from any thread
+    size_t Size() const {
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        const size_t head = head_.load(std::memory_order_acquire);
+        return head - tail;
+    }
+
+    static constexpr size_t GetCapacity() { return Capacity; }
+
+private:
+    static constexpr size_t kMask = Capacity - 1;
+
+    // producer and consumer indices live on separate cache lines to avoid false sharing
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0; // producer's last seen tail
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0; // consumer's last seen head
+    alignas(64) T slots_[Capacity];
+};
@@ -0,0 +1,161 @@
+#include "ObserverSegment.h"
+
+#include <mutex>
+#include <utility>
+
+namespace {
+    // blocks kept for reuse at most, about 3.5 MB. past it released blocks are freed
+    constexpr size_t kMaxFreeBlocks = 256;
+
+    // shared by the live segments: the consumer thread appends, the sealer thread drops
+    struct BlockPool {
+        std::mutex mutex;
+        std::vector<CaptureEvent*> free_blocks;
+
+        BlockPool() { free_blocks.reserve(kMaxFreeBlocks); }
+        ~BlockPool() {
+            for (CaptureEvent* block : free_blocks) delete[] block;
+        }
+    };
+
+    BlockPool& GetBlockPool() {
+        static BlockPool pool;
+        return pool;
+    }
+
+    CaptureEvent* AcquireBlock() {
+        BlockPool& pool = GetBlockPool();
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            if (!pool.free_blocks.empty()) {
+                CaptureEvent* block = pool.free_blocks.back();
+                pool.free_blocks.pop_back();
+                return block;
+            }
+        }
+        return new CaptureEvent[CaptureSegment::kBlockEvents];
+    }
+
+    void ReleaseBlock(CaptureEvent* block) {
+        BlockPool& pool = GetBlockPool();
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            if (pool.free_blocks.size() < kMaxFreeBlocks) {
+                pool.free_blocks.push_back(block);
+                return;
+            }
+        }
+        delete[] block;
+    }
+}
+
+CaptureEvent* CaptureSegment::acquireBlock() const {
+    if (source_ == BlockSource::Heap) return new CaptureEvent[kBlockEvents];
+    return AcquireBlock();
+}
+
+void CaptureSegment::releaseBlock(CaptureEvent* block) const {
+    if (source_ == BlockSource::Heap) {
+        delete[] block;
+        return;
+    }
+    ReleaseBlock(block);
+}
+
+CaptureSegment& CaptureSegment::operator=(const CaptureSegment& other) {
+    if (this != &other) assign(other, other.size());
+    return *this;
+}
+
+CaptureSegment& CaptureSegment::operator=(CaptureSegment&& other) noexcept {
+    if (this != &other) {
+        clear();
+        swap(other);
+    }
+    return *this;
+}
+
+void CaptureSegment::push_back(const CaptureEvent& event) {
+    const size_t position = first_ + size_;
+    if (position / kBlockEvents == blocks_.size()) {
+        blocks_.push_back(acquireBlock());
+    }
+    blocks_[position / kBlockEvents][position % kBlockEvents] = event;
+    ++size_;
+}
+
+void CaptureSegment::assign(const CaptureSegment& other, size_t count) {
+    clear();
+    source_ = BlockSource::Heap;
+    if (count > other.size()) count = other.size();
+    reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        push_back(other[i]);
+    }
+}
+
+void CaptureSegment::erase_front(size_t count) {
+    if (count >= size_) {
+        clear();
+        return;
+    }
+    first_ += count;
+    size_ -= count;
+    const size_t emptied = first_ / kBlockEvents;
+    for (size_t i = 0; i < emptied; ++i) {
+        releaseBlock(blocks_[i]);
+    }
+    blocks_.erase(blocks_.begin(), blocks_.begin() + emptied);
+    first_ %= kBlockEvents;
+}
+
+void CaptureSegment::resize(size_t count) {
+    if (count == 0) {
+        clear();
+        return;
+    }
+    while (size_ < count) {
+        push_back(CaptureEvent{});
+    }
+    size_ = count;
+    const size_t needed = (first_ + size_ + kBlockEvents - 1) / kBlockEvents;
+    for (size_t i = needed; i < blocks_.size(); ++i) {
+        releaseBlock(blocks_[i]);
+    }
+    blocks_.resize(needed);
+}
+
+void CaptureSegment::reserve(size_t count) {
+    blocks_.reserve((count + kBlockEvents - 1) / kBlockEvents + 1);
+}
+
+void CaptureSegment::clear() {
+    for (CaptureEvent* block : blocks_) {
+        releaseBlock(block);
+    }
+    blocks_.clear();
+    first_ = 0;
+    size_ = 0;
+}
+
+void CaptureSegment::swap(CaptureSegment& other) noexcept {
+    blocks_.swap(other.blocks_);
+    std::swap(source_, other.source_);
+    std::swap(first_, other.first_);
+    std::swap(size_, other.size_);
+}
+
+void ReserveCaptureBlocks(size_t block_count) {
+    if (block_count > kMaxFreeBlocks) block_count = kMaxFreeBlocks;
+    BlockPool& pool = GetBlockPool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    while (pool.free_blocks.size() < block_count) {
+        pool.free_blocks.push_back(new CaptureEvent[CaptureSegment::kBlockEvents]);
+    }
+}
+
+size_t GetFreeCaptureBlockCount() {
+    BlockPool& pool = GetBlockPool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    return pool.free_blocks.size();
+}
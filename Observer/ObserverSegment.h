@@ -0,0 +1,86 @@
+#pragma once
+
+#include "ObserverEvents.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+// events of one export category in arrival order, stored in fixed-size blocks taken from a shared pool.
+// sealing hands whole blocks back to the pool and the next events reuse them, so a capture in steady
+// state allocates nothing per event (a deque allocates a block every few events, or every event on msvc).
+// copies (snapshots, sealed ranges, unpacked chunks) allocate and free their own blocks instead, so they
+// never drain the pool the consumer thread appends from.
+class CaptureSegment {
+public:
+    static constexpr size_t kBlockEvents = 512; // 14 KB blocks
+
+    enum class BlockSource : uint8_t {
+        Pool, // live capture segments
+        Heap  // copies made off the consumer thread
+    };
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = CaptureEvent;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const CaptureEvent*;
+        using reference = const CaptureEvent&;
+
+        const_iterator(const CaptureSegment* segment, size_t index) : segment_(segment), index_(index) {}
+        reference operator*() const { return (*segment_)[index_]; }
+        pointer operator->() const { return &(*segment_)[index_]; }
+        const_iterator& operator++() { ++index_; return *this; }
+        bool operator==(const const_iterator& other) const { return index_ == other.index_; }
+        bool operator!=(const const_iterator& other) const { return index_ != other.index_; }
+
+    private:
+        const CaptureSegment* segment_;
+        size_t index_;
+    };
+
+    CaptureSegment() = default;
+    explicit CaptureSegment(BlockSource source) : source_(source) {}
+    ~CaptureSegment() { clear(); }
+    CaptureSegment(const CaptureSegment& other) { assign(other, other.size()); }
+    CaptureSegment& operator=(const CaptureSegment& other);
+    CaptureSegment(CaptureSegment&& other) noexcept { swap(other); }
+    CaptureSegment& operator=(CaptureSegment&& other) noexcept;
+
+    void push_back(const CaptureEvent& event);
+    void assign(const CaptureSegment& other, size_t count); // copies the first count events of other into heap blocks
+    void erase_front(size_t count); // drops the oldest events, returning emptied blocks to the pool
+    void resize(size_t count);
+    void reserve(size_t count); // room for count events in the block list, blocks still come from the pool
+    void clear();
+    void swap(CaptureSegment& other) noexcept; // the block source goes with the blocks
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    CaptureEvent& operator[](size_t index) { return at(index); }
+    const CaptureEvent& operator[](size_t index) const { return const_cast<CaptureSegment*>(this)->at(index); }
+    const CaptureEvent& front() const { return (*this)[0]; }
+    CaptureEvent& back() { return at(size_ - 1); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size_); }
+
+private:
+    CaptureEvent& at(size_t index) {
+        const size_t position = first_ + index;
+        return blocks_[position / kBlockEvents][position % kBlockEvents];
+    }
+
+    CaptureEvent* acquireBlock() const;
+    void releaseBlock(CaptureEvent* block) const;
+
+    std::vector<CaptureEvent*> blocks_; // keeps its capacity when blocks are dropped
+    BlockSource source_ = BlockSource::Pool;
+    size_t first_ = 0; // index of the oldest event in blocks_[0]
+    size_t size_ = 0;
+};
+
+// fills the block pool ahead of the capture, so even the first events of a match allocate nothing
+void ReserveCaptureBlocks(size_t block_count);
+size_t GetFreeCaptureBlockCount();
@@ -0,0 +1,58 @@
+#include "ObserverSession.h"
+#include "ObserverChunks.h"
+#include "ObserverExport.h"
+
+void MatchSession::UpdateStats() {
+    event_count_ = capture.GetEventCount();
+    memory_bytes_ = computeMemoryBytes();
+}
+
+size_t MatchSession::computeMemoryBytes() const {
+    size_t bytes = 0;
+    for (size_t c = 0; c < kCaptureCategoryCount; ++c) {
+        bytes += capture.events[c].size() * sizeof(CaptureEvent) + packed_events_[c].capacity();
+    }
+    if (capture.chunks) bytes += capture.chunks->GetMemoryBytes();
+    for (const std::wstring& text : capture.text_pool) {
+        bytes += text.capacity() * sizeof(wchar_t);
+    }
+    bytes += agent_logs.GetMemoryBytes();
+    return bytes;
+}
+
+void MatchSession::Pack(ExportProgress& progress) {
+    if (packed_.load()) return;
+
+    // the sealed chunks are packed already. the match is only read again by its export,
+    // so they give their share of the memory budget back to the live capture
+    progress.BeginPhase(ExportPhase::Packing, static_cast<uint32_t>(kCaptureCategoryCount));
+    if (capture.chunks) capture.chunks->SpillAll();
+    if (agent_logs.chunks) agent_logs.chunks->SpillAll();
+    std::array<std::vector<unsigned char>, kCaptureCategoryCount> packed;
+    for (size_t c = 0; c < kCaptureCategoryCount; ++c) {
+        progress.ThrowIfCancelled();
+        packed[c] = PackCaptureEvents(capture.events[c], capture.events[c].size());
+        progress.Step();
+    }
+
+    // nothing is dropped before every category is packed
+    for (size_t c = 0; c < kCaptureCategoryCount; ++c) {
+        packed_events_[c] = std::move(packed[c]);
+        CaptureSegment().swap(capture.events[c]);
+    }
+    packed_ = true;
+    memory_bytes_ = computeMemoryBytes();
+}
+
+CaptureSnapshot MatchSession::UnpackCapture() const {
+    CaptureSnapshot unpacked;
+    unpacked.text_pool = capture.text_pool;
+    unpacked.chunks = capture.chunks;
+    unpacked.chunk_counts = capture.chunk_counts;
+    unpacked.chunk_event_count = capture.chunk_event_count;
+    for (size_t c = 0; c < kCaptureCategoryCount; ++c) {
+        unpacked.events[c] = CaptureSegment(CaptureSegment::BlockSource::Heap);
+        UnpackCaptureEvents(packed_events_[c], unpacked.events[c]);
+    }
+    return unpacked;
+}
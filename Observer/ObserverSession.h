@@ -0,0 +1,48 @@
+#pragma once
+
+#include "ObserverCapture.h"
+#include "ObserverLoop.h"
+#include "ObserverMatch.h"
+
+#include <array>
+#include <atomic>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+class ExportProgress;
+
+// one observed match detached from the live capture, with everything an export needs.
+// entering a new observer instance swaps the live buffers into a session instead of clearing them,
+// so back to back observing neither loses the previous match nor waits on its export.
+struct MatchSession {
+    std::wstring name;       // captures/<name>, the Match Name when the session was taken
+    uint32_t map_id = 0;
+    // infos.json is rendered from these by the export worker
+    std::shared_ptr<const MatchInfo> match_info; // agents, guilds and team damage, read through their locks
+    MatchResult result;
+    std::array<uint32_t, 2> team_kills{};
+    std::time_t taken_at = 0; // the date infos.json records
+    CaptureSnapshot capture; // events are emptied by Pack, the small text pool and the chunks stay
+    AgentLogSnapshot agent_logs; // already delta encoded or chunked, only the chunks get spilled
+
+    void UpdateStats(); // call once filled
+    size_t GetEventCount() const { return event_count_; }
+    size_t GetMemoryBytes() const { return memory_bytes_.load(); }
+    bool IsPacked() const { return packed_.load(); }
+
+    // compresses the capture events of a retained session and spills its chunks. runs on the export worker,
+    // like exports of the session, so the two never overlap. throws ExportCancelled, the events are left as they were
+    void Pack(ExportProgress& progress);
+    CaptureSnapshot UnpackCapture() const; // copy of the packed events, throws on corrupted data
+
+private:
+    size_t computeMemoryBytes() const;
+
+    std::array<std::vector<unsigned char>, kCaptureCategoryCount> packed_events_; // gzip of the raw records
+    size_t event_count_ = 0;
+    std::atomic<size_t> memory_bytes_{0}; // read by the ui while the worker packs
+    std::atomic<bool> packed_{false};
+};
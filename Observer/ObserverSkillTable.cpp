@@ -0,0 +1,100 @@
+#include "ObserverSkillTable.h"
+
+#include <GWCA/Managers/SkillbarMgr.h>
+#include <GWCA/GameEntities/Skill.h>
+#include <GWCA/Constants/Skills.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+    constexpr uint64_t kUnknownSkillBit = 1ull << 63;
+    constexpr uint64_t kNotEliteBit = 1ull << 62;
+    constexpr uint64_t kOtherProfessionBit = 1ull << 61;
+}
+
+SkillMetaTable SkillMetaTable::BuildFromGame() {
+    SkillMetaTable table;
+    table.skills_.resize(static_cast<size_t>(kMaxSkillId) + 1);
+    for (uint32_t skill_id = 1; skill_id <= kMaxSkillId; ++skill_id) {
+        GW::Skill* skill = GW::SkillbarMgr::GetSkillConstantData(static_cast<GW::Constants::SkillID>(skill_id));
+        if (!skill || static_cast<uint32_t>(skill->skill_id) != skill_id) continue;
+
+        SkillMeta& meta = table.skills_[skill_id];
+        meta.skill_id = skill_id;
+        meta.template_skill_id = skill_id;
+        // for pvp skills skill_id_pvp is actually the pve version
+        if (skill->IsPvP() && static_cast<uint32_t>(skill->skill_id_pvp) != 0) {
+            meta.template_skill_id = static_cast<uint32_t>(skill->skill_id_pvp);
+        }
+        meta.profession = static_cast<uint32_t>(skill->profession);
+        meta.type = static_cast<uint32_t>(skill->type);
+        meta.is_elite = skill->IsElite();
+        meta.sort_key = (static_cast<uint64_t>(meta.type & 0xFF) << 32) | skill_id;
+    }
+    return table;
+}
+
+const SkillMeta* SkillMetaTable::Find(uint32_t skill_id) const {
+    if (skill_id == 0 || skill_id >= skills_.size()) return nullptr;
+    const SkillMeta& meta = skills_[skill_id];
+    return meta.skill_id != 0 ? &meta : nullptr;
+}
+
+uint64_t SkillSortKey(const SkillMeta* skill, uint32_t skill_id, bool has_elite, uint32_t leading_profession) {
+    if (!skill) return kUnknownSkillBit | skill_id;
+    uint64_t key = skill->sort_key;
+    if (has_elite && !skill->is_elite) key |= kNotEliteBit;
+    if (skill->profession != leading_profession) key |= kOtherProfessionBit;
+    return key;
+}
+
+bool UsedSkillSet::Insert(uint32_t skill_id) {
+    if (std::find(begin(), end(), skill_id) != end()) return false;
+
+    if (spilled_.empty() && inline_size_ < kInlineSkills) {
+        inline_[inline_size_++] = skill_id;
+    } else {
+        if (spilled_.empty()) spilled_.assign(inline_.begin(), inline_.begin() + inline_size_);
+        spilled_.push_back(skill_id);
+    }
+    ordered_for_ = kUnordered;
+    return true;
+}
+
+void UsedSkillSet::Order(const SkillMetaTable& skills, uint32_t primary_profession) {
+    // an empty table knows no skill, the set is ordered once the match's table is there
+    if (ordered_for_ == primary_profession || skills.empty()) return;
+
+    uint32_t* first = data();
+    const size_t count = size();
+
+    // the first elite of the set leads the bar, without one the agent's primary profession does
+    bool has_elite = false;
+    uint32_t leading_profession = primary_profession;
+    for (size_t i = 0; i < count; ++i) {
+        const SkillMeta* skill = skills.Find(first[i]);
+        if (skill && skill->is_elite) {
+            has_elite = true;
+            leading_profession = skill->profession;
+            break;
+        }
+    }
+
+    // keys are computed once per skill, the sort compares plain integers
+    std::array<std::pair<uint64_t, uint32_t>, kInlineSkills> inline_keys;
+    std::vector<std::pair<uint64_t, uint32_t>> spilled_keys;
+    std::pair<uint64_t, uint32_t>* keys = inline_keys.data();
+    if (count > kInlineSkills) {
+        spilled_keys.resize(count);
+        keys = spilled_keys.data();
+    }
+    for (size_t i = 0; i < count; ++i) {
+        keys[i] = {SkillSortKey(skills.Find(first[i]), first[i], has_elite, leading_profession), first[i]};
+    }
+    std::sort(keys, keys + count);
+    for (size_t i = 0; i < count; ++i) {
+        first[i] = keys[i].second;
+    }
+    ordered_for_ = primary_profession;
+}
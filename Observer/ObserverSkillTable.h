@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// constant data of a skill the observer orders, exports and counts lord damage by
+struct SkillMeta {
+    uint32_t skill_id = 0;
+    uint32_t template_skill_id = 0; // the pve version of pvp skills, as skill templates expect
+    uint32_t profession = 0;
+    uint32_t type = 0; // GW::Constants::SkillType
+    bool is_elite = false;
+    uint64_t sort_key = 0; // type and skill id packed below the per-agent bits of SkillSortKey
+};
+
+// every skill's constant data read from GWCA once per match, so the packet handlers and the skill
+// ordering index an array instead of going through the skillbar manager per lookup or comparison.
+// built on one thread and published whole through MatchInfo, it is never modified afterwards.
+class SkillMetaTable {
+public:
+    static constexpr uint32_t kMaxSkillId = 4095; // past the last skill id GW uses
+
+    SkillMetaTable() = default;       // empty, every lookup misses
+    static SkillMetaTable BuildFromGame(); // reads GWCA, needs the game's skill array loaded
+
+    const SkillMeta* Find(uint32_t skill_id) const; // nullptr for ids without constant data
+    bool empty() const { return skills_.empty(); }
+
+private:
+    std::vector<SkillMeta> skills_; // by skill id, skill_id 0 for ids without constant data
+};
+
+// order of a used skill within an agent's bar: known skills before unknown ones, the elite first,
+// then skills of the elite's profession (or the primary without an elite), then by type and id.
+// smaller keys come first
+uint64_t SkillSortKey(const SkillMeta* skill, uint32_t skill_id, bool has_elite, uint32_t leading_profession);
+
+// skills an agent was seen using, without duplicates. a bar's worth of ids lives inline and larger sets
+// spill into a heap vector. ids are kept in arrival order until Order is asked for by a reader.
+class UsedSkillSet {
+public:
+    static constexpr size_t kInlineSkills = 12;
+
+    bool Insert(uint32_t skill_id); // false if the skill was already in the set
+    // sorts the ids by SkillSortKey for an agent of that primary profession, a no-op if already in that order
+    void Order(const SkillMetaTable& skills, uint32_t primary_profession);
+
+    size_t size() const { return spilled_.empty() ? inline_size_ : spilled_.size(); }
+    bool empty() const { return size() == 0; }
+    const uint32_t* begin() const { return spilled_.empty() ? inline_.data() : spilled_.data(); }
+    const uint32_t* end() const { return begin() + size(); }
+    uint32_t operator[](size_t index) const { return begin()[index]; }
+
+private:
+    static constexpr uint32_t kUnordered = UINT32_MAX;
+
+    uint32_t* data() { return spilled_.empty() ? inline_.data() : spilled_.data(); }
+
+    std::array<uint32_t, kInlineSkills> inline_{};
+    uint8_t inline_size_ = 0;
+    std::vector<uint32_t> spilled_;        // every id once the inline slots are full
+    uint32_t ordered_for_ = kUnordered;    // primary profession of the last Order, kUnordered after an insert
+};
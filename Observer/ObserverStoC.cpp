@@ -2,7 +2,9 @@
 #include "ObserverPlugin.h"
 #include "ObserverMatch.h"
 #include "ObserverMatchData.h"
+#include "ObserverLoop.h"
 #include "ObserverPackets.h"
+#include "ObserverAllocations.h"
 #include "TextUtils.h"
 
 #include <GWCA/Constants/Constants.h>
@@ -11,36 +13,76 @@
 #include <GWCA/Managers/MapMgr.h>
 #include <GWCA/Managers/AgentMgr.h>
 #include <GWCA/Managers/SkillbarMgr.h>
+#include <GWCA/Managers/GameThreadMgr.h>
 #include <GWCA/GameEntities/Agent.h>
 #include <GWCA/GameEntities/Skill.h>
+#include <algorithm>
+#include <array>
 #include <cstdio>
+#include <iterator>
 #include <string>
 #include <cmath>
+#include <cstring>
+#include <chrono>
+
+namespace {
+    // chat echo of emitted events: messages are copied into fixed slots and written by one game thread task,
+    // so echoing allocates nothing on the thread handling packets. a full ring drops the echo, never the event
+    struct ChatEchoMessage {
+        wchar_t text[256];
+    };
+    SpscRing<ChatEchoMessage, 64> chat_echo_ring;
+    std::atomic<bool> chat_echo_scheduled{false};
+
+    void WriteChatEchoes() {
+        chat_echo_scheduled = false; // echoes pushed from here on schedule the next task
+        ChatEchoMessage message;
+        while (chat_echo_ring.TryPop(message)) {
+            GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, message.text);
+        }
+    }
 
-// define markers for categorization (declarations are in ObserverStoC.h)
-const wchar_t* MARKER_SKILL_EVENT = L"[SKL] ";
-const size_t MARKER_SKILL_EVENT_LEN = wcslen(MARKER_SKILL_EVENT);
-const wchar_t* MARKER_ATTACK_SKILL_EVENT = L"[ASK] ";
-const size_t MARKER_ATTACK_SKILL_EVENT_LEN = wcslen(MARKER_ATTACK_SKILL_EVENT);
-const wchar_t* MARKER_BASIC_ATTACK_EVENT = L"[ATK] ";
-const size_t MARKER_BASIC_ATTACK_EVENT_LEN = wcslen(MARKER_BASIC_ATTACK_EVENT);
-const wchar_t* MARKER_COMBAT_EVENT = L"[CMB] ";
-const size_t MARKER_COMBAT_EVENT_LEN = wcslen(MARKER_COMBAT_EVENT);
-const wchar_t* MARKER_AGENT_EVENT = L"[AGT] ";
-const size_t MARKER_AGENT_EVENT_LEN = wcslen(MARKER_AGENT_EVENT);
-const wchar_t* MARKER_JUMBO_EVENT = L"[JMB] ";
-const size_t MARKER_JUMBO_EVENT_LEN = wcslen(MARKER_JUMBO_EVENT);
-const wchar_t* MARKER_LORD_EVENT = L"[LRD] ";
-const size_t MARKER_LORD_EVENT_LEN = wcslen(MARKER_LORD_EVENT);
-const wchar_t* MARKER_AGENT_STATE_EVENT = L"[AST] ";
-const size_t MARKER_AGENT_STATE_EVENT_LEN = wcslen(MARKER_AGENT_STATE_EVENT);
-
-// convert JumboMessage value to a simple party index string for logging
-const wchar_t* JumboValueToPartyStr(uint32_t value) {
-    switch (value) {
-        case GW::Packet::StoC::JumboMessageValue::PARTY_ONE: return L"Party 1";
-        case GW::Packet::StoC::JumboMessageValue::PARTY_TWO: return L"Party 2";
-        default: return L"Unknown Party";
+    // what makes two packets the same work for the steady-state check
+    uint64_t GetPacketKey(const StoCPacketRecord& record) {
+        uint64_t key = 0xCBF29CE484222325ull ^ static_cast<uint64_t>(record.type);
+        for (uint32_t part : {record.value_id, record.caster_id, record.target_id, record.value}) {
+            key = (key ^ part) * 0x100000001B3ull;
+        }
+        return key;
+    }
+}
+
+namespace {
+    using ChatToggle = bool ObserverPlugin::*;
+
+    // chat toggle of each CaptureEventKind, null for kinds whose chat output depends on more than the kind
+    constexpr ChatToggle kChatToggles[] = {
+        &ObserverPlugin::log_skill_activations,        // SkillActivated
+        &ObserverPlugin::log_instant_skills,           // InstantSkillUsed
+        &ObserverPlugin::log_skill_finishes,           // SkillFinished
+        &ObserverPlugin::log_skill_stops,              // SkillStopped
+        &ObserverPlugin::log_attack_skill_activations, // AttackSkillActivated
+        &ObserverPlugin::log_attack_skill_finishes,    // AttackSkillFinished
+        &ObserverPlugin::log_attack_skill_stops,       // AttackSkillStopped
+        &ObserverPlugin::log_basic_attack_starts,      // AttackStarted
+        &ObserverPlugin::log_basic_attack_finishes,    // AttackFinished
+        &ObserverPlugin::log_basic_attack_stops,       // AttackStopped
+        &ObserverPlugin::log_damage,                   // Damage
+        &ObserverPlugin::log_knockdowns,               // KnockedDown
+        &ObserverPlugin::log_interrupts,               // Interrupted
+        &ObserverPlugin::log_lord_damage,              // LordDamage
+        nullptr,                                       // LordDamageTotals, echoed with its LordDamage record
+        &ObserverPlugin::log_movement,                 // AgentMoveToPoint
+        nullptr,                                       // JumboMessage, one toggle per message type
+        &ObserverPlugin::log_agent_state_updates,      // AgentStateUpdate
+        nullptr,                                       // DeathResurrection, never echoed, only its text is patched in
+    };
+    static_assert(std::size(kChatToggles) == static_cast<size_t>(CaptureEventKind::Count),
+                  "kChatToggles needs one entry per CaptureEventKind");
+
+    bool IsChatLogged(const ObserverPlugin& plugin, CaptureEventKind kind) {
+        const ChatToggle toggle = kChatToggles[static_cast<size_t>(kind)];
+        return plugin.stoc_status && toggle && plugin.*toggle;
     }
 }
 
@@ -50,22 +92,32 @@ ObserverStoC::ObserverStoC(ObserverPlugin* owner_plugin) : owner(owner_plugin) {
 }
 
 ObserverStoC::~ObserverStoC() {
+    stopConsumer();
     cleanupAgentActions();
 }
 
 void ObserverStoC::RegisterCallbacks() {
+    // hooks only copy the packet (and the agents it references) into the ring,
+    // everything else happens on the consumer thread
+    startConsumer();
+
     // GenericModifier (0x57) (Damage, Knockdown, etc.)
     GW::StoC::RegisterPacketCallback<GW::Packet::StoC::GenericModifier>(
         &GenericModifier_Entry,
         [this](const GW::HookStatus*, const GW::Packet::StoC::GenericModifier* packet) -> void {
             if (!owner) return; 
-
-            const uint32_t value_id = packet->type;
-            const uint32_t caster_id = packet->cause_id;
-            const uint32_t target_id = packet->target_id;
-            const float value = packet->value;
-            constexpr bool no_target = false; // this packet type always has a target
-            handleGenericPacket(value_id, caster_id, target_id, value, no_target);
+            LARGE_INTEGER start;
+            QueryPerformanceCounter(&start);
+
+            StoCPacketRecord record;
+            record.type = StoCPacketType::GenericModifier;
+            record.value_id = packet->type;
+            record.caster_id = packet->cause_id;
+            record.target_id = packet->target_id;
+            std::memcpy(&record.value, &packet->value, sizeof(record.value));
+            snapshotAgent(record.caster_id, record.caster);
+            snapshotAgent(record.target_id, record.target);
+            pushRecord(record, start.QuadPart);
         }
     );
 
@@ -74,14 +126,17 @@ void ObserverStoC::RegisterCallbacks() {
         &GenericValueTarget_Entry,
         [this](const GW::HookStatus*, const GW::Packet::StoC::GenericValueTarget* packet) -> void {
             if (!owner) return; // Only check if owner exists
-
-            const uint32_t value_id = packet->Value_id;
-            const uint32_t caster_id = packet->caster;
-            const uint32_t target_id = packet->target;
-            const uint32_t value = packet->value;
-            constexpr bool no_target = false; // this packet type always has a target
-            handleGenericPacket(value_id, caster_id, target_id, value, no_target);
-            handleValueTargetPacket(const_cast<GW::Packet::StoC::GenericValueTarget*>(packet));
+            LARGE_INTEGER start;
+            QueryPerformanceCounter(&start);
+
+            StoCPacketRecord record;
+            record.type = StoCPacketType::GenericValueTarget;
+            record.value_id = packet->Value_id;
+            record.caster_id = packet->caster;
+            record.target_id = packet->target;
+            record.value = packet->value;
+            snapshotAgent(record.caster_id, record.caster); // needed for the lord check
+            pushRecord(record, start.QuadPart);
         }
     );
 
@@ -90,13 +145,15 @@ void ObserverStoC::RegisterCallbacks() {
         &GenericValue_Entry,
         [this](const GW::HookStatus*, const GW::Packet::StoC::GenericValue* packet) -> void {
             if (!owner) return; // Only check if owner exists
-
-            const uint32_t value_id = packet->value_id;
-            const uint32_t caster_id = packet->agent_id;
-            constexpr uint32_t target_id = 0; // no target in this packet type
-            const uint32_t value = packet->value;
-            constexpr bool no_target = true;
-            handleGenericPacket(value_id, caster_id, target_id, value, no_target);
+            LARGE_INTEGER start;
+            QueryPerformanceCounter(&start);
+
+            StoCPacketRecord record;
+            record.type = StoCPacketType::GenericValue;
+            record.value_id = packet->value_id;
+            record.caster_id = packet->agent_id;
+            record.value = packet->value;
+            pushRecord(record, start.QuadPart);
         }
     );
 
@@ -105,13 +162,15 @@ void ObserverStoC::RegisterCallbacks() {
         &GenericFloat_Entry,
         [this](const GW::HookStatus*, const GW::Packet::StoC::GenericFloat* packet) -> void {
             if (!owner) return; // Only check if owner exists
-
-            const uint32_t value_id = packet->type;
-            const uint32_t caster_id = packet->agent_id;
-            constexpr uint32_t target_id = 0; // no target in this packet type
-            const float value = packet->value;
-            constexpr bool no_target = true;
-            handleGenericPacket(value_id, caster_id, target_id, value, no_target);
+            LARGE_INTEGER start;
+            QueryPerformanceCounter(&start);
+
+            StoCPacketRecord record;
+            record.type = StoCPacketType::GenericFloat;
+            record.value_id = packet->type;
+            record.caster_id = packet->agent_id;
+            std::memcpy(&record.value, &packet->value, sizeof(record.value));
+            pushRecord(record, start.QuadPart);
         }
     );
 
@@ -121,6 +180,8 @@ void ObserverStoC::RegisterCallbacks() {
         GAME_SMSG_AGENT_MOVE_TO_POINT,
         [this](const GW::HookStatus*, GW::Packet::StoC::PacketBase* pak) -> void {
             if (!owner) return; // Only check if owner exists
+            LARGE_INTEGER start;
+            QueryPerformanceCounter(&start);
 
             // position packet structure : (maybe more infos in GWCA)
 
@@ -132,13 +193,15 @@ void ObserverStoC::RegisterCallbacks() {
             // uint16_t word2; (unknown data)
 
             uint32_t* data = (uint32_t*)pak;
-            uint32_t agent_id = data[1];
-            float x = *(float*)(&data[2]);
-            float y = *(float*)(&data[3]);
             uint16_t* word_data = (uint16_t*)(&data[4]);
-            uint16_t plane = word_data[0];
 
-            handleAgentMovement(agent_id, x, y, plane);
+            StoCPacketRecord record;
+            record.type = StoCPacketType::AgentMovement;
+            record.caster_id = data[1];
+            record.value = data[2]; // x, raw float bits
+            record.y = *(float*)(&data[3]);
+            record.plane = word_data[0];
+            pushRecord(record, start.QuadPart);
         }
     );
 
@@ -146,14 +209,28 @@ void ObserverStoC::RegisterCallbacks() {
     GW::StoC::RegisterPacketCallback<GW::Packet::StoC::JumboMessage>(
         &JumboMessage_Entry, [this](const GW::HookStatus*, const GW::Packet::StoC::JumboMessage* packet) -> void {
             if (!owner) return; // Only check if owner exists
-            handleJumboMessage(packet);
+            LARGE_INTEGER start;
+            QueryPerformanceCounter(&start);
+
+            StoCPacketRecord record;
+            record.type = StoCPacketType::JumboMessage;
+            record.value_id = packet->type;
+            record.value = packet->value;
+            pushRecord(record, start.QuadPart);
         });
     
     // AgentState packet callback
     GW::StoC::RegisterPacketCallback<GW::Packet::StoC::AgentState>(
         &AgentState_Entry, [this](const GW::HookStatus*, const GW::Packet::StoC::AgentState* packet) -> void {
             if (!owner) return; // Only check if owner exists
-            handleAgentState(packet);
+            LARGE_INTEGER start;
+            QueryPerformanceCounter(&start);
+
+            StoCPacketRecord record;
+            record.type = StoCPacketType::AgentState;
+            record.caster_id = packet->agent_id;
+            record.value_id = packet->state;
+            pushRecord(record, start.QuadPart);
         });    // Note: OpposingPartyGuild packet no longer used - team detection now handled via agent analysis like MatchCompositions
 }
 
@@ -167,31 +244,220 @@ void ObserverStoC::RemoveCallbacks() {
     GW::StoC::RemoveCallback<GW::Packet::StoC::JumboMessage>(&JumboMessage_Entry);
     GW::StoC::RemoveCallback<GW::Packet::StoC::AgentState>(&AgentState_Entry);
 
-    cleanupAgentActions(); // clean up map pointers before clearing the map itself
+    stopConsumer(); // handles what is left in the ring before the state below goes away
+    cleanupAgentActions(); // forget the actions and per-agent state of this instance
 }
 
-// ==================== Private Helper Methods ====================
+StoCQueueStats ObserverStoC::GetQueueStats() const {
+    StoCQueueStats stats;
+    stats.pushed = packets_pushed_.load(std::memory_order_relaxed);
+    stats.dropped = packets_dropped_.load(std::memory_order_relaxed);
+    stats.queued = packet_ring_.Size();
+    stats.capacity = packet_ring_.GetCapacity();
+
+    const uint64_t packets = hook_packets_.load(std::memory_order_relaxed);
+    if (packets > 0) {
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        const double ticks = static_cast<double>(hook_ticks_.load(std::memory_order_relaxed));
+        stats.hook_ns_per_packet = ticks * 1e9 / static_cast<double>(frequency.QuadPart) / static_cast<double>(packets);
+    }
+    const uint64_t handled = handled_packets_.load(std::memory_order_relaxed);
+    if (handled > 0) {
+        stats.allocations_per_packet = static_cast<double>(handled_allocations_.load(std::memory_order_relaxed)) / static_cast<double>(handled);
+    }
+    stats.steady_state_failures = steady_state_failures_.load(std::memory_order_relaxed);
+    stats.failed_packet_type = failed_packet_type_.load(std::memory_order_relaxed);
+    stats.failed_value_id = failed_value_id_.load(std::memory_order_relaxed);
+    return stats;
+}
 
-void ObserverStoC::cleanupAgentActions() {
-    for (auto const& [caster_id, action_info_ptr] : agent_active_action) {
-        if (action_info_ptr) {
-            delete action_info_ptr;
+void ObserverStoC::ResetQueueStats() {
+    packets_pushed_ = 0;
+    packets_dropped_ = 0;
+    hook_packets_ = 0;
+    hook_ticks_ = 0;
+    handled_packets_ = 0;
+    handled_allocations_ = 0;
+    steady_state_failures_ = 0;
+}
+
+// ==================== Packet Queue ====================
+
+void ObserverStoC::snapshotAgent(uint32_t agent_id, StoCAgentSnapshot& out) const {
+    // the loop refreshes known agents every tick, GWCA is only walked for agents it has not seen yet
+    if (owner->loop_handler && owner->loop_handler->GetAgentAttributes().Load(agent_id, out)) return;
+
+    GW::Agent* agent = GW::Agents::GetAgentByID(agent_id);
+    if (!agent) return;
+    GW::AgentLiving* living = agent->GetAsAgentLiving();
+    if (!living) return;
+
+    out.is_living = 1;
+    out.max_hp = living->max_hp;
+    out.player_number = static_cast<uint16_t>(living->player_number);
+    out.team_id = static_cast<uint8_t>(living->team_id);
+}
+
+void ObserverStoC::pushRecord(StoCPacketRecord& record, int64_t hook_start) {
+    // stamp on the game thread so the time matches the packet, not the consumer
+    record.time_ms = GW::Map::GetInstanceTime();
+    record.is_observing = GW::Map::GetIsObserving() ? 1 : 0;
+
+    if (inline_processing_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(process_mutex_);
+        // records queued before inline processing was turned on go first, so events keep the packet order
+        drainRingLocked();
+        processRecordCounted(record);
+    } else if (packet_ring_.TryPush(record)) {
+        packets_pushed_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        packets_dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    LARGE_INTEGER end;
+    QueryPerformanceCounter(&end);
+    hook_ticks_.fetch_add(static_cast<uint64_t>(end.QuadPart - hook_start), std::memory_order_relaxed);
+    hook_packets_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ObserverStoC::startConsumer() {
+    if (run_consumer_.load()) return;
+
+    ResetQueueStats();
+    run_consumer_ = true;
+    consumer_thread_ = std::thread(&ObserverStoC::runConsumer, this);
+}
+
+void ObserverStoC::stopConsumer() {
+    run_consumer_ = false;
+    if (consumer_thread_.joinable()) {
+        consumer_thread_.join();
+    }
+}
+
+void ObserverStoC::runConsumer() {
+    while (run_consumer_.load()) {
+        if (!drainRing()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
     }
-    agent_active_action.clear();
+    drainRing(); // packets pushed before the hooks were removed
+}
+
+bool ObserverStoC::drainRing() {
+    std::lock_guard<std::mutex> lock(process_mutex_);
+    return drainRingLocked();
+}
+
+// the ring has a single consumer at a time: the consumer thread, or the game thread processing inline
+bool ObserverStoC::drainRingLocked() {
+    bool handled_any = false;
+    StoCPacketRecord record;
+    while (packet_ring_.TryPop(record)) {
+        processRecordCounted(record);
+        handled_any = true;
+    }
+    return handled_any;
+}
+
+void ObserverStoC::processRecordCounted(const StoCPacketRecord& record) {
+    if constexpr (kCountAllocations) {
+        // a packet handled in steady state (agents and skills seen before) should allocate nothing,
+        // and one identical to a packet already handled is steady state by definition
+        const bool replayed = !handled_keys_.Insert(GetPacketKey(record));
+        const uint64_t allocations_before = GetThreadAllocationCount();
+        processRecord(record);
+        const uint64_t allocations = GetThreadAllocationCount() - allocations_before;
+        handled_allocations_.fetch_add(allocations, std::memory_order_relaxed);
+        handled_packets_.fetch_add(1, std::memory_order_relaxed);
+        if (replayed && allocations > 0) {
+            failed_packet_type_.store(static_cast<uint32_t>(record.type), std::memory_order_relaxed);
+            failed_value_id_.store(record.value_id, std::memory_order_relaxed);
+            steady_state_failures_.fetch_add(1, std::memory_order_relaxed);
+        }
+    } else {
+        processRecord(record);
+    }
+}
+
+void ObserverStoC::processRecord(const StoCPacketRecord& record) {
+    current_time_ms_ = record.time_ms;
+
+    float value_float = 0.0f;
+    switch (record.type) {
+        case StoCPacketType::GenericModifier:
+            std::memcpy(&value_float, &record.value, sizeof(value_float));
+            handleGenericPacket(record.value_id, record.caster_id, record.target_id, value_float, record);
+            break;
+
+        case StoCPacketType::GenericValueTarget:
+            handleGenericPacket(record.value_id, record.caster_id, record.target_id, record.value, false);
+            handleValueTargetPacket(record.value, record);
+            break;
+
+        case StoCPacketType::GenericValue:
+            handleGenericPacket(record.value_id, record.caster_id, 0u, record.value, true);
+            break;
+
+        case StoCPacketType::GenericFloat:
+            std::memcpy(&value_float, &record.value, sizeof(value_float));
+            handleGenericPacket(record.value_id, record.caster_id, 0u, value_float, record);
+            break;
+
+        case StoCPacketType::AgentMovement:
+            std::memcpy(&value_float, &record.value, sizeof(value_float));
+            handleAgentMovement(record.caster_id, value_float, record.y, record.plane);
+            break;
+
+        case StoCPacketType::JumboMessage:
+            handleJumboMessage(record.value_id, record.value);
+            break;
+
+        case StoCPacketType::AgentState:
+            handleAgentState(record.caster_id, record.value_id);
+            break;
+    }
+}
+
+// ==================== Private Helper Methods ====================
+
+void ObserverStoC::cleanupAgentActions() {
+    agent_active_action.Clear();
     agent_previous_states.clear();
     agent_last_hit_by.clear();
+    handled_keys_.Clear(); // agent ids are reused by the next instance
+}
+
+void ObserverStoC::emitEvent(CaptureEvent& event, bool show_in_chat, CaptureEvent* continuation) {
+    event.time_ms = current_time_ms_;
+    if (continuation) {
+        continuation->time_ms = current_time_ms_;
+        const CaptureEvent pair[2] = {event, *continuation};
+        owner->AddEvents(pair, 2, GetCaptureEventCategory(event.kind));
+    } else {
+        owner->AddEvent(event, GetCaptureEventCategory(event.kind));
+    }
+
+    // text is only rendered when the event is echoed to chat, which must happen on the game thread
+    if (show_in_chat) {
+        ChatEchoMessage message;
+        if (FormatCaptureEvent(event, continuation, nullptr, message.text, 256) > 0 && chat_echo_ring.TryPush(message) &&
+            !chat_echo_scheduled.exchange(true)) {
+            // captureless, so the task fits in std::function without a heap block
+            GW::GameThread::Enqueue(WriteChatEchoes);
+        }
+    }
 }
 
 void ObserverStoC::logActionActivation(uint32_t caster_id, uint32_t target_id, uint32_t skill_id,
-                                        bool no_target, const wchar_t* action_identifier,
-                                        const wchar_t* category_marker)
+                                        bool no_target, CaptureEventKind kind)
 {
     if (!owner || !owner->match_handler) return; // ensure owner and match_handler exist
 
     // logs the start of an action (skill activation or basic attack start)
     // handles the potential swap of caster/target ids depending on packet type
-    // also stores the action details in agent_active_action map for later reference (e.g., completion)
+    // also stores the action details in agent_active_action for later reference (e.g., completion)
 
     // resolve actual caster and target based on packet type context
     uint32_t actual_caster_id;
@@ -204,123 +470,66 @@ void ObserverStoC::logActionActivation(uint32_t caster_id, uint32_t target_id, u
         actual_target_id = caster_id;
     }
 
-    // clean up any previous action stored for this caster
-    auto it = agent_active_action.find(actual_caster_id);
-    if (it != agent_active_action.end()) {
-        delete it->second; // free memory of the old action info
-        agent_active_action.erase(it);
-    }
-
-    // store new action info
+    // store new action info, replacing any previous action of this caster
     // use skill_id 0 to represent basic attacks (triggered by attack_started value_id)
     uint32_t stored_skill_id = (skill_id == static_cast<uint32_t>(GW::Packet::StoC::GenericValueID::attack_started)) ? 0 : skill_id;
-    ActiveActionInfo* new_action = new ActiveActionInfo{stored_skill_id, actual_target_id};
-    agent_active_action[actual_caster_id] = new_action;
+    agent_active_action.Start(actual_caster_id, stored_skill_id, actual_target_id, current_time_ms_);
 
     // add skills used to match info
     if (stored_skill_id != 0) { 
         owner->match_handler->GetMatchInfo().AddSkillUsed(actual_caster_id, stored_skill_id);
     }
 
-    // format log message using the new semicolon format
-    wchar_t message_buffer[128];
-    if (wcscmp(action_identifier, L"ATTACK_STARTED") == 0) {
-         swprintf(message_buffer, sizeof(message_buffer)/sizeof(wchar_t), L"%ls;%u;%u", action_identifier, actual_caster_id, actual_target_id);
-    } else { // skill activation (attack skill or normal skill)
-        swprintf(message_buffer, sizeof(message_buffer)/sizeof(wchar_t), L"%ls;%u;%u;%u", action_identifier, stored_skill_id, actual_caster_id, actual_target_id);
-    }
-
-    std::wstring log_entry = category_marker;
-    log_entry += message_buffer;
-    owner->AddLogEntry(log_entry.c_str()); // add the entry with the marker
+    CaptureEvent event;
+    event.kind = kind;
+    event.caster_id = actual_caster_id;
+    event.target_id = actual_target_id;
+    event.skill_id = stored_skill_id;
 
     // write to chat only if enabled and the specific log type is enabled
-    if (owner->stoc_status) {
-        // check specific log type before writing to chat
-        if ((stored_skill_id == 0 && owner->log_basic_attack_starts) || // attack_started
-            (wcscmp(action_identifier, L"SKILL_ACTIVATED") == 0 && owner->log_skill_activations) ||
-            (wcscmp(action_identifier, L"ATTACK_SKILL_ACTIVATED") == 0 && owner->log_attack_skill_activations))
-        {
-            GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, message_buffer);
-        }
-    }
+    emitEvent(event, IsChatLogged(*owner, kind));
 }
 
-void ObserverStoC::logActionCompletion(uint32_t caster_id, const wchar_t* action_identifier,
-                                      uint32_t value_id,
-                                      const wchar_t* category_marker)
+void ObserverStoC::logActionCompletion(uint32_t caster_id, CaptureEventKind kind)
 {
     if (!owner) return;
-    wchar_t message_buffer[128];
 
     uint32_t skill_id = 0; // default to 0 if not found
     uint32_t target_id = 0; // default to 0 if not found
 
-    auto it = agent_active_action.find(caster_id);
-    if (it != agent_active_action.end()) {
+    if (const ActiveActionInfo* action_info = agent_active_action.Find(caster_id)) {
         // found stored action info for this caster
-        ActiveActionInfo* action_info = it->second;
         skill_id = action_info->skill_id;
         target_id = action_info->target_id;
 
-        bool should_cleanup = (wcscmp(action_identifier, L"SKILL_FINISHED") == 0 ||
-                               wcscmp(action_identifier, L"ATTACK_SKILL_FINISHED") == 0 ||
-                               wcscmp(action_identifier, L"ATTACK_FINISHED") == 0 ||
-                               wcscmp(action_identifier, L"INTERRUPTED") == 0);
-        
-        if (should_cleanup) {
-            delete action_info;
-            agent_active_action.erase(it);
+        if (GetCaptureEventTraits(kind).ends_action) {
+            agent_active_action.Release(caster_id);
         }
     }
     // note: for stops/interrupts, we proceed even if not found, logging only the caster_id
 
-    // format message based on the action type identifier
-    if (wcscmp(action_identifier, L"SKILL_FINISHED") == 0 ||
-        wcscmp(action_identifier, L"ATTACK_SKILL_FINISHED") == 0 ||
-        wcscmp(action_identifier, L"ATTACK_FINISHED") == 0)
-    {
-        // finishes include skill and target info (if available)
-        swprintf(message_buffer, sizeof(message_buffer)/sizeof(wchar_t), L"%ls;%u;%u;%u", action_identifier, caster_id, skill_id, target_id);
-    } else {
-        // stops and interrupts now include skill/target info if available
-        swprintf(message_buffer, sizeof(message_buffer)/sizeof(wchar_t), L"%ls;%u;%u;%u", action_identifier, caster_id, skill_id, target_id);
-    }
-
-    std::wstring log_entry = category_marker;
-    log_entry += message_buffer;
-    owner->AddLogEntry(log_entry.c_str()); // add the entry with the marker
+    // finishes, stops and interrupts all include skill/target info (if available)
+    CaptureEvent event;
+    event.kind = kind;
+    event.caster_id = caster_id;
+    event.target_id = target_id;
+    event.skill_id = skill_id;
 
     // write to chat only if enabled and the specific log type is enabled
-    if (owner->stoc_status) {
-        bool should_log_chat = false;
-        switch(value_id) { // use the original packet value_id to check the toggle
-            case GW::Packet::StoC::GenericValueID::melee_attack_finished: should_log_chat = owner->log_basic_attack_finishes; break;
-            case GW::Packet::StoC::GenericValueID::attack_stopped:        should_log_chat = owner->log_basic_attack_stops; break;
-            case GW::Packet::StoC::GenericValueID::interrupted:             should_log_chat = owner->log_interrupts; break;
-            case GW::Packet::StoC::GenericValueID::attack_skill_finished: should_log_chat = owner->log_attack_skill_finishes; break;
-            case GW::Packet::StoC::GenericValueID::attack_skill_stopped:    should_log_chat = owner->log_attack_skill_stops; break;
-            case GW::Packet::StoC::GenericValueID::skill_finished:          should_log_chat = owner->log_skill_finishes; break;
-            case GW::Packet::StoC::GenericValueID::skill_stopped:           should_log_chat = owner->log_skill_stops; break;
-        }
-
-        if (should_log_chat) {
-            GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, message_buffer);
-        }
-    }
+    emitEvent(event, IsChatLogged(*owner, kind));
 }
 
 // ==================== Packet Dispatch Handlers ====================
 
 void ObserverStoC::handleGenericPacket(const uint32_t value_id, const uint32_t caster_id,
-                                       const uint32_t target_id, const float value, const bool)
+                                       const uint32_t target_id, const float value, const StoCPacketRecord& record)
 {
     // dispatches packets containing float values (damage, knockdown) to specific handlers
     switch (value_id) {
         case GW::Packet::StoC::GenericValueID::damage:
         case GW::Packet::StoC::GenericValueID::critical:
         case GW::Packet::StoC::GenericValueID::armorignoring:
-            handleDamage(caster_id, target_id, value, value_id);
+            handleDamage(caster_id, target_id, value, value_id, record);
             break;
 
         case GW::Packet::StoC::GenericValueID::knocked_down:
@@ -332,51 +541,57 @@ void ObserverStoC::handleGenericPacket(const uint32_t value_id, const uint32_t c
 void ObserverStoC::handleGenericPacket(const uint32_t value_id, const uint32_t caster_id,
                                        const uint32_t target_id, const uint32_t value, const bool no_target)
 {
-    // dispatches packets containing uint32_t values (skills, attacks, interrupts) to specific handlers
-    switch (value_id) {
-        case GW::Packet::StoC::GenericValueID::melee_attack_finished:
-            handleAttackFinished(caster_id);
-            break;
-
-        case GW::Packet::StoC::GenericValueID::attack_stopped:
-            handleAttackStopped(caster_id);
-            break;
-
-        case GW::Packet::StoC::GenericValueID::attack_started:
-            handleAttackStarted(caster_id, target_id, no_target);
-            break;
-
-        case GW::Packet::StoC::GenericValueID::interrupted:
-            handleInterrupted(caster_id);
-            break;
-
-        case GW::Packet::StoC::GenericValueID::attack_skill_finished:
-            handleAttackSkillFinished(caster_id);
-            break;
-
-        case GW::Packet::StoC::GenericValueID::instant_skill_activated:
-            handleInstantSkillActivated(caster_id, value);
-            break;
-
-        case GW::Packet::StoC::GenericValueID::attack_skill_stopped:
-            handleAttackSkillStopped(caster_id);
-            break;
-
-        case GW::Packet::StoC::GenericValueID::attack_skill_activated:
-            handleAttackSkillActivated(caster_id, target_id, value, no_target);
-            break;
-
-        case GW::Packet::StoC::GenericValueID::skill_finished:
-            handleSkillFinished(caster_id);
-            break;
-
-        case GW::Packet::StoC::GenericValueID::skill_stopped:
-            handleSkillStopped(caster_id);
-            break;
-
-        case GW::Packet::StoC::GenericValueID::skill_activated:
-            handleSkillActivated(caster_id, target_id, value, no_target);
-            break;
+    // dispatches packets containing uint32_t values (skills, attacks, interrupts) to specific handlers.
+    // the table is indexed by value_id and built at compile time, unknown ids hit an empty slot
+    using GenericValueHandler = void (*)(ObserverStoC& self, uint32_t caster_id, uint32_t target_id, uint32_t value, bool no_target);
+    namespace ValueID = GW::Packet::StoC::GenericValueID;
+    static constexpr size_t kHandlerCount = 1 + std::max({
+        static_cast<uint32_t>(ValueID::melee_attack_finished), static_cast<uint32_t>(ValueID::attack_stopped),
+        static_cast<uint32_t>(ValueID::attack_started), static_cast<uint32_t>(ValueID::interrupted),
+        static_cast<uint32_t>(ValueID::attack_skill_finished), static_cast<uint32_t>(ValueID::instant_skill_activated),
+        static_cast<uint32_t>(ValueID::attack_skill_stopped), static_cast<uint32_t>(ValueID::attack_skill_activated),
+        static_cast<uint32_t>(ValueID::skill_finished), static_cast<uint32_t>(ValueID::skill_stopped),
+        static_cast<uint32_t>(ValueID::skill_activated)});
+    static constexpr std::array<GenericValueHandler, kHandlerCount> kHandlers = [] {
+        std::array<GenericValueHandler, kHandlerCount> handlers{};
+        handlers[ValueID::melee_attack_finished] = [](ObserverStoC& self, uint32_t caster_id, uint32_t, uint32_t, bool) {
+            self.handleAttackFinished(caster_id);
+        };
+        handlers[ValueID::attack_stopped] = [](ObserverStoC& self, uint32_t caster_id, uint32_t, uint32_t, bool) {
+            self.handleAttackStopped(caster_id);
+        };
+        handlers[ValueID::attack_started] = [](ObserverStoC& self, uint32_t caster_id, uint32_t target_id, uint32_t, bool no_target) {
+            self.handleAttackStarted(caster_id, target_id, no_target);
+        };
+        handlers[ValueID::interrupted] = [](ObserverStoC& self, uint32_t caster_id, uint32_t, uint32_t, bool) {
+            self.handleInterrupted(caster_id);
+        };
+        handlers[ValueID::attack_skill_finished] = [](ObserverStoC& self, uint32_t caster_id, uint32_t, uint32_t, bool) {
+            self.handleAttackSkillFinished(caster_id);
+        };
+        handlers[ValueID::instant_skill_activated] = [](ObserverStoC& self, uint32_t caster_id, uint32_t, uint32_t value, bool) {
+            self.handleInstantSkillActivated(caster_id, value);
+        };
+        handlers[ValueID::attack_skill_stopped] = [](ObserverStoC& self, uint32_t caster_id, uint32_t, uint32_t, bool) {
+            self.handleAttackSkillStopped(caster_id);
+        };
+        handlers[ValueID::attack_skill_activated] = [](ObserverStoC& self, uint32_t caster_id, uint32_t target_id, uint32_t value, bool no_target) {
+            self.handleAttackSkillActivated(caster_id, target_id, value, no_target);
+        };
+        handlers[ValueID::skill_finished] = [](ObserverStoC& self, uint32_t caster_id, uint32_t, uint32_t, bool) {
+            self.handleSkillFinished(caster_id);
+        };
+        handlers[ValueID::skill_stopped] = [](ObserverStoC& self, uint32_t caster_id, uint32_t, uint32_t, bool) {
+            self.handleSkillStopped(caster_id);
+        };
+        handlers[ValueID::skill_activated] = [](ObserverStoC& self, uint32_t caster_id, uint32_t target_id, uint32_t value, bool no_target) {
+            self.handleSkillActivated(caster_id, target_id, value, no_target);
+        };
+        return handlers;
+    }();
+
+    if (value_id < kHandlerCount && kHandlers[value_id]) {
+        kHandlers[value_id](*this, caster_id, target_id, value, no_target);
     }
 }
 
@@ -388,28 +603,27 @@ void ObserverStoC::handleSkillActivated(uint32_t caster_id, uint32_t target_id,
     // format: skill_activated;skill_id;caster_id;target_id
     if (owner->match_handler) {
         uint32_t actual_caster_id = no_target ? caster_id : target_id;
-        owner->match_handler->GetMatchInfo().IncrementSkillsActivated(actual_caster_id);
+        owner->match_handler->GetMatchInfo().Bump(actual_caster_id, AgentStat::SkillsActivated);
     }
-    logActionActivation(caster_id, target_id, skill_id, no_target, L"SKILL_ACTIVATED", MARKER_SKILL_EVENT);
+    logActionActivation(caster_id, target_id, skill_id, no_target, CaptureEventKind::SkillActivated);
 }
 
 void ObserverStoC::handleSkillFinished(uint32_t caster_id) {
     if (!owner) return;
     // format: skill_finished;caster_id;skill_id;target_id
     if (owner->match_handler) {
-        owner->match_handler->GetMatchInfo().IncrementSkillsFinished(caster_id);
+        owner->match_handler->GetMatchInfo().Bump(caster_id, AgentStat::SkillsFinished);
     }
-    logActionCompletion(caster_id, L"SKILL_FINISHED", GW::Packet::StoC::GenericValueID::skill_finished, MARKER_SKILL_EVENT);
+    logActionCompletion(caster_id, CaptureEventKind::SkillFinished);
 }
 
 void ObserverStoC::handleSkillStopped(uint32_t caster_id) {
     if (!owner) return;
     // format: skill_stopped;caster_id
     if (owner->match_handler) {
-        owner->match_handler->GetMatchInfo().IncrementSkillsStopped(caster_id);
-        owner->match_handler->GetMatchInfo().IncrementCancelledSkill(caster_id);
+        owner->match_handler->GetMatchInfo().Bump(caster_id, {AgentStat::SkillsStopped, AgentStat::CancelledSkills});
     }
-    logActionCompletion(caster_id, L"SKILL_STOPPED", GW::Packet::StoC::GenericValueID::skill_stopped, MARKER_SKILL_EVENT);
+    logActionCompletion(caster_id, CaptureEventKind::SkillStopped);
 }
 
 // ---- Attack Skill Handlers ----
@@ -418,28 +632,27 @@ void ObserverStoC::handleAttackSkillActivated(uint32_t caster_id, uint32_t targe
     // format: attack_skill_activated;skill_id;caster_id;target_id
     if (owner->match_handler) {
         uint32_t actual_caster_id = no_target ? caster_id : target_id;
-        owner->match_handler->GetMatchInfo().IncrementAttackSkillsActivated(actual_caster_id);
+        owner->match_handler->GetMatchInfo().Bump(actual_caster_id, AgentStat::AttackSkillsActivated);
     }
-    logActionActivation(caster_id, target_id, skill_id, no_target, L"ATTACK_SKILL_ACTIVATED", MARKER_ATTACK_SKILL_EVENT);
+    logActionActivation(caster_id, target_id, skill_id, no_target, CaptureEventKind::AttackSkillActivated);
 }
 
 void ObserverStoC::handleAttackSkillFinished(uint32_t caster_id) {
     if (!owner) return;
     // format: attack_skill_finished;caster_id;skill_id;target_id
     if (owner->match_handler) {
-        owner->match_handler->GetMatchInfo().IncrementAttackSkillsFinished(caster_id);
+        owner->match_handler->GetMatchInfo().Bump(caster_id, AgentStat::AttackSkillsFinished);
     }
-    logActionCompletion(caster_id, L"ATTACK_SKILL_FINISHED", GW::Packet::StoC::GenericValueID::attack_skill_finished, MARKER_ATTACK_SKILL_EVENT);
+    logActionCompletion(caster_id, CaptureEventKind::AttackSkillFinished);
 }
 
 void ObserverStoC::handleAttackSkillStopped(uint32_t caster_id) {
     if (!owner) return;
     // format: attack_skill_stopped;caster_id
     if (owner->match_handler) {
-        owner->match_handler->GetMatchInfo().IncrementAttackSkillsStopped(caster_id);
-        owner->match_handler->GetMatchInfo().IncrementCancelledSkill(caster_id);
+        owner->match_handler->GetMatchInfo().Bump(caster_id, {AgentStat::AttackSkillsStopped, AgentStat::CancelledSkills});
     }
-    logActionCompletion(caster_id, L"ATTACK_SKILL_STOPPED", GW::Packet::StoC::GenericValueID::attack_skill_stopped, MARKER_ATTACK_SKILL_EVENT);
+    logActionCompletion(caster_id, CaptureEventKind::AttackSkillStopped);
 }
 
 // ---- Instant Skill Handler ----
@@ -447,23 +660,20 @@ void ObserverStoC::handleInstantSkillActivated(uint32_t caster_id, uint32_t skil
     if (!owner || !owner->match_handler) return;
 
     // instant skills don't store state in agent_active_action. target is usually the caster.
-    wchar_t message_buffer[128];
     // format: instant_skill_used;skill_id;caster_id;target_id (target=caster)
-    swprintf(message_buffer, sizeof(message_buffer)/sizeof(wchar_t), L"INSTANT_SKILL_USED;%u;%u;%u", skill_id, caster_id, caster_id);
+    CaptureEvent event;
+    event.kind = CaptureEventKind::InstantSkillUsed;
+    event.caster_id = caster_id;
+    event.target_id = caster_id;
+    event.skill_id = skill_id;
 
     // add skills used to match info
     if (skill_id != 0) { // check skill_id validity
         owner->match_handler->GetMatchInfo().AddSkillUsed(caster_id, skill_id);
     }
 
-    std::wstring log_entry = MARKER_SKILL_EVENT;
-    log_entry += message_buffer;
-    owner->AddLogEntry(log_entry.c_str());
-
     // only display in chat if enabled
-    if (owner->stoc_status && owner->log_instant_skills) {
-        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, message_buffer);
-    }
+    emitEvent(event, IsChatLogged(*owner, event.kind));
 }
 
 // ---- Basic Attack Handlers ----
@@ -473,28 +683,27 @@ void ObserverStoC::handleAttackStarted(uint32_t caster_id, uint32_t target_id, b
     // use attack_started value_id as a placeholder skill_id to trigger basic attack storage
     if (owner->match_handler) {
         uint32_t actual_caster_id = no_target ? caster_id : target_id;
-        owner->match_handler->GetMatchInfo().IncrementAttacksStarted(actual_caster_id);
+        owner->match_handler->GetMatchInfo().Bump(actual_caster_id, AgentStat::AttacksStarted);
     }
-    logActionActivation(caster_id, target_id, static_cast<uint32_t>(GW::Packet::StoC::GenericValueID::attack_started), no_target, L"ATTACK_STARTED", MARKER_BASIC_ATTACK_EVENT);
+    logActionActivation(caster_id, target_id, static_cast<uint32_t>(GW::Packet::StoC::GenericValueID::attack_started), no_target, CaptureEventKind::AttackStarted);
 }
 
 void ObserverStoC::handleAttackFinished(uint32_t caster_id) {
     if (!owner) return;
     // format: attack_finished;caster_id;skill_id;target_id (skill_id will be 0)
     if (owner->match_handler) {
-        owner->match_handler->GetMatchInfo().IncrementAttacksFinished(caster_id);
+        owner->match_handler->GetMatchInfo().Bump(caster_id, AgentStat::AttacksFinished);
     }
-    logActionCompletion(caster_id, L"ATTACK_FINISHED", GW::Packet::StoC::GenericValueID::melee_attack_finished, MARKER_BASIC_ATTACK_EVENT);
+    logActionCompletion(caster_id, CaptureEventKind::AttackFinished);
 }
 
 void ObserverStoC::handleAttackStopped(uint32_t caster_id) {
     if (!owner) return;
     // format: attack_stopped;caster_id
     if (owner->match_handler) {
-        owner->match_handler->GetMatchInfo().IncrementAttacksStopped(caster_id);
-        owner->match_handler->GetMatchInfo().IncrementCancelledAttack(caster_id);
+        owner->match_handler->GetMatchInfo().Bump(caster_id, {AgentStat::AttacksStopped, AgentStat::CancelledAttacks});
     }
-    logActionCompletion(caster_id, L"ATTACK_STOPPED", GW::Packet::StoC::GenericValueID::attack_stopped, MARKER_BASIC_ATTACK_EVENT);
+    logActionCompletion(caster_id, CaptureEventKind::AttackStopped);
 }
 
 // ---- Combat Event Handlers ----
@@ -502,146 +711,139 @@ void ObserverStoC::handleInterrupted(uint32_t caster_id) {
     if (!owner) return;
     // format: interrupted;caster_id
     if (owner->match_handler) {
-        bool is_skill = false;
-        auto it = agent_active_action.find(caster_id);
-        if (it != agent_active_action.end() && it->second->skill_id != 0) {
-            is_skill = true;
+        const ActiveActionInfo* action_info = agent_active_action.Find(caster_id);
+        bool is_skill = action_info && action_info->skill_id != 0;
+        if (is_skill) {
+            owner->match_handler->GetMatchInfo().Bump(caster_id, {AgentStat::Interrupted, AgentStat::InterruptedSkills});
+        } else {
+            owner->match_handler->GetMatchInfo().Bump(caster_id, AgentStat::Interrupted);
         }
-        owner->match_handler->GetMatchInfo().IncrementInterrupted(caster_id, is_skill);
     }
-    logActionCompletion(caster_id, L"INTERRUPTED", GW::Packet::StoC::GenericValueID::interrupted, MARKER_COMBAT_EVENT);
+    logActionCompletion(caster_id, CaptureEventKind::Interrupted);
 }
 
-void ObserverStoC::handleDamage(uint32_t caster_id, uint32_t target_id, float value, uint32_t damage_type) {
+void ObserverStoC::handleDamage(uint32_t caster_id, uint32_t target_id, float value, uint32_t damage_type, const StoCPacketRecord& record) {
     if (!owner) return;
 
     // map gwca damage type id to a simple integer if needed, or just log the raw id.
     // using raw id for simplicity: 1=normal, 2=crit, 3=armorignoring
-    handleDamagePacket(caster_id, target_id, value, damage_type);
+    handleDamagePacket(caster_id, target_id, value, damage_type, record);
 
     if (owner->match_handler && value < 0) {
-        GW::Agent* target = GW::Agents::GetAgentByID(target_id);
-        GW::Agent* caster = GW::Agents::GetAgentByID(caster_id);
+        // agents were snapshotted by the hook
+        const StoCAgentSnapshot& target_living = record.target;
+        const StoCAgentSnapshot& caster_living = record.caster;
         
-        if (target && caster && target->GetIsLivingType() && caster->GetIsLivingType()) {
-            GW::AgentLiving* target_living = target->GetAsAgentLiving();
-            GW::AgentLiving* caster_living = caster->GetAsAgentLiving();
-            
-            if (target_living && caster_living) {
-                uint32_t target_max_hp = target_living->max_hp > 0 ? target_living->max_hp : 1680;
+        {
+            if (target_living.is_living && caster_living.is_living) {
+                uint32_t target_max_hp = target_living.max_hp > 0 ? target_living.max_hp : 1680;
                 long actual_damage = static_cast<long>(std::round(-value * target_max_hp));
                 
                 MatchInfo& match_info = owner->match_handler->GetMatchInfo();
-                const auto agents = match_info.GetAgentsInfoCopy();
-                auto caster_it = agents.find(caster_id);
-                auto target_it = agents.find(target_id);
+                const auto roster = match_info.GetRoster();
+                const bool caster_known = roster->Contains(caster_id);
+                const bool target_known = roster->Contains(target_id);
                 
-                if (caster_it != agents.end()) {
-                    match_info.AddPlayerDamage(caster_id, actual_damage);
+                if (caster_known) {
+                    match_info.Bump(caster_id, AgentStat::TotalDamage, actual_damage);
                     
-                    uint32_t caster_team_id = caster_living->team_id;
+                    uint32_t caster_team_id = caster_living.team_id;
                     if (caster_team_id == 1 || caster_team_id == 2) {
                         match_info.AddTeamDamage(caster_team_id, actual_damage);
                     }
                     
-                    if (target_it != agents.end()) {
+                    if (target_known) {
                         agent_last_hit_by[target_id] = caster_id;
                     }
                 }
                 
                 if (damage_type == GW::Packet::StoC::GenericValueID::critical) {
-                    if (caster_it != agents.end()) {
-                        match_info.IncrementCritsDealt(caster_id);
+                    if (caster_known) {
+                        match_info.Bump(caster_id, AgentStat::CritsDealt);
                     }
-                    if (target_it != agents.end()) {
-                        match_info.IncrementCritsReceived(target_id);
+                    if (target_known) {
+                        match_info.Bump(target_id, AgentStat::CritsReceived);
                     }
                 }
             }
         }
     }
 
-    wchar_t message_buffer[128];
     // format: damage;caster_id;target_id;value;damage_type_id
-    swprintf(message_buffer, 128, L"DAMAGE;%u;%u;%f;%u", caster_id, target_id, value, damage_type);
-
-    std::wstring log_entry = MARKER_COMBAT_EVENT;
-    log_entry += message_buffer;
-    owner->AddLogEntry(log_entry.c_str());
+    CaptureEvent event;
+    event.kind = CaptureEventKind::Damage;
+    event.caster_id = caster_id;
+    event.target_id = target_id;
+    event.value = value;
+    event.aux = static_cast<uint16_t>(damage_type);
 
     // write to chat only if enabled
-    if (owner->stoc_status && owner->log_damage) {
-        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, message_buffer);
-    }
+    emitEvent(event, IsChatLogged(*owner, event.kind));
 }
 
 void ObserverStoC::handleLordDamage(uint32_t caster_id, uint32_t target_id, float value, uint32_t damage_type, uint32_t attacking_team, long damage, long damage_before, long damage_after) {
     if (!owner) return;
 
-    wchar_t message_buffer[256];
-    swprintf(message_buffer, 256, L"LORD_DAMAGE;%u;%u;%f;%u;%u;%ld;%ld;%ld", caster_id, target_id, value, damage_type, attacking_team, damage, damage_before, damage_after);
-
-    std::wstring log_entry = MARKER_LORD_EVENT;
-    log_entry += message_buffer;
-    owner->AddLogEntry(log_entry.c_str());
-
-    if (owner->stoc_status && owner->log_lord_damage) {
-        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, message_buffer);
-    }
+    // format: lord_damage;caster_id;target_id;value;damage_type;attacking_team;damage;damage_before;damage_after
+    // the team totals don't fit the record, they follow in a LordDamageTotals continuation
+    CaptureEvent event;
+    event.kind = CaptureEventKind::LordDamage;
+    event.caster_id = caster_id;
+    event.target_id = target_id;
+    event.value = value;
+    event.aux = static_cast<uint16_t>(damage_type);
+    event.team_id = static_cast<uint8_t>(attacking_team);
+    event.skill_id = static_cast<uint32_t>(static_cast<int32_t>(damage));
+
+    CaptureEvent totals;
+    totals.kind = CaptureEventKind::LordDamageTotals;
+    totals.team_id = event.team_id;
+    totals.caster_id = static_cast<uint32_t>(static_cast<int32_t>(damage_before));
+    totals.target_id = static_cast<uint32_t>(static_cast<int32_t>(damage_after));
+
+    emitEvent(event, IsChatLogged(*owner, event.kind), &totals);
 }
 
 void ObserverStoC::handleKnockdown(uint32_t cause_id, uint32_t target_id) {
     if (!owner) return;
 
-    wchar_t message_buffer[128];
-
     // format: knocked_down;target_id;cause_id
     // note: cause_id might not always be the direct cause, but it's the agent id associated with the packet.
-    swprintf(message_buffer, sizeof(message_buffer)/sizeof(wchar_t), L"KNOCKED_DOWN;%u;%u", target_id, cause_id);
-
-    std::wstring log_entry = MARKER_COMBAT_EVENT;
-    log_entry += message_buffer;
-    owner->AddLogEntry(log_entry.c_str());
+    CaptureEvent event;
+    event.kind = CaptureEventKind::KnockedDown;
+    event.caster_id = cause_id;
+    event.target_id = target_id;
 
     // write to chat only if enabled
-    if (owner->stoc_status && owner->log_knockdowns) {
-        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, message_buffer);
-    }
+    emitEvent(event, IsChatLogged(*owner, event.kind));
 }
 
 // ---- Agent Event Handlers ----
 void ObserverStoC::handleAgentMovement(uint32_t agent_id, float x, float y, uint16_t plane) {
     if (!owner) return;
 
-    wchar_t message_buffer[128];
     // format: game_smsg_agent_move_to_point;agent_id;x;y;plane
-    swprintf(message_buffer, sizeof(message_buffer)/sizeof(wchar_t), L"GAME_SMSG_AGENT_MOVE_TO_POINT;%u;%.2f;%.2f;%u", agent_id, x, y, plane);
-
-    std::wstring log_entry = MARKER_AGENT_EVENT;
-    log_entry += message_buffer;
-    owner->AddLogEntry(log_entry.c_str());
+    CaptureEvent event;
+    event.kind = CaptureEventKind::AgentMoveToPoint;
+    event.caster_id = agent_id;
+    event.value = x;
+    std::memcpy(&event.skill_id, &y, sizeof(y)); // y is kept as raw float bits
+    event.aux = plane;
 
     // write to chat only if enabled
-    if (owner->stoc_status && owner->log_movement) {
-        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, message_buffer);
-    }
+    emitEvent(event, IsChatLogged(*owner, event.kind));
 }
 
 // ---- Jumbo Message Handler ----
-void ObserverStoC::handleJumboMessage(const GW::Packet::StoC::JumboMessage* packet) {
+void ObserverStoC::handleJumboMessage(uint32_t type, uint32_t value) {
     if (!owner || !owner->match_handler) return; 
 
-    wchar_t message_buffer[128]; // for the visible message part
-    wchar_t log_buffer[192]; // larger buffer for marker + message
     bool should_log_to_chat = false; // flag to determine if this specific type should be logged to chat
 
-    // format: game_smsg_jumbo_message;type;value
-    swprintf(message_buffer, sizeof(message_buffer)/sizeof(wchar_t), L"GAME_SMSG_JUMBO_MESSAGE;%u;%u", packet->type, packet->value);
-
     bool is_victory_message = false;
 
     // check corresponding log flag for chat output
-    switch (packet->type) {
+    switch (type) {
         case GW::Packet::StoC::JumboMessageType::BASE_UNDER_ATTACK:           should_log_to_chat = owner->log_jumbo_base_under_attack; break;
         case GW::Packet::StoC::JumboMessageType::GUILD_LORD_UNDER_ATTACK:     should_log_to_chat = owner->log_jumbo_guild_lord_under_attack; break;
         case GW::Packet::StoC::JumboMessageType::CAPTURED_SHRINE:             should_log_to_chat = owner->log_jumbo_captured_shrine; break;
@@ -661,24 +863,28 @@ void ObserverStoC::handleJumboMessage(const GW::Packet::StoC::JumboMessage* pack
 
     // capture match end info if it's a victory message
     if (is_victory_message) {
-        uint32_t winner_id = packet->value; // value indicates the winning party (raw ID)
+        uint32_t winner_id = value; // value indicates the winning party (raw ID)
+        uint32_t end_time_ms = current_time_ms_;
 
-        owner->HandleMatchEndSignal(winner_id);
+        // match end stops the loop and may export, keep it on the game thread
+        ObserverPlugin* plugin = owner;
+        GW::GameThread::Enqueue([plugin, winner_id, end_time_ms]() {
+            plugin->HandleMatchEndSignal(winner_id, end_time_ms);
+        });
     }
 
-    // prepend marker and add to internal log
-    // use the helper function defined at the top of the file
-    swprintf(log_buffer, sizeof(log_buffer)/sizeof(wchar_t), L"%ls%ls (%ls)", MARKER_JUMBO_EVENT, message_buffer, JumboValueToPartyStr(packet->value)); // example usage if needed
-    owner->AddLogEntry(log_buffer); // log the raw message as before
+    // format: game_smsg_jumbo_message;type;value (party)
+    CaptureEvent event;
+    event.kind = CaptureEventKind::JumboMessage;
+    event.aux = static_cast<uint16_t>(type);
+    event.target_id = value;
 
     // write to chat only if enabled and the specific type is toggled on
-    if (owner->stoc_status && should_log_to_chat) {
-        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, message_buffer);
-    }
+    emitEvent(event, owner->stoc_status && should_log_to_chat);
 }
 
-void ObserverStoC::handleDamagePacket(uint32_t caster_id, uint32_t target_id, float value, uint32_t damage_type) {
-    if (!GW::Map::GetIsObserving()) {
+void ObserverStoC::handleDamagePacket(uint32_t caster_id, uint32_t target_id, float value, uint32_t damage_type, const StoCPacketRecord& record) {
+    if (!record.is_observing) {
         return;
     }
 
@@ -691,19 +897,17 @@ void ObserverStoC::handleDamagePacket(uint32_t caster_id, uint32_t target_id, fl
             return;
     }
 
-    GW::Agent* target = GW::Agents::GetAgentByID(target_id);
-    GW::Agent* cause = GW::Agents::GetAgentByID(caster_id);
-    if (target && cause) {
-        GW::AgentLiving* target_living = target->GetAsAgentLiving();
-        GW::AgentLiving* cause_living = cause->GetAsAgentLiving();
-        if (target_living && cause_living && value < 0) {
-            if (!(target_living->player_number == 170 || target_living->player_number == 170) ||
-                !(target_living->team_id == 1 || target_living->team_id == 2)) {
+    const StoCAgentSnapshot& target_living = record.target;
+    const StoCAgentSnapshot& cause_living = record.caster;
+    {
+        if (target_living.is_living && cause_living.is_living && value < 0) {
+            if (!target_living.IsGuildLord() ||
+                !(target_living.team_id == 1 || target_living.team_id == 2)) {
                 return;
             }
 
-            uint32_t attacking_team = target_living->team_id == 1 ? 2 : 1;
-            long damage = static_cast<long>(std::round(-value * (target_living->max_hp > 0 ? target_living->max_hp : 1680)));
+            uint32_t attacking_team = target_living.team_id == 1 ? 2 : 1;
+            long damage = static_cast<long>(std::round(-value * (target_living.max_hp > 0 ? target_living.max_hp : 1680)));
             long damage_before = ObserverMatchData::GetTeamLordDamage(attacking_team);
             ObserverMatchData::AddTeamLordDamage(attacking_team, damage);
             long damage_after = ObserverMatchData::GetTeamLordDamage(attacking_team);
@@ -712,34 +916,31 @@ void ObserverStoC::handleDamagePacket(uint32_t caster_id, uint32_t target_id, fl
     }
 }
 
-void ObserverStoC::handleValueTargetPacket(GW::Packet::StoC::GenericValueTarget* packet) {
-    if (!GW::Map::GetIsObserving()) {
+void ObserverStoC::handleValueTargetPacket(uint32_t skill_id, const StoCPacketRecord& record) {
+    if (!record.is_observing || !owner || !owner->match_handler) {
         return;
     }
 
-    GW::Agent* target = GW::Agents::GetAgentByID(packet->caster);
-    if (target) {
-        GW::AgentLiving* target_living = target->GetAsAgentLiving();
-        if (target_living &&
-            (target_living->player_number == 170 || target_living->player_number == 170) &&
-            (target_living->team_id == 1 || target_living->team_id == 2)) {
+    const StoCAgentSnapshot& target_living = record.caster; // packet caster is the agent receiving the skill
+    {
+        if (target_living.is_living &&
+            target_living.IsGuildLord() &&
+            (target_living.team_id == 1 || target_living.team_id == 2)) {
             
-            GW::Constants::SkillID skill = static_cast<GW::Constants::SkillID>(packet->value);
-            GW::Skill* skill_data = GW::SkillbarMgr::GetSkillConstantData(skill);
-            if (skill_data && (skill_data->type == GW::Constants::SkillType::Enchantment || 
-                              skill_data->type == GW::Constants::SkillType::WeaponSpell)) {
-                uint32_t team_id = target_living->team_id;
+            const SkillMeta* skill = owner->match_handler->GetMatchInfo().GetSkillTable()->Find(skill_id);
+            if (skill && (skill->type == static_cast<uint32_t>(GW::Constants::SkillType::Enchantment) ||
+                          skill->type == static_cast<uint32_t>(GW::Constants::SkillType::WeaponSpell))) {
+                uint32_t team_id = target_living.team_id;
                 ObserverMatchData::AddTeamLordDamage(team_id, -50L);
             }
         }
     }
 }
 
-void ObserverStoC::handleAgentState(const GW::Packet::StoC::AgentState* packet) {
+void ObserverStoC::handleAgentState(uint32_t agent_id, uint32_t state) {
     if (!owner) return;
     
-    uint32_t agent_id = packet->agent_id;
-    uint32_t current_state = packet->state;
+    uint32_t current_state = state;
     
     bool is_currently_dead = (current_state & 16) != 0;
     
@@ -755,33 +956,27 @@ void ObserverStoC::handleAgentState(const GW::Packet::StoC::AgentState* packet)
     
     agent_previous_states[agent_id] = current_state;
     
-    wchar_t message_buffer[128];
-    swprintf(message_buffer, sizeof(message_buffer)/sizeof(wchar_t), L"AGENT_STATE_UPDATE;%u;%u", packet->agent_id, packet->state);
-    
-    std::wstring log_entry = MARKER_AGENT_STATE_EVENT;
-    log_entry += message_buffer;
-    owner->AddLogEntry(log_entry.c_str());
+    CaptureEvent event;
+    event.kind = CaptureEventKind::AgentStateUpdate;
+    event.caster_id = agent_id;
+    event.target_id = state;
     
-    if (owner->stoc_status && owner->log_agent_state_updates) {
-        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, message_buffer);
-    }
+    emitEvent(event, IsChatLogged(*owner, event.kind));
 }
 
 void ObserverStoC::handleDeathResurrection(uint32_t agent_id, bool is_dead) {
     if (!owner || !owner->match_handler) return;
     
     const MatchInfo& match_info = owner->match_handler->GetMatchInfo();
-    const auto agents = match_info.GetAgentsInfoCopy();
+    const auto roster = match_info.GetRoster();
     
-    auto it = agents.find(agent_id);
-    if (it != agents.end()) {
-        const AgentInfo& agent = it->second;
-        const wchar_t* agent_name = ObserverUtils::DecodeAgentName(agent.encoded_name);
+    if (const RosterAgent* found = roster->Find(agent_id)) {
+        const RosterAgent& agent = *found;
         const wchar_t* status_text = is_dead ? L"is dead" : L"is alive";
         const wchar_t* team_suffix = (agent.team_id == 1) ? L" (B)" : (agent.team_id == 2) ? L" (R)" : L" (?)";
 
         if (is_dead) {
-            owner->match_handler->GetMatchInfo().IncrementDeaths(agent_id);
+            owner->match_handler->GetMatchInfo().Bump(agent_id, AgentStat::Deaths);
             if (agent.type == AgentType::PLAYER) {
                 if (agent.team_id == 1) {
                     ObserverMatchData::AddTeamKill(2);
@@ -792,25 +987,40 @@ void ObserverStoC::handleDeathResurrection(uint32_t agent_id, bool is_dead) {
                 auto last_hit_it = agent_last_hit_by.find(agent_id);
                 if (last_hit_it != agent_last_hit_by.end()) {
                     uint32_t killer_id = last_hit_it->second;
-                    auto killer_it = agents.find(killer_id);
-                    if (killer_it != agents.end()) {
-                        owner->match_handler->GetMatchInfo().IncrementKills(killer_id);
+                    if (roster->Contains(killer_id)) {
+                        owner->match_handler->GetMatchInfo().Bump(killer_id, AgentStat::Kills);
                     }
                 }
             }
         }
         
+        // store the id-based message now, the name is decoded on the game thread and patched in
         wchar_t message_buffer[256];
-        if (agent_name && agent_name[0] != L'\0' && wcscmp(agent_name, L"<Decoding...>") != 0) {
-            swprintf(message_buffer, sizeof(message_buffer)/sizeof(wchar_t), L"%ls %ls%ls", agent_name, status_text, team_suffix);
-        } else {
-            swprintf(message_buffer, sizeof(message_buffer)/sizeof(wchar_t), L"Agent %u %ls%ls", agent_id, status_text, team_suffix);
+        swprintf(message_buffer, sizeof(message_buffer)/sizeof(wchar_t), L"Agent %u %ls%ls", agent_id, status_text, team_suffix);
+
+        // the decoded name is variable length, keep it in the capture text pool
+        CaptureEvent event;
+        event.kind = CaptureEventKind::DeathResurrection;
+        event.caster_id = agent_id;
+        event.aux = is_dead ? 1 : 0;
+        {
+            // every death keeps its own message and name patch, those allocations are expected
+            UncountedAllocations uncounted;
+            const CaptureTextRef text_ref = owner->AddEventText(message_buffer);
+            event.skill_id = text_ref.index;
+
+            // the patch is dropped if the capture was cleared or retired before the name was decoded
+            ObserverPlugin* plugin = owner;
+            GW::GameThread::Enqueue([plugin, text_ref, encoded_name = agent.encoded_name, status_text, team_suffix]() {
+                const wchar_t* agent_name = ObserverUtils::DecodeAgentName(encoded_name);
+                if (agent_name && agent_name[0] != L'\0' && wcscmp(agent_name, L"<Decoding...>") != 0) {
+                    wchar_t named_buffer[256];
+                    swprintf(named_buffer, sizeof(named_buffer)/sizeof(wchar_t), L"%ls %ls%ls", agent_name, status_text, team_suffix);
+                    plugin->SetEventText(text_ref, named_buffer);
+                }
+            });
         }
-        
-        std::wstring log_entry = MARKER_AGENT_STATE_EVENT;
-        log_entry += L"DEATH_RESURRECTION;";
-        log_entry += message_buffer;
-        owner->AddLogEntry(log_entry.c_str());
+        emitEvent(event, false);
     }
 }
 
@@ -3,34 +3,100 @@
 #include <GWCA/Utilities/Hook.h>
 #include <GWCA/Packets/StoC.h>
 #include "ObserverPackets.h"
+#include "ObserverEvents.h"
+#include "ObserverRing.h"
+#include "ObserverAgentCache.h"
+#include "ObserverAllocations.h"
+#include <algorithm>
 #include <cstdint>
 #include <unordered_map>
+#include <vector>
 #include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
 
 class ObserverPlugin;
 
-extern const wchar_t* MARKER_SKILL_EVENT;
-extern const size_t MARKER_SKILL_EVENT_LEN;
-extern const wchar_t* MARKER_ATTACK_SKILL_EVENT;
-extern const size_t MARKER_ATTACK_SKILL_EVENT_LEN;
-extern const wchar_t* MARKER_BASIC_ATTACK_EVENT;
-extern const size_t MARKER_BASIC_ATTACK_EVENT_LEN;
-extern const wchar_t* MARKER_COMBAT_EVENT;
-extern const size_t MARKER_COMBAT_EVENT_LEN;
-extern const wchar_t* MARKER_AGENT_EVENT;
-extern const size_t MARKER_AGENT_EVENT_LEN;
-extern const wchar_t* MARKER_JUMBO_EVENT;
-extern const size_t MARKER_JUMBO_EVENT_LEN;
-extern const wchar_t* MARKER_LORD_EVENT;
-extern const size_t MARKER_LORD_EVENT_LEN;
-extern const wchar_t* MARKER_AGENT_STATE_EVENT;
-extern const size_t MARKER_AGENT_STATE_EVENT_LEN;
-
 // struct to store active action details (skill and target)
 // similar concept to ObserverModule::TargetAction but simplified for logging needs
 struct ActiveActionInfo {
     uint32_t skill_id = 0;
     uint32_t target_id = 0;
+    uint32_t started_ms = 0; // instance time of the activation
+    bool active = false;
+};
+
+// active action of each agent, kept by value in a flat table indexed by agent id.
+// agent ids of an instance are small and dense, so a lookup is an array index and the table only
+// allocates when an id past its end shows up. ids past kMaxAgentId are not tracked.
+class ActiveActionTable {
+public:
+    static constexpr uint32_t kInitialAgents = 4096;
+    static constexpr uint32_t kMaxAgentId = 65535;
+
+    ActiveActionTable() : slots_(kInitialAgents) {}
+
+    // nullptr if the agent has no action in progress
+    const ActiveActionInfo* Find(uint32_t agent_id) const {
+        if (agent_id >= slots_.size() || !slots_[agent_id].active) return nullptr;
+        return &slots_[agent_id];
+    }
+
+    // replaces whatever the agent was doing
+    void Start(uint32_t agent_id, uint32_t skill_id, uint32_t target_id, uint32_t time_ms) {
+        if (agent_id > kMaxAgentId) return;
+        if (agent_id >= slots_.size()) {
+            slots_.resize(std::min<size_t>(std::max<size_t>(slots_.size() * 2, agent_id + 1), kMaxAgentId + 1));
+        }
+        slots_[agent_id] = ActiveActionInfo{skill_id, target_id, time_ms, true};
+    }
+
+    void Release(uint32_t agent_id) {
+        if (agent_id < slots_.size()) slots_[agent_id].active = false;
+    }
+
+    void Clear() { std::fill(slots_.begin(), slots_.end(), ActiveActionInfo{}); } // keeps the table's size
+
+private:
+    std::vector<ActiveActionInfo> slots_;
+};
+
+enum class StoCPacketType : uint8_t {
+    GenericValueTarget,
+    GenericValue,
+    GenericModifier,
+    GenericFloat,
+    AgentMovement,
+    JumboMessage,
+    AgentState
+};
+
+// compact copy of a hooked packet, pushed by the game thread and handled by the consumer thread
+struct StoCPacketRecord {
+    uint32_t time_ms = 0;        // instance time when the packet was received
+    StoCPacketType type = StoCPacketType::GenericValue;
+    uint8_t is_observing = 0;
+    uint16_t plane = 0;          // AgentMovement only
+    uint32_t value_id = 0;       // generic value id, jumbo type or agent state
+    uint32_t caster_id = 0;
+    uint32_t target_id = 0;
+    uint32_t value = 0;          // raw value bits (float for GenericModifier, GenericFloat and movement x)
+    float y = 0.0f;              // AgentMovement only
+    StoCAgentSnapshot caster;    // packet caster (or cause) as seen by the hook
+    StoCAgentSnapshot target;    // packet target as seen by the hook
+};
+
+struct StoCQueueStats {
+    uint64_t pushed = 0;          // packets queued for the consumer thread
+    uint64_t dropped = 0;         // packets lost because the ring was full
+    size_t queued = 0;            // packets currently waiting in the ring
+    size_t capacity = 0;
+    double hook_ns_per_packet = 0.0; // average time spent inside the game thread hooks
+    double allocations_per_packet = 0.0; // heap allocations while handling a packet, builds with OBSERVER_COUNT_ALLOCATIONS only
+    uint64_t steady_state_failures = 0;  // replayed packets that allocated, builds with OBSERVER_COUNT_ALLOCATIONS only
+    uint32_t failed_packet_type = 0;     // StoCPacketType of the last one
+    uint32_t failed_value_id = 0;
 };
 
 // handles server-to-client (StoC) packet callbacks for the observer plugin
@@ -42,10 +108,41 @@ public:
     void RegisterCallbacks();
     void RemoveCallbacks();
 
+    StoCQueueStats GetQueueStats() const;
+    void ResetQueueStats();
+
+    // debug: handle packets directly inside the hooks (previous behaviour) to compare hook cost
+    void SetInlineProcessing(bool enabled) { inline_processing_ = enabled; }
+    bool IsInlineProcessing() const { return inline_processing_.load(); }
+
 private:
+    static constexpr size_t kPacketRingCapacity = 16384;
+
     ObserverPlugin* owner; // pointer back to the main plugin instance
+
+    // hook -> consumer queue
+    SpscRing<StoCPacketRecord, kPacketRingCapacity> packet_ring_;
+    std::thread consumer_thread_;
+    std::atomic<bool> run_consumer_{false};
+    std::atomic<bool> inline_processing_{false};
+    std::mutex process_mutex_;          // serializes the consumer with inline processing
+    uint32_t current_time_ms_ = 0;      // time of the record being processed
+
+    // written by the game thread only, read by the status window
+    std::atomic<uint64_t> packets_pushed_{0};
+    std::atomic<uint64_t> packets_dropped_{0};
+    std::atomic<uint64_t> hook_packets_{0};
+    std::atomic<uint64_t> hook_ticks_{0};
+    // written by whichever thread handles packets, only with OBSERVER_COUNT_ALLOCATIONS
+    std::atomic<uint64_t> handled_packets_{0};
+    std::atomic<uint64_t> handled_allocations_{0};
+    // steady-state check: a packet identical to one handled before must not allocate
+    SeenKeySet handled_keys_; // only touched by whichever thread handles packets
+    std::atomic<uint64_t> steady_state_failures_{0};
+    std::atomic<uint32_t> failed_packet_type_{0};
+    std::atomic<uint32_t> failed_value_id_{0};
     
-    std::unordered_map<uint32_t, ActiveActionInfo*> agent_active_action;
+    ActiveActionTable agent_active_action;
     std::unordered_map<uint32_t, uint32_t> agent_previous_states;
     std::unordered_map<uint32_t, uint32_t> agent_last_hit_by;
     
@@ -61,7 +158,7 @@ private:
     
     // common handlers dispatch generic packet data based on value_id
     void handleGenericPacket(uint32_t value_id, uint32_t caster_id, uint32_t target_id, uint32_t value, bool no_target);
-    void handleGenericPacket(uint32_t value_id, uint32_t caster_id, uint32_t target_id, float value, bool no_target);
+    void handleGenericPacket(uint32_t value_id, uint32_t caster_id, uint32_t target_id, float value, const StoCPacketRecord& record);
     
     // specific handlers for different game events derived from generic packets
     void handleSkillActivated(uint32_t caster_id, uint32_t target_id, uint32_t skill_id, bool no_target);
@@ -75,22 +172,35 @@ private:
     void handleAttackStarted(uint32_t caster_id, uint32_t target_id, bool no_target);
     void handleAttackStopped(uint32_t caster_id);
     void handleAttackFinished(uint32_t caster_id);
-    void handleDamage(uint32_t caster_id, uint32_t target_id, float value, uint32_t damage_type);
+    void handleDamage(uint32_t caster_id, uint32_t target_id, float value, uint32_t damage_type, const StoCPacketRecord& record);
     void handleLordDamage(uint32_t caster_id, uint32_t target_id, float value, uint32_t damage_type, uint32_t attacking_team, long damage, long damage_before, long damage_after);
     void handleKnockdown(uint32_t cause_id, uint32_t target_id);
     void handleAgentMovement(uint32_t agent_id, float x, float y, uint16_t plane);
-    void handleJumboMessage(const GW::Packet::StoC::JumboMessage* packet);
-    void handleDamagePacket(uint32_t caster_id, uint32_t target_id, float value, uint32_t damage_type);
-    void handleValueTargetPacket(GW::Packet::StoC::GenericValueTarget* packet);
-    void handleAgentState(const GW::Packet::StoC::AgentState* packet);
+    void handleJumboMessage(uint32_t type, uint32_t value);
+    void handleDamagePacket(uint32_t caster_id, uint32_t target_id, float value, uint32_t damage_type, const StoCPacketRecord& record);
+    void handleValueTargetPacket(uint32_t skill_id, const StoCPacketRecord& record);
+    void handleAgentState(uint32_t agent_id, uint32_t state);
     void handleDeathResurrection(uint32_t agent_id, bool is_dead);
 
     // private helper functions for logging and cleanup
     void logActionActivation(uint32_t caster_id, uint32_t target_id, uint32_t skill_id,
-                             bool no_target, const wchar_t* action_desc_format,
-                             const wchar_t* category_marker);
-    void logActionCompletion(uint32_t caster_id, const wchar_t* action_identifier, 
-                             uint32_t value_id, 
-                             const wchar_t* category_marker);
+                             bool no_target, CaptureEventKind kind);
+    void logActionCompletion(uint32_t caster_id, CaptureEventKind kind);
+    // stamps the event with the instance time, stores it and echoes it to chat if requested.
+    // a continuation record is stored right behind it, in the same append
+    void emitEvent(CaptureEvent& event, bool show_in_chat, CaptureEvent* continuation = nullptr);
     void cleanupAgentActions(); 
+
+    // hook side: snapshot agents and hand the record to the consumer
+    void snapshotAgent(uint32_t agent_id, StoCAgentSnapshot& out) const;
+    void pushRecord(StoCPacketRecord& record, int64_t hook_start);
+
+    // consumer side
+    void startConsumer();
+    void stopConsumer();
+    void runConsumer();
+    bool drainRing();
+    bool drainRingLocked(); // process_mutex_ held
+    void processRecordCounted(const StoCPacketRecord& record); // processRecord, counting its allocations when enabled
+    void processRecord(const StoCPacketRecord& record);
 };
\ No newline at end of file
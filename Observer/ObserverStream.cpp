@@ -0,0 +1,95 @@
+#include "ObserverStream.h"
+#include "ObserverCompression.h"
+#include "ObserverExport.h"
+
+#include <GWCA/Managers/ChatMgr.h>
+
+#include <stdexcept>
+
+namespace {
+    // removes the .txt.gz and .traj files a previous capture left in a directory
+    void RemoveStaleCaptureFiles(const std::filesystem::path& dir) {
+        if (!std::filesystem::exists(dir)) return;
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            if (!entry.is_regular_file()) continue;
+            const std::wstring name = entry.path().filename().wstring();
+            if ((name.size() > 7 && name.compare(name.size() - 7, 7, L".txt.gz") == 0) ||
+                (name.size() > 5 && name.compare(name.size() - 5, 5, L".traj") == 0)) {
+                std::filesystem::remove(entry.path());
+            }
+        }
+    }
+}
+
+bool ObserverStream::Begin(const wchar_t* folder_name) {
+    std::lock_guard<std::mutex> lock(stream_mutex_);
+    try {
+        std::filesystem::path match_dir = std::filesystem::path("captures") / folder_name;
+
+        // streamed chunks are appended, so anything from an earlier capture with the same name must go
+        RemoveStaleCaptureFiles(match_dir / "StoC");
+        RemoveStaleCaptureFiles(match_dir / "Agents");
+        std::filesystem::create_directories(match_dir / "StoC");
+        std::filesystem::create_directories(match_dir / "Agents");
+
+        folder_ = match_dir;
+        bytes_written_ = 0;
+        chunks_written_ = 0;
+        active_ = true;
+
+        std::wstring msg = L"Streaming capture to folder: ";
+        msg += std::filesystem::absolute(match_dir).wstring();
+        GW::Chat::WriteChat(GW::Chat::CHANNEL_MODERATOR, msg.c_str());
+        return true;
+    } catch (const std::exception& e) {
+        WriteExportError("Could not start capture streaming: ", e.what());
+        active_ = false;
+        return false;
+    }
+}
+
+void ObserverStream::End() {
+    std::lock_guard<std::mutex> lock(stream_mutex_);
+    active_ = false;
+}
+
+void ObserverStream::Append(const std::filesystem::path& relative_path, const std::vector<unsigned char>& compressed) {
+    if (compressed.empty()) return;
+
+    std::lock_guard<std::mutex> lock(stream_mutex_);
+    if (!active_.load()) {
+        throw std::runtime_error("Capture stream is not active.");
+    }
+    AppendCompressedFile(folder_ / relative_path, compressed);
+    bytes_written_ += compressed.size();
+    chunks_written_ += 1;
+}
+
+void ObserverStream::Relocate(const wchar_t* folder_name) {
+    std::lock_guard<std::mutex> lock(stream_mutex_);
+    std::filesystem::path target_dir = std::filesystem::path("captures") / folder_name;
+    if (!active_.load() || target_dir == folder_) return;
+
+    // move every streamed file, replacing older files of the target capture
+    if (std::filesystem::exists(folder_)) {
+        std::vector<std::filesystem::path> streamed_files;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(folder_)) {
+            if (entry.is_regular_file()) streamed_files.push_back(entry.path());
+        }
+        for (const auto& file : streamed_files) {
+            std::filesystem::path target_file = target_dir / std::filesystem::relative(file, folder_);
+            std::filesystem::create_directories(target_file.parent_path());
+            std::filesystem::remove(target_file);
+            std::filesystem::rename(file, target_file);
+        }
+        std::filesystem::remove_all(folder_);
+    }
+    std::filesystem::create_directories(target_dir / "StoC");
+    std::filesystem::create_directories(target_dir / "Agents");
+    folder_ = target_dir;
+}
+
+std::filesystem::path ObserverStream::GetFolder() const {
+    std::lock_guard<std::mutex> lock(stream_mutex_);
+    return folder_;
+}
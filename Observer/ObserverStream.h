@@ -0,0 +1,40 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// streaming capture target of one match, shared by ObserverCapture and ObserverLoop.
+// sealed chunks are appended as gzip members to the files of captures/<name>/ during the match.
+// queuing the export detaches the stream with the events still in memory, so the export worker
+// appends that tail to the same files while the next match streams into a new one.
+class ObserverStream {
+public:
+    ObserverStream() = default;
+    ~ObserverStream() = default;
+
+    // starts streaming into captures/<folder_name>/, removing stale capture files left there
+    bool Begin(const wchar_t* folder_name);
+    void End();
+    bool IsActive() const { return active_.load(); }
+
+    // appends a compressed chunk to <stream folder>/<relative_path>, throws on write errors
+    void Append(const std::filesystem::path& relative_path, const std::vector<unsigned char>& compressed);
+
+    // moves the streamed files to captures/<folder_name>/ if the match was renamed, throws on errors
+    void Relocate(const wchar_t* folder_name);
+
+    std::filesystem::path GetFolder() const;
+    uint64_t GetBytesWritten() const { return bytes_written_.load(); }
+    uint64_t GetChunksWritten() const { return chunks_written_.load(); }
+
+private:
+    mutable std::mutex stream_mutex_;   // serializes appends with relocation
+    std::filesystem::path folder_;       // captures/<name>
+    std::atomic<bool> active_{false};
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<uint64_t> chunks_written_{0};
+};
@@ -0,0 +1,123 @@
+#include "ObserverTimeline.h"
+#include "ObserverArchive.h"
+#include "ObserverCompression.h"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+    // parses the digits at text[position] up to a non digit, false if there are none
+    bool ParseNumber(std::string_view text, size_t& position, uint32_t& value) {
+        const size_t start = position;
+        value = 0;
+        while (position < text.size() && text[position] >= '0' && text[position] <= '9') {
+            value = value * 10 + static_cast<uint32_t>(text[position] - '0');
+            ++position;
+        }
+        return position > start;
+    }
+
+    bool Expect(std::string_view text, size_t& position, char c) {
+        if (position >= text.size() || text[position] != c) return false;
+        ++position;
+        return true;
+    }
+}
+
+CaptureTimelineReader::CaptureTimelineReader(const std::filesystem::path& capture_path) {
+    // file indices are handed to the heap, so every file is in before the first line is read
+    if (std::filesystem::is_directory(capture_path)) {
+        for (size_t c = 0; c < kCaptureCategoryCount; ++c) {
+            const CaptureCategory category = static_cast<CaptureCategory>(c);
+            const std::filesystem::path file_path = capture_path / "StoC" / GetCaptureCategoryFileName(category);
+            if (!std::filesystem::exists(file_path)) continue; // empty categories leave no file
+            std::ifstream infile(file_path, std::ios::binary);
+            if (!infile.is_open()) {
+                throw std::runtime_error("File opening error.");
+            }
+            std::vector<unsigned char> compressed((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+            addFile(category, decompress_gzip(compressed));
+        }
+    } else {
+        ObserverArchiveReader archive(capture_path);
+        for (size_t c = 0; c < kCaptureCategoryCount; ++c) {
+            const CaptureCategory category = static_cast<CaptureCategory>(c);
+            const ArchiveEntry* entry = archive.Find(std::string("StoC/") + GetCaptureCategoryFileName(category));
+            if (!entry) continue;
+            if (!archive.Verify(*entry)) {
+                throw std::runtime_error("Archive stream is corrupted.");
+            }
+            const uint8_t* data = archive.GetData(*entry);
+            addFile(category, decompress_gzip(std::vector<unsigned char>(data, data + entry->size)));
+        }
+    }
+
+    for (size_t i = 0; i < files_.size(); ++i) {
+        if (readLine(files_[i])) heads_.emplace(files_[i].head.sequence, i);
+    }
+}
+
+void CaptureTimelineReader::addFile(CaptureCategory category, std::string text) {
+    File file;
+    file.category = category;
+    file.text = std::move(text);
+    file.head.category = category;
+    files_.push_back(std::move(file));
+}
+
+bool CaptureTimelineReader::Next(TimelineLine& line) {
+    if (heads_.empty()) return false;
+    const size_t index = heads_.top().second;
+    heads_.pop();
+    File& file = files_[index];
+    line = file.head;
+    if (readLine(file)) heads_.emplace(file.head.sequence, index);
+    return true;
+}
+
+bool CaptureTimelineReader::readLine(File& file) {
+    const std::string_view text = file.text;
+    if (file.position >= text.size()) return false;
+    size_t end = text.find('\n', file.position);
+    if (end == std::string_view::npos) end = text.size();
+    const std::string_view line = text.substr(file.position, end - file.position);
+    file.position = end + 1;
+
+    // [mm:ss.mmm #sequence] text
+    size_t position = 0;
+    uint32_t minutes = 0, seconds = 0, milliseconds = 0;
+    if (!Expect(line, position, '[') || !ParseNumber(line, position, minutes) ||
+        !Expect(line, position, ':') || !ParseNumber(line, position, seconds)) {
+        throw std::runtime_error("Malformed StoC line.");
+    }
+    if (!Expect(line, position, '.') || !ParseNumber(line, position, milliseconds) ||
+        !Expect(line, position, ' ') || !Expect(line, position, '#') ||
+        !ParseNumber(line, position, file.head.sequence) ||
+        !Expect(line, position, ']') || !Expect(line, position, ' ')) {
+        throw std::runtime_error("StoC lines have no sequence numbers, the capture predates them.");
+    }
+    file.head.time_ms = (minutes * 60 + seconds) * 1000 + milliseconds;
+    file.head.text = line.substr(position);
+    return true;
+}
+
+TimelineCheckResult CheckCaptureTimeline(const std::filesystem::path& capture_path) {
+    CaptureTimelineReader reader(capture_path);
+    TimelineCheckResult result;
+    result.file_count = reader.GetFileCount();
+
+    TimelineLine line;
+    uint32_t last_sequence = 0;
+    uint32_t last_time_ms = 0;
+    while (reader.Next(line)) {
+        // sequences may skip numbers (LordDamage totals share their record's line) but never repeat
+        if (result.line_count > 0 && (line.sequence <= last_sequence || line.time_ms < last_time_ms)) {
+            ++result.out_of_order;
+        }
+        last_sequence = line.sequence;
+        last_time_ms = line.time_ms;
+        ++result.line_count;
+    }
+    return result;
+}
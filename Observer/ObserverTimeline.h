@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ObserverEvents.h"
+
+#include <filesystem>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+// one line of an exported StoC file, with the fields of its [mm:ss.mmm #sequence] prefix parsed
+struct TimelineLine {
+    uint32_t time_ms = 0;
+    uint32_t sequence = 0;
+    CaptureCategory category = CaptureCategory::Unknown;
+    std::string_view text; // the line after its prefix, valid until the reader is destroyed
+};
+
+// reads the StoC files of an export back in the order the events arrived, for replay tools that
+// correlate categories (a skill activation with the damage it dealt). every file is already sorted
+// by sequence, so a k-way merge over one cursor per file restores the global order.
+class CaptureTimelineReader {
+public:
+    // opens a captures/<name>/ folder or a <name>.obsm archive. throws on read errors and on
+    // captures exported before events had sequence numbers
+    explicit CaptureTimelineReader(const std::filesystem::path& capture_path);
+
+    bool Next(TimelineLine& line); // false once every file is consumed, throws on malformed lines
+    size_t GetFileCount() const { return files_.size(); }
+
+private:
+    struct File {
+        CaptureCategory category;
+        std::string text; // decompressed content
+        size_t position = 0; // start of the next unread line
+        TimelineLine head;   // parsed line waiting in the heap
+    };
+
+    void addFile(CaptureCategory category, std::string text);
+    bool readLine(File& file); // parses the next line into file.head
+
+    std::vector<File> files_;
+    using Head = std::pair<uint32_t, size_t>; // sequence, file index
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads_;
+};
+
+// outcome of merging a whole export back into arrival order
+struct TimelineCheckResult {
+    size_t file_count = 0;
+    size_t line_count = 0;
+    size_t out_of_order = 0; // lines whose sequence or time went backwards, 0 for a well formed export
+};
+
+// reads an export with CaptureTimelineReader and checks the merged lines come out with increasing
+// sequences and times. slow on large captures, call it off the game and render threads
+TimelineCheckResult CheckCaptureTimeline(const std::filesystem::path& capture_path);
@@ -0,0 +1,303 @@
+#include "ObserverTrajectory.h"
+#include "ObserverCompression.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    constexpr char kHeaderMagic[4] = {'O', 'B', 'T', 'J'};
+    constexpr char kFooterMagic[4] = {'O', 'B', 'T', 'I'};
+    constexpr size_t kHeaderSize = 16;      // magic, version, word count, agent id, block duration
+    constexpr size_t kIndexEntrySize = 20;  // start time, snapshot count, offset, compressed size
+    constexpr size_t kFooterSize = 16;      // index offset, block count, magic
+
+    // the file is little endian whatever the host
+    void PutU16(std::vector<uint8_t>& data, uint16_t value) {
+        data.push_back(static_cast<uint8_t>(value));
+        data.push_back(static_cast<uint8_t>(value >> 8));
+    }
+
+    void PutU32(std::vector<uint8_t>& data, uint32_t value) {
+        for (int i = 0; i < 4; ++i) data.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void PutU64(std::vector<uint8_t>& data, uint64_t value) {
+        for (int i = 0; i < 8; ++i) data.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    uint16_t GetU16(const uint8_t* data) {
+        return static_cast<uint16_t>(data[0] | (data[1] << 8));
+    }
+
+    uint32_t GetU32(const uint8_t* data) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) value |= static_cast<uint32_t>(data[i]) << (8 * i);
+        return value;
+    }
+
+    uint64_t GetU64(const uint8_t* data) {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) value |= static_cast<uint64_t>(data[i]) << (8 * i);
+        return value;
+    }
+
+    void ReadExact(std::ifstream& file, uint64_t offset, uint8_t* out, size_t size) {
+        file.seekg(static_cast<std::streamoff>(offset));
+        file.read(reinterpret_cast<char*>(out), static_cast<std::streamsize>(size));
+        if (!file) {
+            throw std::runtime_error("Trajectory file is truncated.");
+        }
+    }
+}
+
+TrajectoryWriter::TrajectoryWriter(const std::filesystem::path& path, uint32_t agent_id)
+    : path_(path), temp_path_(path) {
+    temp_path_ += ".tmp";
+    file_.open(temp_path_, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!file_.is_open()) {
+        throw std::runtime_error("File opening error.");
+    }
+    temp_file_ = true;
+    writeHeader(agent_id);
+}
+
+TrajectoryWriter::TrajectoryWriter(std::vector<unsigned char>& output, uint32_t agent_id) : memory_output_(&output) {
+    memory_output_->clear();
+    writeHeader(agent_id);
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+    // an export that failed or was cancelled leaves no truncated trajectory behind
+    if (!temp_file_) return;
+    file_.close();
+    std::error_code ec;
+    std::filesystem::remove(temp_path_, ec);
+}
+
+void TrajectoryWriter::writeHeader(uint32_t agent_id) {
+    std::vector<uint8_t> header(kHeaderMagic, kHeaderMagic + 4);
+    PutU16(header, kTrajectoryVersion);
+    PutU16(header, static_cast<uint16_t>(AgentStateLog::kWordCount));
+    PutU32(header, agent_id);
+    PutU32(header, kTrajectoryBlockMs);
+    write(header.data(), header.size());
+    offset_ = header.size();
+}
+
+void TrajectoryWriter::write(const uint8_t* data, size_t size) {
+    if (memory_output_) {
+        memory_output_->insert(memory_output_->end(), data, data + size);
+        return;
+    }
+    file_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    if (!file_) {
+        throw std::runtime_error("File writing error.");
+    }
+}
+
+void TrajectoryWriter::Add(uint32_t timestamp_ms, const AgentState& state) {
+    if (block_snapshots_ > 0 && timestamp_ms - block_start_ms_ >= kTrajectoryBlockMs) {
+        flushBlock();
+    }
+
+    uint32_t words[AgentStateLog::kWordCount];
+    memcpy(words, &state, sizeof(AgentState));
+
+    if (block_snapshots_ == 0) {
+        // every block starts with a full snapshot so it decodes on its own
+        block_start_ms_ = timestamp_ms;
+        PutVarint(block_, timestamp_ms);
+        for (uint32_t word : words) PutU32(block_, word);
+    } else {
+        PutAgentStateDelta(block_, timestamp_ms - last_timestamp_ms_, words, last_words_);
+    }
+
+    memcpy(last_words_, words, sizeof(words));
+    last_timestamp_ms_ = timestamp_ms;
+    ++block_snapshots_;
+}
+
+void TrajectoryWriter::flushBlock() {
+    if (block_snapshots_ == 0) return;
+
+    const std::vector<unsigned char> compressed = compress_gzip(std::string(block_.begin(), block_.end()));
+    write(compressed.data(), compressed.size());
+
+    TrajectoryIndexEntry entry;
+    entry.start_time_ms = block_start_ms_;
+    entry.snapshot_count = block_snapshots_;
+    entry.offset = offset_;
+    entry.compressed_size = static_cast<uint32_t>(compressed.size());
+    index_.push_back(entry);
+
+    offset_ += compressed.size();
+    block_.clear();
+    block_snapshots_ = 0;
+}
+
+void TrajectoryWriter::Finish() {
+    flushBlock();
+
+    std::vector<uint8_t> trailer;
+    for (const TrajectoryIndexEntry& entry : index_) {
+        PutU32(trailer, entry.start_time_ms);
+        PutU32(trailer, entry.snapshot_count);
+        PutU64(trailer, entry.offset);
+        PutU32(trailer, entry.compressed_size);
+    }
+    PutU64(trailer, offset_);
+    PutU32(trailer, static_cast<uint32_t>(index_.size()));
+    trailer.insert(trailer.end(), kFooterMagic, kFooterMagic + 4);
+
+    write(trailer.data(), trailer.size());
+    if (memory_output_) return;
+    file_.close();
+    // check for stream errors after closing.
+    if (!file_) {
+        throw std::runtime_error("File writing error.");
+    }
+    std::filesystem::rename(temp_path_, path_); // replaces the file of an earlier export
+    temp_file_ = false;
+}
+
+TrajectoryReader::TrajectoryReader(const std::filesystem::path& path) {
+    file_.open(path, std::ios::binary | std::ios::in);
+    if (!file_.is_open()) {
+        throw std::runtime_error("File opening error.");
+    }
+    file_.seekg(0, std::ios::end);
+    readIndex(static_cast<uint64_t>(file_.tellg()));
+}
+
+TrajectoryReader::TrajectoryReader(const uint8_t* data, size_t size) : memory_data_(data), memory_size_(size) {
+    readIndex(size);
+}
+
+void TrajectoryReader::read(uint64_t offset, uint8_t* out, size_t size) {
+    if (!memory_data_) {
+        ReadExact(file_, offset, out, size);
+        return;
+    }
+    if (offset > memory_size_ || memory_size_ - offset < size) {
+        throw std::runtime_error("Trajectory file is truncated.");
+    }
+    memcpy(out, memory_data_ + offset, size);
+}
+
+void TrajectoryReader::readIndex(uint64_t file_size) {
+    if (file_size < kHeaderSize + kFooterSize) {
+        throw std::runtime_error("Trajectory file is truncated.");
+    }
+
+    uint8_t header[kHeaderSize];
+    read(0, header, kHeaderSize);
+    if (memcmp(header, kHeaderMagic, 4) != 0 || GetU16(header + 4) != kTrajectoryVersion ||
+        GetU16(header + 6) != AgentStateLog::kWordCount) {
+        throw std::runtime_error("Not a supported trajectory file.");
+    }
+    agent_id_ = GetU32(header + 8);
+
+    uint8_t footer[kFooterSize];
+    read(file_size - kFooterSize, footer, kFooterSize);
+    const uint64_t index_offset = GetU64(footer);
+    const uint32_t block_count = GetU32(footer + 8);
+    if (memcmp(footer + 12, kFooterMagic, 4) != 0 ||
+        index_offset + static_cast<uint64_t>(block_count) * kIndexEntrySize + kFooterSize != file_size) {
+        throw std::runtime_error("Trajectory index is corrupted.");
+    }
+
+    std::vector<uint8_t> index_data(static_cast<size_t>(block_count) * kIndexEntrySize);
+    if (!index_data.empty()) read(index_offset, index_data.data(), index_data.size());
+    index_.resize(block_count);
+    for (uint32_t i = 0; i < block_count; ++i) {
+        const uint8_t* entry = index_data.data() + static_cast<size_t>(i) * kIndexEntrySize;
+        index_[i].start_time_ms = GetU32(entry);
+        index_[i].snapshot_count = GetU32(entry + 4);
+        index_[i].offset = GetU64(entry + 8);
+        index_[i].compressed_size = GetU32(entry + 16);
+        if (index_[i].offset + index_[i].compressed_size > index_offset) {
+            throw std::runtime_error("Trajectory index is corrupted.");
+        }
+    }
+
+    loadBlock(0); // reading starts at the first snapshot
+}
+
+void TrajectoryReader::loadBlock(size_t block) {
+    block_index_ = block;
+    block_offset_ = 0;
+    block_decoded_ = 0;
+    if (block >= index_.size()) {
+        block_.clear();
+        return;
+    }
+
+    const TrajectoryIndexEntry& entry = index_[block];
+    std::vector<unsigned char> compressed(entry.compressed_size);
+    read(entry.offset, compressed.data(), compressed.size());
+    const std::string inflated = decompress_gzip(compressed);
+    block_.assign(inflated.begin(), inflated.end());
+}
+
+void TrajectoryReader::Seek(uint32_t time_ms) {
+    has_pending_ = false;
+
+    // last block starting at or before time_ms, a binary search over the index
+    auto it = std::upper_bound(index_.begin(), index_.end(), time_ms,
+                               [](uint32_t time, const TrajectoryIndexEntry& entry) { return time < entry.start_time_ms; });
+    loadBlock(it == index_.begin() ? 0 : static_cast<size_t>(it - index_.begin()) - 1);
+
+    uint32_t timestamp_ms;
+    AgentState state;
+    while (Next(timestamp_ms, state)) {
+        if (timestamp_ms >= time_ms) {
+            has_pending_ = true;
+            pending_timestamp_ms_ = timestamp_ms;
+            pending_state_ = state;
+            return;
+        }
+    }
+}
+
+bool TrajectoryReader::Next(uint32_t& timestamp_ms, AgentState& state) {
+    if (has_pending_) {
+        has_pending_ = false;
+        timestamp_ms = pending_timestamp_ms_;
+        state = pending_state_;
+        return true;
+    }
+
+    while (block_index_ < index_.size() && block_decoded_ >= index_[block_index_].snapshot_count) {
+        loadBlock(block_index_ + 1);
+    }
+    if (block_index_ >= index_.size()) return false;
+    return decodeSnapshot(timestamp_ms, state);
+}
+
+bool TrajectoryReader::decodeSnapshot(uint32_t& timestamp_ms, AgentState& state) {
+    const uint8_t* data = block_.data();
+    const size_t size = block_.size();
+
+    if (block_decoded_ == 0) {
+        if (!GetVarint(data, size, block_offset_, timestamp_ms_) ||
+            size - block_offset_ < AgentStateLog::kWordCount * sizeof(uint32_t)) {
+            throw std::runtime_error("Trajectory block is corrupted.");
+        }
+        for (size_t i = 0; i < AgentStateLog::kWordCount; ++i) {
+            words_[i] = GetU32(data + block_offset_);
+            block_offset_ += sizeof(uint32_t);
+        }
+    } else {
+        uint32_t time_delta;
+        if (!GetAgentStateDelta(data, size, block_offset_, time_delta, words_)) {
+            throw std::runtime_error("Trajectory block is corrupted.");
+        }
+        timestamp_ms_ += time_delta;
+    }
+    ++block_decoded_;
+
+    timestamp_ms = timestamp_ms_;
+    memcpy(&state, words_, sizeof(AgentState));
+    return true;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "ObserverAgentLog.h"
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <cstdint>
+
+// binary per-agent trajectory files (Agents/<agent_id>.traj), layout in Docs/EXPORTS_CONVENTIONS.md.
+// snapshots are grouped in blocks of kTrajectoryBlockMs, each one compressed on its own and starting
+// with a full snapshot, and a trailing index maps block start times to file offsets, so a reader
+// can jump to any time with a binary search and one block to inflate.
+constexpr uint32_t kTrajectoryBlockMs = 10000;
+constexpr uint16_t kTrajectoryVersion = 1;
+
+struct TrajectoryIndexEntry {
+    uint32_t start_time_ms = 0;   // time of the block's first snapshot
+    uint32_t snapshot_count = 0;
+    uint64_t offset = 0;          // file offset of the compressed block
+    uint32_t compressed_size = 0;
+};
+
+// writes one agent's snapshots in time order, throws on write errors. files are written to <path>.tmp
+// and renamed by Finish, a writer destroyed before that removes the partial file
+class TrajectoryWriter {
+public:
+    TrajectoryWriter(const std::filesystem::path& path, uint32_t agent_id);
+    TrajectoryWriter(std::vector<unsigned char>& output, uint32_t agent_id); // whole file into memory, for archives
+    ~TrajectoryWriter();
+
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+    void Add(uint32_t timestamp_ms, const AgentState& state);
+    void Finish(); // writes the last block, the index and the footer
+
+private:
+    void writeHeader(uint32_t agent_id);
+    void write(const uint8_t* data, size_t size);
+    void flushBlock();
+
+    std::filesystem::path path_;
+    std::filesystem::path temp_path_;
+    std::ofstream file_;
+    bool temp_file_ = false; // temp_path_ exists and was not moved in place yet
+    std::vector<unsigned char>* memory_output_ = nullptr;
+    uint64_t offset_ = 0;
+    std::vector<TrajectoryIndexEntry> index_;
+
+    std::vector<uint8_t> block_; // encoded snapshots of the current block
+    uint32_t block_start_ms_ = 0;
+    uint32_t block_snapshots_ = 0;
+    uint32_t last_timestamp_ms_ = 0;
+    uint32_t last_words_[AgentStateLog::kWordCount] = {};
+};
+
+// reads a trajectory file, throws on missing or malformed files
+class TrajectoryReader {
+public:
+    explicit TrajectoryReader(const std::filesystem::path& path);
+    TrajectoryReader(const uint8_t* data, size_t size); // a whole file in memory (e.g. an archive stream), kept alive by the caller
+
+    uint32_t GetAgentId() const { return agent_id_; }
+    const std::vector<TrajectoryIndexEntry>& GetIndex() const { return index_; }
+
+    // positions the reader on the first snapshot at or after time_ms, inflating a single block
+    void Seek(uint32_t time_ms);
+    // returns the next snapshot, continuing into the following blocks
+    bool Next(uint32_t& timestamp_ms, AgentState& state);
+
+private:
+    void readIndex(uint64_t file_size);
+    void read(uint64_t offset, uint8_t* out, size_t size);
+    void loadBlock(size_t block);
+    bool decodeSnapshot(uint32_t& timestamp_ms, AgentState& state);
+
+    std::ifstream file_;
+    const uint8_t* memory_data_ = nullptr; // set when reading from memory instead of file_
+    uint64_t memory_size_ = 0;
+    uint32_t agent_id_ = 0;
+    std::vector<TrajectoryIndexEntry> index_;
+
+    size_t block_index_ = 0;
+    std::vector<uint8_t> block_; // inflated snapshots of the current block
+    size_t block_offset_ = 0;
+    uint32_t block_decoded_ = 0;
+    uint32_t timestamp_ms_ = 0;
+    uint32_t words_[AgentStateLog::kWordCount] = {};
+
+    bool has_pending_ = false;   // snapshot found by Seek, returned by the next call to Next
+    uint32_t pending_timestamp_ms_ = 0;
+    AgentState pending_state_;
+};
@@ -6,49 +6,18 @@
 #include <imgui.h>
 #include <algorithm>
 #include <sstream>
+#include <memory>
 
 void LordDamageWindow::Draw(ObserverPlugin& obs_plugin, bool& is_visible) {
     if (!is_visible) {
         return;
     }
 
-    MatchInfo* match_info = nullptr;
-    std::map<uint32_t, AgentInfo> agents_copy;
-    std::map<uint16_t, GuildInfo> guilds_copy;
-    
+    std::shared_ptr<const MatchTeamView> view;
     if (obs_plugin.match_handler) {
-        match_info = &obs_plugin.match_handler->GetMatchInfo();
-        agents_copy = match_info->GetAgentsInfoCopy();
-        guilds_copy = match_info->GetGuildsInfoCopy();
-    }
-    
-    std::map<uint32_t, std::vector<AgentInfo>> teams;
-    for (const auto& [agent_id, agent_info] : agents_copy) {
-        if (agent_info.team_id != 0 &&
-            (agent_info.type == AgentType::PLAYER || agent_info.type == AgentType::HERO || agent_info.type == AgentType::HENCHMAN)) {
-            teams[agent_info.team_id].push_back(agent_info);
-        }
-    }
-    
-    bool can_display_teams = false;
-    if (teams.size() >= 2) {
-        int teams_with_players = 0;
-        for (const auto& [team_id, team_agents] : teams) {
-            bool has_player = false;
-            for (const auto& agent : team_agents) {
-                if (agent.type == AgentType::PLAYER) {
-                    has_player = true;
-                    break;
-                }
-            }
-            if (has_player) {
-                teams_with_players++;
-            }
-        }
-        if (teams_with_players >= 2) {
-            can_display_teams = true;
-        }
+        view = obs_plugin.match_handler->GetMatchInfo().GetTeamView();
     }
+    const bool can_display_teams = view && view->CanDisplayTeams();
 
     ImGui::SetNextWindowSize(ImVec2(450.0f, 300.0f), ImGuiCond_FirstUseEver);
     
@@ -73,39 +42,11 @@ void LordDamageWindow::Draw(ObserverPlugin& obs_plugin, bool& is_visible) {
             ImGui::TableSetupColumn("Damage", ImGuiTableColumnFlags_WidthFixed, 100.0f);
             ImGui::TableHeadersRow();
             
-            for (const auto& [team_id, team_agents] : teams) {
-                if (team_id == 0) continue;
-                
-                long damage = ObserverMatchData::GetTeamLordDamage(team_id);
-                
-                std::string team_name = "Team " + std::to_string(team_id);
-                std::string guild_tag = "";
-                
-                std::map<uint16_t, int> guild_counts;
-                for(const auto& agent : team_agents) {
-                    if (agent.type == AgentType::PLAYER && agent.guild_id != 0) {
-                        guild_counts[agent.guild_id]++;
-                    }
-                }
-                
-                uint16_t most_common_guild_id = 0;
-                int highest_count = 0;
-                for (const auto& [guild_id, count] : guild_counts) {
-                    if (count > highest_count) {
-                        highest_count = count;
-                        most_common_guild_id = guild_id;
-                    }
-                }
-                
-                if (most_common_guild_id != 0) {
-                    auto it = guilds_copy.find(most_common_guild_id);
-                    if (it != guilds_copy.end()) {
-                        team_name = obs_plugin.WStringToString(it->second.name);
-                        guild_tag = obs_plugin.WStringToString(it->second.tag);
-                    }
+            if (view) {
+                for (const TeamView& team : view->teams) {
+                    long damage = ObserverMatchData::GetTeamLordDamage(team.team_id);
+                    DrawTeamDamageRow(team.name, team.tag, damage, GetTeamColor(team.team_id));
                 }
-                
-                DrawTeamDamageRow(team_name, guild_tag, damage, GetTeamColor(team_id));
             }
             
             ImGui::EndTable();
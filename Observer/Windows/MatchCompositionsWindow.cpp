@@ -12,7 +12,7 @@
 #include <imgui.h>
 #include <string>
 #include <vector>
-#include <map>
+#include <memory>
 #include <algorithm>
 #include <stringapiset.h>
 #include <GWCA/Constants/Skills.h>
@@ -32,10 +32,9 @@ void MatchCompositionsWindow::Draw(ObserverPlugin& obs_plugin, bool& is_visible)
     if (!is_visible || !obs_plugin.match_handler) return;
 
     MatchInfo& match_info = obs_plugin.match_handler->GetMatchInfo();
-    auto agents_copy = match_info.GetAgentsInfoCopy();
-    auto guilds_copy = match_info.GetGuildsInfoCopy();
+    const std::shared_ptr<const MatchTeamView> view = match_info.GetTeamView();
 
-    if (!obs_plugin.match_handler->IsObserving() && agents_copy.empty()) {
+    if (!obs_plugin.match_handler->IsObserving() && !view->has_agents) {
         ImGui::SetNextWindowSize(ImVec2(300, 100), ImGuiCond_FirstUseEver);
         if (ImGui::Begin("Match Compositions Status", &is_visible)) {
             ImGui::TextDisabled("Waiting for observer mode to start or end...");
@@ -44,35 +43,7 @@ void MatchCompositionsWindow::Draw(ObserverPlugin& obs_plugin, bool& is_visible)
         return;
     }
 
-    std::map<uint32_t, std::vector<AgentInfo>> teams;
-    for (const auto& [agent_id, agent_info] : agents_copy) {
-        if (agent_info.team_id != 0 &&
-            (agent_info.type == AgentType::PLAYER || agent_info.type == AgentType::HERO || agent_info.type == AgentType::HENCHMAN)) {
-            teams[agent_info.team_id].push_back(agent_info);
-        }
-    }
-
-    bool can_display_teams = false;
-    if (teams.size() >= 2) {
-        int teams_with_players = 0;
-        for (const auto& [team_id, team_agents] : teams) {
-            bool has_player = false;
-            for (const auto& agent : team_agents) {
-                if (agent.type == AgentType::PLAYER) {
-                    has_player = true;
-                    break;
-                }
-            }
-            if (has_player) {
-                teams_with_players++;
-            }
-        }
-        if (teams_with_players >= 2) {
-            can_display_teams = true;
-        }
-    }
-
-    if (!can_display_teams) {
+    if (!view->CanDisplayTeams()) {
         ImGui::SetNextWindowSize(ImVec2(300, 100), ImGuiCond_FirstUseEver);
         if (ImGui::Begin("Match Compositions Status", &is_visible)) {
             ImGui::TextDisabled("Waiting for opponent information...");
@@ -82,39 +53,13 @@ void MatchCompositionsWindow::Draw(ObserverPlugin& obs_plugin, bool& is_visible)
     }
 
     uint32_t team_index = 0;
-    for (auto const& [team_id, team_agents] : teams) {
+    for (const TeamView& team : view->teams) {
         if (team_index >= 2) break;
+        const uint32_t team_id = team.team_id;
 
-        std::string team_name = "Team " + std::to_string(team_id);
-        std::string team_tag = "";
-        
-        std::map<uint16_t, int> guild_counts;
-        for(const auto& agent : team_agents) {
-            if (agent.type == AgentType::PLAYER && agent.guild_id != 0) {
-                guild_counts[agent.guild_id]++;
-            }
-        }
-        
-        uint16_t most_common_guild_id = 0;
-        int highest_count = 0;
-        for (const auto& [guild_id, count] : guild_counts) {
-            if (count > highest_count) {
-                highest_count = count;
-                most_common_guild_id = guild_id;
-            }
-        }
-        
-        if (most_common_guild_id != 0) {
-            auto it = guilds_copy.find(most_common_guild_id);
-            if (it != guilds_copy.end()) {
-                team_name = obs_plugin.WStringToString(it->second.name);
-                team_tag = obs_plugin.WStringToString(it->second.tag);
-            }
-        }
-
-        std::string window_title = "#" + std::to_string(team_id) + ": " + team_name;
-        if (!team_tag.empty()) {
-            window_title += " [" + team_tag + "]";
+        std::string window_title = "#" + std::to_string(team_id) + ": " + team.name;
+        if (!team.tag.empty()) {
+            window_title += " [" + team.tag + "]";
         }
         
         if (match_info.winner_party_id != 0 && team_id == match_info.winner_party_id) {
@@ -126,14 +71,8 @@ void MatchCompositionsWindow::Draw(ObserverPlugin& obs_plugin, bool& is_visible)
         ImGui::PushStyleColor(ImGuiCol_WindowBg, ImVec4(0.1f, 0.1f, 0.1f, 0.55f));
 
         if (ImGui::Begin(window_title.c_str(), nullptr, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse | ImGuiWindowFlags_NoResize)) {
-            std::vector<AgentInfo> sorted_agents = team_agents;
-            std::sort(sorted_agents.begin(), sorted_agents.end(), [](const AgentInfo& a, const AgentInfo& b) {
-                if (a.type != b.type) return a.type < b.type;
-                return a.player_number < b.player_number;
-            });
-
             if (ImGui::BeginChild("PlayerList", ImVec2(0,0), false)) {
-                for (const auto& agent : sorted_agents) {
+                for (const AgentDetails& agent : team.members) {
                     ImGui::Dummy(ImVec2(0.0f, PLAYER_ROW_PADDING));
                     ImGui::BeginGroup();
 